@@ -0,0 +1,394 @@
+// Headless benchmark of the routing engines (no SFML), for comparing them on the same queries.
+//
+// Draws a reproducible set of origin-destination pairs, half uniform over airports with flights
+// and half hub-weighted (both ends drawn in proportion to their number of routes, like real
+// traffic), then runs every search variant over them: a warmup pass over other pairs (drawn from
+// a different seed) first, then one timed call per pair. Variants that cache answers (spt_cache)
+// drop what the warmup cached before the timed pass. Prints a table and writes JSON with
+// throughput and p50/p90/p99/p99.9 latency in nanoseconds, overall and per pair kind. Exact
+// engines are checked against dijkstra().
+//
+//   AirgorithmBench [--pairs N] [--seed S] [--warmup N] [--heavy N] [--only name,...]
+//                   [--routes file.csv] [--airports airports.dat] [--json out.json]
+//
+// The graph is loaded like the frontend loads it (routes plus airport coordinates, through the
+// same snapshot), so the geometric bounds are the ones users get. Landmarks, the contraction
+// hierarchy and the hub labels are saved under data/ after their first build and mapped on later
+// runs while the graph is unchanged (building the hierarchy takes over a minute). Another
+// --routes file, such as a scaled-up graph from AirgorithmSynthetic (synthetic_routes.cpp), gets
+// a snapshot of its own next to it.
+//
+// --heavy caps the pairs for the slow multi-answer variants (alternatives, profile), which run
+// the first N pairs only. Every timed call includes one steady_clock read (tens of ns).
+//
+// Built with AIRGORITHM_SEARCH_STATS=1, each variant also reports the mean search effort per
+// query of the engines it ran (search_stats.h); the counting itself then slows the timings.
+
+#include "graph.h"
+#include "landmarks.h"
+#include "contraction_hierarchy.h"
+#include "hub_labels.h"
+#include "spt_cache.h"
+#include "timetable.h"
+#include <functional>
+#include <random>
+using namespace std;
+
+struct OdPair {
+    int source;
+    int dest;
+    bool hub;           // drawn hub-weighted rather than uniformly
+};
+
+// Half uniform pairs, half hub-weighted ones, interleaved so any prefix has both kinds.
+// Only airports with at least one route out (sources) or in (destinations) are drawn.
+static vector<OdPair> makePairs(const FlightGraph& G, size_t count, uint64_t seed) {
+    const int n = G.airports.size();
+    vector<int> sources, dests;
+    vector<double> out_weight, in_weight;
+    for (int v = 0; v < n; v++) {
+        const size_t out = G.fwd_offsets[v + 1] - G.fwd_offsets[v];
+        const size_t in = G.rev_offsets[v + 1] - G.rev_offsets[v];
+        if (out > 0) {
+            sources.push_back(v);
+            out_weight.push_back(out);
+        }
+        if (in > 0) {
+            dests.push_back(v);
+            in_weight.push_back(in);
+        }
+    }
+    vector<OdPair> pairs;
+    if (sources.empty() || dests.empty())
+        return pairs;
+    mt19937_64 rng(seed);
+    uniform_int_distribution<size_t> any_source(0, sources.size() - 1), any_dest(0, dests.size() - 1);
+    discrete_distribution<size_t> hub_source(out_weight.begin(), out_weight.end());
+    discrete_distribution<size_t> hub_dest(in_weight.begin(), in_weight.end());
+    while (pairs.size() < count) {
+        const bool hub = pairs.size() % 2 == 1;
+        const int s = sources[hub ? hub_source(rng) : any_source(rng)];
+        const int t = dests[hub ? hub_dest(rng) : any_dest(rng)];
+        if (s != t)
+            pairs.push_back({s, t, hub});
+    }
+    return pairs;
+}
+
+// Nearest-rank percentiles of one set of latencies
+struct LatencySummary {
+    size_t queries = 0;
+    double total_ms = 0;
+    double mean_ns = 0, p50_ns = 0, p90_ns = 0, p99_ns = 0, p999_ns = 0, max_ns = 0;
+
+    static LatencySummary of(vector<double> ns) {
+        LatencySummary s;
+        s.queries = ns.size();
+        if (ns.empty())
+            return s;
+        sort(ns.begin(), ns.end());
+        double total = 0;
+        for (double x : ns)
+            total += x;
+        auto rank = [&](double p) { return ns[min(ns.size() - 1, (size_t)ceil(p * ns.size()) - 1)]; };
+        s.total_ms = total / 1e6;
+        s.mean_ns = total / ns.size();
+        s.p50_ns = rank(0.50);
+        s.p90_ns = rank(0.90);
+        s.p99_ns = rank(0.99);
+        s.p999_ns = rank(0.999);
+        s.max_ns = ns.back();
+        return s;
+    }
+
+    double queriesPerSecond() const {
+        return total_ms > 0 ? queries / (total_ms / 1000.0) : 0.0;
+    }
+
+    void writeJson(ostream& out) const {
+        out << fixed << setprecision(1) << "{\"queries\": " << queries << ", \"total_ms\": " << setprecision(3)
+            << total_ms << ", \"qps\": " << setprecision(1) << queriesPerSecond() << ", \"mean_ns\": " << mean_ns
+            << ", \"p50_ns\": " << p50_ns << ", \"p90_ns\": " << p90_ns << ", \"p99_ns\": " << p99_ns
+            << ", \"p999_ns\": " << p999_ns << ", \"max_ns\": " << max_ns << "}";
+    }
+};
+
+// One engine under test. run() answers a pair and returns a number derived from the answer
+// (the distance for exact engines), so the work cannot be optimized away.
+struct Variant {
+    string name;
+    bool exact;         // returns the fastest travel time in hours, compared with dijkstra()
+    bool heavy;         // runs on the first --heavy pairs only
+    function<double(int, int)> run;
+    function<void()> reset = nullptr;   // between warmup and timed pass, e.g. to empty a cache
+};
+
+struct VariantResult {
+    string name;
+    LatencySummary all, uniform, hub;
+    size_t mismatches = 0;
+    double checksum = 0;
+    map<string, SearchStatsRegistry::Totals> search;    // by engine, empty unless compiled in
+};
+
+static VariantResult runVariant(const Variant& variant, const vector<OdPair>& warmup_pairs, const vector<OdPair>& pairs,
+                                const vector<double>& expected) {
+    VariantResult result;
+    result.name = variant.name;
+    for (size_t i = 0; i < min(warmup_pairs.size(), pairs.size()); i++)
+        result.checksum += variant.run(warmup_pairs[i].source, warmup_pairs[i].dest);
+    result.checksum = 0;
+    if (variant.reset)
+        variant.reset();
+    SearchStatsRegistry::global().clear();
+
+    vector<double> all, uniform, hub;
+    all.reserve(pairs.size());
+    for (size_t i = 0; i < pairs.size(); i++) {
+        auto start = chrono::steady_clock::now();
+        const double answer = variant.run(pairs[i].source, pairs[i].dest);
+        const double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+        all.push_back(ns);
+        (pairs[i].hub ? hub : uniform).push_back(ns);
+        if (std::isfinite(answer))
+            result.checksum += answer;
+        if (variant.exact && !(answer == expected[i] || fabs(answer - expected[i]) <= 1e-9 * max(1.0, expected[i])))
+            result.mismatches++;
+    }
+    result.all = LatencySummary::of(std::move(all));
+    result.uniform = LatencySummary::of(std::move(uniform));
+    result.hub = LatencySummary::of(std::move(hub));
+    result.search = SearchStatsRegistry::global().snapshot();
+    return result;
+}
+
+// How an index was made ready: built (and saved) or mapped from an earlier run's file
+struct IndexSetup {
+    string name;
+    bool built;
+    double ms;
+};
+
+template <class Index, class Build>
+static IndexSetup openOrBuild(Index& index, const string& name, const string& path, const FlightGraph& G,
+                              Build build) {
+    auto start = chrono::steady_clock::now();
+    if (index.open(path, G))
+        return {name, false, msSince(start)};
+    build();
+    index.stats.print(cerr);
+    if (!index.save(path))
+        cerr << "Warning: could not write " << path << "\n";
+    return {name, true, index.stats.build_ms};
+}
+
+static bool writeJson(const string& path, const FlightGraph& G, uint64_t seed, size_t warmup,
+                      const vector<IndexSetup>& indexes, const vector<VariantResult>& results) {
+    ofstream out(path);
+    if (!out)
+        return false;
+    out << "{\n  \"graph\": {\"airports\": " << G.airports.size() << ", \"edges\": " << G.edgeCount()
+        << ", \"routes\": " << G.routeCount() << "},\n  \"seed\": " << seed << ",\n  \"warmup\": " << warmup
+        << ",\n  \"indexes\": [";
+    for (size_t i = 0; i < indexes.size(); i++)
+        out << (i ? ", " : "") << "{\"name\": \"" << indexes[i].name << "\", \"built\": "
+            << (indexes[i].built ? "true" : "false") << ", \"ms\": " << fixed << setprecision(3) << indexes[i].ms << "}";
+    out << "],\n  \"variants\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const VariantResult& r = results[i];
+        out << "    {\"name\": \"" << r.name << "\", \"mismatches\": " << r.mismatches << ", \"checksum\": "
+            << setprecision(6) << r.checksum << ",\n     \"all\": ";
+        r.all.writeJson(out);
+        out << ",\n     \"uniform\": ";
+        r.uniform.writeJson(out);
+        out << ",\n     \"hub\": ";
+        r.hub.writeJson(out);
+        if (!r.search.empty()) {
+            out << ",\n     \"search\": {";
+            bool first = true;
+            for (const auto& [engine, t] : r.search) {
+                out << (first ? "" : ", ") << "\"" << engine << "\": {\"queries\": " << t.queries;
+                t.sum.forEach([&](const char* name, uint64_t v) {
+                    out << ", \"" << name << "\": " << setprecision(1) << (t.queries ? (double)v / t.queries : 0.0);
+                });
+                out << "}";
+                first = false;
+            }
+            out << "}";
+        }
+        out << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+    return (bool)out;
+}
+
+int main(int argc, char** argv) {
+    string csv_path = "data/routes_with_estimated_times_plus_33k.csv";
+    string airports_path = "data/airports.dat";
+    string json_path = "bench.json";
+    size_t num_pairs = 2000;
+    size_t warmup = 200;
+    size_t heavy = 200;
+    uint64_t seed = 1;
+    vector<string> only;
+    auto usage = [&]() {
+        cerr << "Usage: " << argv[0] << " [--pairs N] [--seed S] [--warmup N] [--heavy N] [--only name,...]\n"
+             << "       [--routes file.csv] [--airports airports.dat] [--json out.json]\n";
+        return 1;
+    };
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--pairs" && i + 1 < argc) {
+            num_pairs = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--warmup" && i + 1 < argc) {
+            warmup = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--heavy" && i + 1 < argc) {
+            heavy = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--only" && i + 1 < argc) {
+            stringstream names(argv[++i]);
+            for (string name; getline(names, name, ',');)
+                only.push_back(name);
+        } else if (arg == "--routes" && i + 1 < argc) {
+            csv_path = argv[++i];
+        } else if (arg == "--airports" && i + 1 < argc) {
+            airports_path = argv[++i];
+        } else if (arg == "--json" && i + 1 < argc) {
+            json_path = argv[++i];
+        } else {
+            return usage();
+        }
+    }
+    auto wanted = [&](const string& name) {
+        return only.empty() || find(only.begin(), only.end(), name) != only.end();
+    };
+
+    // another routes file (e.g. from AirgorithmSynthetic) keeps its own snapshot next to it
+    const string snapshot_path = csv_path == "data/routes_with_estimated_times_plus_33k.csv"
+                                     ? "data/routes_airports.snapshot" : csv_path + ".snapshot";
+    FlightGraph G;
+    if (!G.loadWithSnapshot(snapshot_path, csv_path, airports_path)) {
+        cerr << "Cannot load " << csv_path << " / " << airports_path << "\n";
+        return 1;
+    }
+    G.printLoadReport(cerr);
+    const vector<OdPair> pairs = makePairs(G, num_pairs, seed);
+    const vector<OdPair> warmup_pairs = makePairs(G, warmup, seed ^ 0x9E3779B97F4A7C15ULL);
+    cerr << "Airports: " << G.airports.size() << " | Routes: " << G.routeCount() << " | Pairs: " << pairs.size()
+         << " (seed " << seed << ")\n";
+
+    // the indexes are made ready only if one of their variants runs
+    vector<IndexSetup> indexes;
+    LandmarkIndex landmarks;
+    ContractionHierarchy hierarchy;
+    HubLabelIndex hub_labels;
+    Timetable timetable;
+    if (wanted("alt"))
+        indexes.push_back(openOrBuild(landmarks, "landmarks", "data/bench_landmarks.snapshot", G,
+                                      [&]() { landmarks.build(G, 16); }));
+    if (wanted("ch"))
+        indexes.push_back(openOrBuild(hierarchy, "contraction_hierarchy", "data/bench_ch.snapshot", G,
+                                      [&]() { hierarchy.build(G); }));
+    if (wanted("hub_labels"))
+        indexes.push_back(openOrBuild(hub_labels, "hub_labels", "data/bench_hub_labels.snapshot", G,
+                                      [&]() { hub_labels.build(G); }));
+    if (wanted("timetable") || wanted("timetable.profile")) {
+        timetable.generate(G);
+        timetable.stats.print(cerr);
+        indexes.push_back({"timetable", true, timetable.stats.build_ms});
+    }
+    SptCache cache(G);
+
+    QueryWorkspace ws, other_ws;
+    KspWorkspace ksp_ws;
+    QuaternaryHeapQueue quaternary;
+    RadixHeapQueue radix;
+    const auto [shortest_flight, longest_flight] = G.flightTimeRange();
+    // a bucket queue is exact only if no flight is shorter than its width (see BucketQueue)
+    const bool flight_buckets = BucketQueue::validWidth(shortest_flight), minute_buckets = shortest_flight >= 1.0 / 60;
+    BucketQueue buckets(flight_buckets ? shortest_flight : 1.0 / 60, longest_flight), minutes(1.0 / 60, longest_flight);
+    const double inf = numeric_limits<double>::infinity();
+    vector<Variant> variants = {
+        {"dijkstra", true, false, [&](int s, int t) { return G.dijkstra(s, t, ws); }},
+        {"dijkstra.codes", true, false,
+         [&](int s, int t) { return G.dijkstra(G.airports[s].code, G.airports[t].code).first; }},
+        {"dijkstra.quaternary", true, false, [&](int s, int t) { return G.dijkstra(s, t, ws, quaternary); }},
+        {"dijkstra.radix", true, false, [&](int s, int t) { return G.dijkstra(s, t, ws, radix); }},
+        {"dijkstra.bucket", true, false, [&](int s, int t) { return G.dijkstra(s, t, ws, buckets); }},
+        {"dijkstra.minutes", true, false, [&](int s, int t) { return G.dijkstra(s, t, ws, minutes); }},
+        {"bidirectional", true, false, [&](int s, int t) {
+             int meet = -1;
+             return G.bidirectionalDijkstra(s, t, ws, other_ws, meet);
+         }},
+        {"astar.geo", true, false, [&](int s, int t) { return G.astar(s, t, ws); }},
+        {"alt", true, false, [&](int s, int t) { return landmarks.distance(s, t, ws); }},
+        {"ch", true, false, [&](int s, int t) {
+             int meet = -1;
+             return hierarchy.distance(s, t, ws, other_ws, meet);
+         }},
+        {"hub_labels", true, false, [&](int s, int t) { return hub_labels.distance(s, t); }},
+        {"spt_cache", true, false, [&](int s, int t) { return cache.distance(s, t); }, [&]() { cache.clear(); }},
+        {"single_source_all.t1", true, false, [&](int s, int t) { return G.singleSourceAll(s, 1).dist[t]; }},
+        {"single_source_all.t2", true, false, [&](int s, int t) { return G.singleSourceAll(s, 2).dist[t]; }},
+        {"single_source_all.t4", true, false, [&](int s, int t) { return G.singleSourceAll(s, 4).dist[t]; }},
+        {"bellmanFord", true, false, [&](int s, int t) { return G.bellmanFord(s, t, ws); }},
+        {"bellmanFord.hops3", false, false, [&](int s, int t) {
+             vector<int> path;
+             return G.hopLimitedBellmanFord(s, t, 3, ws, path);
+         }},
+        {"pareto", false, false, [&](int s, int t) {
+             auto front = G.paretoRoutes(s, t, ws);
+             return front.empty() ? inf : front.back().first + front.size();
+         }},
+        {"alternatives.k5", false, true, [&](int s, int t) {
+             auto ranked = G.kShortestPaths(s, t, 5, ksp_ws, 1);
+             return ranked.empty() ? inf : ranked.back().first + ranked.size();
+         }},
+        {"timetable", false, false, [&](int s, int t) {
+             return (double)timetable.earliestArrival(s, t, 9 * 60, ws).arrival;
+         }},
+        {"timetable.profile", false, true, [&](int s, int t) {
+             return (double)timetable.profile(s, t, 6 * 60, 12 * 60).size();
+         }},
+    };
+    erase_if(variants, [&](const Variant& v) {
+        return (v.name == "dijkstra.bucket" && !flight_buckets) || (v.name == "dijkstra.minutes" && !minute_buckets);
+    });
+
+    // reference answers for the exact variants
+    vector<double> expected(pairs.size());
+    for (size_t i = 0; i < pairs.size(); i++)
+        expected[i] = G.dijkstra(pairs[i].source, pairs[i].dest, ws);
+
+    vector<VariantResult> results;
+    cerr << "\n" << left << setw(22) << "variant" << right << setw(8) << "queries" << setw(12) << "qps" << setw(11)
+         << "p50 ns" << setw(11) << "p90 ns" << setw(11) << "p99 ns" << setw(12) << "p99.9 ns" << setw(10)
+         << "wrong" << "\n";
+    for (const Variant& variant : variants) {
+        if (!wanted(variant.name))
+            continue;
+        const size_t count = variant.heavy ? min(heavy, pairs.size()) : pairs.size();
+        const vector<OdPair> subset(pairs.begin(), pairs.begin() + count);
+        results.push_back(runVariant(variant, warmup_pairs, subset, expected));
+        const VariantResult& r = results.back();
+        cerr << left << setw(22) << r.name << right << setw(8) << r.all.queries << fixed << setprecision(0)
+             << setw(12) << r.all.queriesPerSecond() << setw(11) << r.all.p50_ns << setw(11) << r.all.p90_ns
+             << setw(11) << r.all.p99_ns << setw(12) << r.all.p999_ns << setw(10)
+             << (variant.exact ? to_string(r.mismatches) : string("-")) << "\n";
+        if (SEARCH_STATS_ENABLED)
+            SearchStatsRegistry::global().print(cerr);
+    }
+    if (wanted("spt_cache"))
+        cache.stats().print(cerr);
+
+    if (!writeJson(json_path, G, seed, warmup, indexes, results)) {
+        cerr << "Cannot write " << json_path << "\n";
+        return 1;
+    }
+    cerr << "Wrote " << json_path << "\n";
+    size_t mismatches = 0;
+    for (const VariantResult& r : results)
+        mismatches += r.mismatches;
+    return mismatches == 0 ? 0 : 2;
+}
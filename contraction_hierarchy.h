@@ -0,0 +1,563 @@
+#pragma once
+#include "graph.h"
+
+// Build statistics of a ContractionHierarchy
+struct ChStats {
+    double build_ms = 0;
+    size_t original_arcs = 0;       // distinct (u, v) pairs with a usable flight
+    size_t shortcuts = 0;           // shortcut arcs added by contraction
+    size_t up_arcs = 0, down_arcs = 0;
+    size_t core_size = 0;           // airports left uncontracted
+
+    void print(ostream& out) const {
+        out << fixed << setprecision(2)
+            << "contraction hierarchy: built in " << build_ms << " ms | arcs " << original_arcs
+            << " + shortcuts " << shortcuts << " | up " << up_arcs << " down " << down_arcs
+            << " | core " << core_size << " airports\n";
+    }
+};
+
+// Contraction hierarchy over a FlightGraph for fast point-to-point queries.
+//
+// build() contracts airports one by one in order of importance (edge difference, already
+// contracted neighbours and hierarchy depth, updated lazily), adding a shortcut u -> w through v
+// whenever no witness path of equal or lower time avoids v. Every arc ends up in one of two
+// CSR graphs: "up" holds arcs u -> x with rank[x] > rank[u], indexed by u; "down" holds arcs
+// x -> v with rank[x] > rank[v], indexed by v. A query runs a forward search on up from the
+// source and a backward search on down from the destination; shortcuts remember their middle
+// airport so the path unpacks back to real flights.
+//
+// Each airport's arcs are stored fastest first, so a search stops scanning them at the first one
+// that cannot beat the best meeting time found so far.
+//
+// Airports left uncontracted by core_degree_limit form a core at the top of the order whose arcs
+// sit in both graphs; a smaller core builds faster but makes every query search through it.
+//
+// The hierarchy keeps a pointer to the graph it was built from / opened for, which must
+// outlive it and stay unchanged.
+class ContractionHierarchy {
+public:
+    Column<int> rank;               // contraction order per airport (higher = more important)
+    Column<uint32_t> up_offsets;
+    Column<int> up_head;
+    Column<double> up_weight;
+    Column<int> up_middle;          // -1 for a real flight, else the contracted middle airport
+    Column<uint32_t> down_offsets;
+    Column<int> down_tail;
+    Column<double> down_weight;
+    Column<int> down_middle;
+    ChStats stats;
+
+    // Witness searches give up after settling this many airports (then a shortcut is added).
+    // Estimating a node's priority uses the cheaper limit.
+    int witness_settle_limit = 500;
+    int priority_settle_limit = 50;
+
+    // Contraction stops once the next airport has more arcs than this; the rest form the core.
+    // The default contracts everything.
+    int core_degree_limit = numeric_limits<int>::max();
+
+    void build(const FlightGraph& G) {
+        auto start = chrono::steady_clock::now();
+        graph = &G;
+        stats = ChStats();
+        const int n = G.airports.size();
+
+        // Dynamic adjacency, one arc per (u, v) with the fastest parallel flight
+        vector<vector<Arc>> out(n), in(n);
+        for (int u = 0; u < n; u++) {
+            for (uint32_t e = G.fwd_offsets[u]; e < G.fwd_offsets[u + 1]; e++) {
+                const int v = G.fwd_dest[e];
+                if (v == u || std::isinf(G.fwd_weight[e]))
+                    continue;
+                setArc(out[u], v, G.fwd_weight[e], -1);
+                setArc(in[v], u, G.fwd_weight[e], -1);
+            }
+        }
+        for (int u = 0; u < n; u++)
+            stats.original_arcs += out[u].size();
+
+        vector<char> contracted(n, 0);
+        vector<int> contracted_neighbours(n, 0);
+        vector<int> level(n, 0);        // depth of the hierarchy below each airport
+        vector<int> order(n, 0);
+        vector<vector<Arc>> up_arcs(n), down_arcs(n);
+        WitnessSearch wsearch;
+
+        auto priority = [&](int v) {
+            int added = simulate(v, out, in, wsearch, priority_settle_limit, nullptr);
+            return 2 * (added - (int)(out[v].size() + in[v].size())) + contracted_neighbours[v] + level[v];
+        };
+
+        priority_queue<pair<int, int>, vector<pair<int, int>>, greater<pair<int, int>>> pq;
+        for (int v = 0; v < n; v++)
+            pq.push({priority(v), v});
+
+        int next_rank = 0;
+        vector<Shortcut> shortcuts;
+        while (!pq.empty()) {
+            auto [prio, v] = pq.top();
+            pq.pop();
+            if (contracted[v])
+                continue;
+            // lazy update: re-evaluate and put back if it is no longer the minimum
+            const int current = priority(v);
+            if (!pq.empty() && current > pq.top().first) {
+                pq.push({current, v});
+                continue;
+            }
+
+            // everything still uncontracted becomes the core
+            if ((int)(in[v].size() + out[v].size()) > core_degree_limit) {
+                pq.push({current, v});
+                break;
+            }
+
+            shortcuts.clear();
+            simulate(v, out, in, wsearch, witness_settle_limit, &shortcuts);
+
+            order[v] = next_rank++;
+            contracted[v] = 1;
+            up_arcs[v] = out[v];    // remaining neighbours are all contracted later, i.e. higher
+            down_arcs[v] = in[v];
+
+            for (const Arc& a : out[v]) {
+                eraseArc(in[a.node], v);
+                contracted_neighbours[a.node]++;
+                level[a.node] = max(level[a.node], level[v] + 1);
+            }
+            for (const Arc& a : in[v]) {
+                eraseArc(out[a.node], v);
+                contracted_neighbours[a.node]++;
+                level[a.node] = max(level[a.node], level[v] + 1);
+            }
+            for (const Shortcut& sc : shortcuts) {
+                if (setArc(out[sc.from], sc.to, sc.weight, v))
+                    stats.shortcuts++;
+                setArc(in[sc.to], sc.from, sc.weight, v);
+            }
+            out[v].clear();
+            in[v].clear();
+        }
+
+        // Core airports rank above all contracted ones; their arcs go into both graphs so the
+        // query can move through the core freely in either direction.
+        stats.core_size = 0;
+        for (int v = 0; v < n; v++) {
+            if (contracted[v])
+                continue;
+            order[v] = next_rank++;
+            up_arcs[v] = out[v];
+            down_arcs[v] = in[v];
+            stats.core_size++;
+        }
+
+        rank = std::move(order);
+        buildCsr(up_arcs, up_offsets, up_head, up_weight, up_middle);
+        buildCsr(down_arcs, down_offsets, down_tail, down_weight, down_middle);
+        stats.up_arcs = up_head.size();
+        stats.down_arcs = down_tail.size();
+        stats.build_ms = msSince(start);
+    }
+
+    // Fastest route between two airport codes, unpacked to real flights. Same result as
+    // FlightGraph::dijkstra() (the time is re-summed along the unpacked path).
+    pair<double, vector<string>> route(const string& source_code, const string& destination_code) const {
+        return route(source_code, destination_code, QueryWorkspace::forThisThread(0), QueryWorkspace::forThisThread(1));
+    }
+
+    pair<double, vector<string>> route(const string& source_code, const string& destination_code,
+                                       QueryWorkspace& fwd_ws, QueryWorkspace& bwd_ws) const {
+        vector<string> empty_path;
+        const int source_idx = graph->findAirportIndexByCode(source_code);
+        const int dest_idx = graph->findAirportIndexByCode(destination_code);
+        if (source_idx < 0 || dest_idx < 0)
+            return {numeric_limits<double>::infinity(), empty_path};
+
+        vector<int> nodes = path(source_idx, dest_idx, fwd_ws, bwd_ws);
+        if (nodes.empty())
+            return {numeric_limits<double>::infinity(), empty_path};
+        vector<string> path_result;
+        for (int v : nodes)
+            path_result.push_back(graph->airports[v].code);
+        return {graph->pathTime(nodes), path_result};
+    }
+
+    // Unpacked airport indices from source to destination (empty if unreachable)
+    vector<int> path(int source_idx, int dest_idx, QueryWorkspace& fwd_ws, QueryWorkspace& bwd_ws) const {
+        int meet = -1;
+        distance(source_idx, dest_idx, fwd_ws, bwd_ws, meet);
+        vector<int> nodes;
+        if (meet < 0)
+            return nodes;
+
+        vector<int> hubs;
+        for (int v = meet; v != -1; v = fwd_ws.parent(v))
+            hubs.push_back(v);
+        reverse(hubs.begin(), hubs.end());
+        for (int v = bwd_ws.parent(meet); v != -1; v = bwd_ws.parent(v))
+            hubs.push_back(v);
+
+        nodes.push_back(hubs[0]);
+        for (size_t i = 0; i + 1 < hubs.size(); i++)
+            unpack(hubs[i], hubs[i + 1], nodes);
+        return nodes;
+    }
+
+    // CH distance query; meet is the highest-ranked airport on the best path (-1 if none).
+    //
+    // No stall-on-demand: on the route data (6235 airports, 69904 routes) it scanned ~14k arcs per
+    // query to skip ~7 of ~400 settled airports, and doubled the query time.
+    double distance(int source_idx, int dest_idx, QueryWorkspace& fwd_ws, QueryWorkspace& bwd_ws, int& meet) const {
+        const int n = rank.size();
+        fwd_ws.begin(n);
+        bwd_ws.begin(n);
+        SearchCounters& counters = fwd_ws.counters;     // both sides
+        SearchRecord record("ch", counters);
+        meet = -1;
+        if (!graph->mayReach(source_idx, dest_idx))
+            return numeric_limits<double>::infinity();
+        auto later = greater<pair<double, int>>();
+        fwd_ws.set(source_idx, 0.0, -1);
+        fwd_ws.heap.push_back({0.0, source_idx});
+        bwd_ws.set(dest_idx, 0.0, -1);
+        bwd_ws.heap.push_back({0.0, dest_idx});
+        searchCount(counters.pushes, 2);
+
+        double best = numeric_limits<double>::infinity();
+        bool forward = true;
+        while (true) {
+            const bool fwd_live = !fwd_ws.heap.empty() && fwd_ws.heap.front().first < best;
+            const bool bwd_live = !bwd_ws.heap.empty() && bwd_ws.heap.front().first < best;
+            if (!fwd_live && !bwd_live)
+                break;
+            if (!fwd_live)
+                forward = false;
+            else if (!bwd_live)
+                forward = true;
+            else
+                forward = !forward;
+
+            QueryWorkspace& ws = forward ? fwd_ws : bwd_ws;
+            const QueryWorkspace& other = forward ? bwd_ws : fwd_ws;
+            pop_heap(ws.heap.begin(), ws.heap.end(), later);
+            const int u = ws.heap.back().second;
+            ws.heap.pop_back();
+            searchCount(counters.pops);
+            if (ws.settled(u)) {
+                searchCount(counters.stale);
+                continue;
+            }
+            ws.settle(u);
+            searchCount(counters.settled);
+            const double du = ws.dist(u);
+
+            if (other.reached(u) && du + other.dist(u) < best) {
+                best = du + other.dist(u);
+                meet = u;
+            }
+
+            const Column<uint32_t>& off = forward ? up_offsets : down_offsets;
+            const Column<int>& adj = forward ? up_head : down_tail;
+            const Column<double>& w = forward ? up_weight : down_weight;
+            for (uint32_t a = off[u]; a < off[u + 1]; a++) {
+                const int x = adj[a];
+                const double candidate = du + w[a];
+                if (candidate >= best)
+                    break;      // fastest first: no later arc does better
+                searchCount(counters.relaxed);
+                if (candidate < ws.dist(x)) {
+                    ws.set(x, candidate, u);
+                    ws.heap.push_back({candidate, x});
+                    push_heap(ws.heap.begin(), ws.heap.end(), later);
+                    searchCount(counters.improved);
+                    searchCount(counters.pushes);
+                }
+            }
+        }
+        return best;
+    }
+
+    // Writes the hierarchy to its own snapshot-format file, tagged with the graph fingerprint
+    bool save(const string& path) const {
+        SnapshotWriter writer;
+        const uint64_t fp = graph->fingerprint();
+        writer.add(SEC_GRAPH_FINGERPRINT, &fp, 1);
+        forEachColumn([&](uint32_t id, const auto& col) {
+            writer.add(id, col.data(), col.size());
+        });
+        return writer.write(path, SnapshotSourceStamp(), SnapshotSourceStamp());
+    }
+
+    // Maps a saved hierarchy; fails if it was built from a different graph. Every section is
+    // checked against the graph and the offset arrays before any column points into the file, so
+    // a rejected file leaves the hierarchy as it was.
+    bool open(const string& path, const FlightGraph& G, bool verify_payload = false) {
+        auto file = make_shared<MappedFile>();
+        SnapshotReader reader;
+        if (!file->open(path) || !reader.open(file->data(), file->size(), verify_payload))
+            return false;
+        size_t count = 0;
+        const uint64_t* fp = reader.get<uint64_t>(SEC_GRAPH_FINGERPRINT, count);
+        if (!fp || count != 1 || *fp != G.fingerprint())
+            return false;
+
+        bool complete = true;
+        forEachColumn([&](uint32_t id, auto& col) {
+            using T = typename remove_reference_t<decltype(col)>::value_type;
+            size_t n = 0;
+            complete = complete && reader.get<T>(id, n) != nullptr;
+        });
+        if (!complete)
+            return false;
+
+        // rank: a permutation of the airports
+        const size_t n = G.airports.size();
+        size_t rank_count = 0;
+        const int* rank_of = reader.get<int>(SEC_CH_RANK, rank_count);
+        if (rank_count != n)
+            return false;
+        vector<uint8_t> ranked(n, 0);
+        for (size_t v = 0; v < n; v++) {
+            if (rank_of[v] < 0 || (size_t)rank_of[v] >= n || ranked[rank_of[v]])
+                return false;
+            ranked[rank_of[v]] = 1;
+        }
+        // offsets: n + 1 entries rising from 0 to the arc count of the three arc columns; every
+        // airport's arcs fastest first; arc ends below n; and a shortcut's middle airport ranked
+        // below both ends, which bounds the recursion of unpack()
+        auto arcsFit = [&](uint32_t offsets_id, uint32_t node_id, uint32_t weight_id, uint32_t middle_id) {
+            size_t offsets_count = 0, node_count = 0, weight_count = 0, middle_count = 0;
+            const uint32_t* off = reader.get<uint32_t>(offsets_id, offsets_count);
+            const int* node = reader.get<int>(node_id, node_count);
+            const double* weight = reader.get<double>(weight_id, weight_count);
+            const int* middle = reader.get<int>(middle_id, middle_count);
+            if (offsets_count != n + 1 || off[0] != 0 || off[n] != node_count || weight_count != node_count ||
+                middle_count != node_count)
+                return false;
+            for (size_t v = 0; v < n; v++) {
+                if (off[v] > off[v + 1])
+                    return false;
+                for (uint32_t a = off[v]; a < off[v + 1]; a++) {
+                    if (a > off[v] && weight[a] < weight[a - 1])
+                        return false;   // distance() needs the fastest arc first
+                    if (node[a] < 0 || (size_t)node[a] >= n)
+                        return false;
+                    const int m = middle[a];
+                    if (m == -1)
+                        continue;
+                    if (m < 0 || (size_t)m >= n || rank_of[m] >= rank_of[v] || rank_of[m] >= rank_of[node[a]])
+                        return false;
+                }
+            }
+            return true;
+        };
+        if (!arcsFit(SEC_CH_UP_OFFSETS, SEC_CH_UP_HEAD, SEC_CH_UP_WEIGHT, SEC_CH_UP_MIDDLE) ||
+            !arcsFit(SEC_CH_DOWN_OFFSETS, SEC_CH_DOWN_TAIL, SEC_CH_DOWN_WEIGHT, SEC_CH_DOWN_MIDDLE))
+            return false;
+
+        forEachColumn([&](uint32_t id, auto& col) {
+            using T = typename remove_reference_t<decltype(col)>::value_type;
+            size_t count = 0;
+            const T* p = reader.get<T>(id, count);
+            col.mapTo(p, count);
+        });
+        mapped_file = file;
+        graph = &G;
+        stats = ChStats();
+        stats.up_arcs = up_head.size();
+        stats.down_arcs = down_tail.size();
+        return true;
+    }
+
+private:
+    struct Arc {
+        int node;
+        double weight;
+        int middle;
+    };
+
+    struct Shortcut {
+        int from, to;
+        double weight;
+    };
+
+    const FlightGraph* graph = nullptr;
+    shared_ptr<MappedFile> mapped_file;
+
+    template <class F>
+    void forEachColumn(F f) {
+        f(SEC_CH_RANK, rank);
+        f(SEC_CH_UP_OFFSETS, up_offsets);
+        f(SEC_CH_UP_HEAD, up_head);
+        f(SEC_CH_UP_WEIGHT, up_weight);
+        f(SEC_CH_UP_MIDDLE, up_middle);
+        f(SEC_CH_DOWN_OFFSETS, down_offsets);
+        f(SEC_CH_DOWN_TAIL, down_tail);
+        f(SEC_CH_DOWN_WEIGHT, down_weight);
+        f(SEC_CH_DOWN_MIDDLE, down_middle);
+    }
+
+    template <class F>
+    void forEachColumn(F f) const {
+        const_cast<ContractionHierarchy*>(this)->forEachColumn([&](uint32_t id, const auto& col) { f(id, col); });
+    }
+
+    // Adds node or lowers its weight; returns true if a new arc was added
+    static bool setArc(vector<Arc>& arcs, int node, double weight, int middle) {
+        for (Arc& a : arcs) {
+            if (a.node == node) {
+                if (weight < a.weight) {
+                    a.weight = weight;
+                    a.middle = middle;
+                }
+                return false;
+            }
+        }
+        arcs.push_back({node, weight, middle});
+        return true;
+    }
+
+    static void eraseArc(vector<Arc>& arcs, int node) {
+        for (size_t i = 0; i < arcs.size(); i++) {
+            if (arcs[i].node == node) {
+                arcs[i] = arcs.back();
+                arcs.pop_back();
+                return;
+            }
+        }
+    }
+
+    // Scratch state for witness searches
+    struct WitnessSearch {
+        QueryWorkspace ws;
+        vector<uint32_t> target_mark;   // == target_epoch for out-neighbours of the node being tested
+        uint32_t target_epoch = 0;
+        vector<double> target_weight;   // [w] = weight of v -> w for the marked targets
+    };
+
+    // Counts (and optionally collects) the shortcuts contracting v would need. For every
+    // in-neighbour u, a Dijkstra that avoids v looks for witnesses to the out-neighbours; it stops
+    // once every one has a witness or is settled without one, past the longest path through v, or
+    // after settle_limit airports.
+    int simulate(int v, const vector<vector<Arc>>& out, const vector<vector<Arc>>& in,
+                 WitnessSearch& wsearch, int settle_limit, vector<Shortcut>* shortcuts) const {
+        if (in[v].empty() || out[v].empty())
+            return 0;
+        double max_out = 0;
+        for (const Arc& b : out[v])
+            max_out = max(max_out, b.weight);
+
+        QueryWorkspace& ws = wsearch.ws;
+        vector<uint32_t>& mark = wsearch.target_mark;
+        if (mark.size() < out.size())
+            mark.resize(out.size(), 0);
+        if (++wsearch.target_epoch == 0) {
+            fill(mark.begin(), mark.end(), 0);
+            wsearch.target_epoch = 1;
+        }
+        vector<double>& target_weight = wsearch.target_weight;
+        if (target_weight.size() < out.size())
+            target_weight.resize(out.size());
+        for (const Arc& b : out[v]) {
+            mark[b.node] = wsearch.target_epoch;
+            target_weight[b.node] = b.weight;
+        }
+
+        int needed = 0;
+        auto later = greater<pair<double, int>>();
+        for (const Arc& a : in[v]) {
+            const int u = a.node;
+            const double limit = a.weight + max_out;
+            int targets_left = (int)out[v].size() - (mark[u] == wsearch.target_epoch ? 1 : 0);
+
+            ws.begin(out.size());
+            ws.set(u, 0.0, -1);
+            ws.heap.push_back({0.0, u});
+            int settled = 0;
+            while (!ws.heap.empty() && settled < settle_limit && targets_left > 0) {
+                pop_heap(ws.heap.begin(), ws.heap.end(), later);
+                auto [d, x] = ws.heap.back();
+                ws.heap.pop_back();
+                if (ws.settled(x))
+                    continue;
+                ws.settle(x);
+                settled++;
+                if (d > limit)
+                    break;
+                // a target settled above its time through v is decided too: no witness
+                if (x != u && mark[x] == wsearch.target_epoch && d > a.weight + target_weight[x])
+                    targets_left--;
+                for (const Arc& b : out[x]) {
+                    if (b.node == v)
+                        continue;
+                    if (d + b.weight < ws.dist(b.node)) {
+                        // first witness for target b.node: tentative times only drop further
+                        if (b.node != u && mark[b.node] == wsearch.target_epoch) {
+                            const double via = a.weight + target_weight[b.node];
+                            if (d + b.weight <= via && ws.dist(b.node) > via)
+                                targets_left--;
+                        }
+                        ws.set(b.node, d + b.weight, x);
+                        ws.heap.push_back({d + b.weight, b.node});
+                        push_heap(ws.heap.begin(), ws.heap.end(), later);
+                    }
+                }
+            }
+
+            for (const Arc& b : out[v]) {
+                if (b.node == u)
+                    continue;
+                const double via = a.weight + b.weight;
+                if (ws.dist(b.node) <= via)
+                    continue;
+                needed++;
+                if (shortcuts)
+                    shortcuts->push_back({u, b.node, via});
+            }
+        }
+        return needed;
+    }
+
+    static void buildCsr(const vector<vector<Arc>>& arcs, Column<uint32_t>& offsets, Column<int>& other,
+                         Column<double>& weight, Column<int>& middle) {
+        vector<uint32_t> off(arcs.size() + 1, 0);
+        vector<int> nodes, mids;
+        vector<double> ws;
+        vector<Arc> sorted;
+        for (size_t v = 0; v < arcs.size(); v++) {
+            sorted = arcs[v];
+            stable_sort(sorted.begin(), sorted.end(), [](const Arc& a, const Arc& b) { return a.weight < b.weight; });
+            for (const Arc& a : sorted) {
+                nodes.push_back(a.node);
+                ws.push_back(a.weight);
+                mids.push_back(a.middle);
+            }
+            off[v + 1] = nodes.size();
+        }
+        offsets = std::move(off);
+        other = std::move(nodes);
+        weight = std::move(ws);
+        middle = std::move(mids);
+    }
+
+    // Appends the real airports after `from` on the arc from -> to
+    void unpack(int from, int to, vector<int>& nodes) const {
+        int middle = -1;
+        if (rank[to] > rank[from]) {
+            for (uint32_t a = up_offsets[from]; a < up_offsets[from + 1]; a++)
+                if (up_head[a] == to)
+                    middle = up_middle[a];
+        } else {
+            for (uint32_t a = down_offsets[to]; a < down_offsets[to + 1]; a++)
+                if (down_tail[a] == from)
+                    middle = down_middle[a];
+        }
+        if (middle < 0) {
+            nodes.push_back(to);
+            return;
+        }
+        unpack(from, middle, nodes);
+        unpack(middle, to, nodes);
+    }
+};
@@ -65,14 +65,11 @@ int main() {
     return 1;
   }
 
-  // load dataset
+  // load dataset (from the binary snapshot when it is newer than both files)
   FlightGraph G;
-  if (!G.loadAirportsDat("data/airports.dat")) {
-    std::cerr << "Error loading airports.dat\n";
-    return 1;
-  }
-  if (!G.loadFromEstimatedCSV("data/routes_with_estimated_times_plus_33k.csv")) {
-    std::cerr << "Failed to load csv data" << std::endl;
+  if (!G.loadWithSnapshot("data/routes_airports.snapshot",
+                          "data/routes_with_estimated_times_plus_33k.csv", "data/airports.dat")) {
+    std::cerr << "Failed to load airports.dat / csv data" << std::endl;
     return 1;
   }
 
@@ -153,6 +150,14 @@ int main() {
               else
                 oss << "\n Routes differ!";
 
+              // every trade-off between total time and number of flights
+              auto front = G.paretoRoutes(src, dst);
+              if (front.size() > 1) {
+                oss << "\n Time vs. flights:";
+                for (const auto& [time, path] : front)
+                  oss << " | " << (path.size() - 1) << ": " << time << " hrs";
+              }
+
               outputText.setString(oss.str());
             }
 
@@ -7,66 +7,197 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <set>
 #include <queue>
 #include <iomanip>
 #include <limits>
 #include <cmath>
+#include <numbers>
 #include <algorithm>
 #include <chrono>
+#include <cstdint>
+#include <string_view>
+#include <charconv>
+#include <deque>
+#include <thread>
+#include <barrier>
+#include <atomic>
+#include <memory>
+#include <cstring>
+#include <span>
+#include "mapped_file.h"
+#include "snapshot.h"
+#include "work_pool.h"
+#include "priority_queues.h"
+#include "search_stats.h"
 using namespace std;
 
 
 // "\N" or empty means "missing" (common in OpenFlights-style data).
-static inline bool missing(const string& s) {
+static inline bool missing(string_view s) {
     return s.empty() || s == "\\N";
 }
 
-// reads each line
-static vector<string> parseCsvLine(const string& line) {
-    vector<string> out;
-    string cur;
-    bool inq = false;
-    for (size_t i = 0; i < line.size(); ++i) {
-        char c = line[i];
-        if (c == '"') {
-            if (inq && i + 1 < line.size() && line[i + 1] == '"') {
-                cur.push_back('"'); // escaped quote
-                ++i;
-            } else {
-                inq = !inq;
+// Splits one CSV line into `cols`. Fields are views into `line`; a field whose quotes are not
+// just a plain "..." wrapper is unescaped into `spill`, which must outlive the views.
+// Quote handling matches the old getline/vector<string> reader exactly.
+static void parseCsvLine(string_view line, vector<string_view>& cols, deque<string>& spill) {
+    cols.clear();
+    size_t i = 0;
+    while (true) {
+        bool inq = false, quoted = false;
+        size_t j = i;
+        for (; j < line.size(); ++j) {
+            char c = line[j];
+            if (c == '"') {
+                quoted = true;
+                if (inq && j + 1 < line.size() && line[j + 1] == '"')
+                    ++j; // escaped quote
+                else
+                    inq = !inq;
+            } else if (c == ',' && !inq) {
+                break;
             }
-        } else if (c == ',' && !inq) {
-            out.push_back(cur);
-            cur.clear();
+        }
+
+        string_view raw = line.substr(i, j - i);
+        if (!quoted) {
+            cols.push_back(raw);
+        } else if (raw.size() >= 2 && raw.front() == '"' && raw.back() == '"' &&
+                   raw.substr(1, raw.size() - 2).find('"') == string_view::npos) {
+            cols.push_back(raw.substr(1, raw.size() - 2));
         } else {
-            cur.push_back(c);
+            string& cur = spill.emplace_back();
+            bool q = false;
+            for (size_t k = 0; k < raw.size(); ++k) {
+                if (raw[k] == '"') {
+                    if (q && k + 1 < raw.size() && raw[k + 1] == '"') {
+                        cur.push_back('"');
+                        ++k;
+                    } else {
+                        q = !q;
+                    }
+                } else {
+                    cur.push_back(raw[k]);
+                }
+            }
+            cols.push_back(cur);
         }
+
+        if (j >= line.size())
+            break;
+        i = j + 1;
     }
-    out.push_back(cur);
-    return out;
 }
 
-static int parseIntOr(const string& s, int fallback) {
+// from_chars does not skip the leading whitespace or '+' that stoi/stod accepted
+static inline string_view numberPrefix(string_view s) {
+    size_t i = 0;
+    while (i < s.size() && isspace((unsigned char)s[i]))
+        i++;
+    if (i < s.size() && s[i] == '+' && i + 1 < s.size() && s[i + 1] != '-')
+        i++;
+    return s.substr(i);
+}
+
+static int parseIntOr(string_view s, int fallback) {
     if (missing(s))
         return fallback;
-    try {
-        return stoi(s);
-    } catch (...) {
-        return fallback;
-    }
+    s = numberPrefix(s);
+    int value;
+    auto res = from_chars(s.data(), s.data() + s.size(), value);
+    return res.ec == errc() ? value : fallback;
 }
 
-static double parseDoubleOr(const string& s, double fallback) {
+static double parseDoubleOr(string_view s, double fallback) {
     if (missing(s))
         return fallback;
-    try {
-        return stod(s);
-    } catch (...) {
-        return fallback;
+    s = numberPrefix(s);
+    double value;
+    auto res = from_chars(s.data(), s.data() + s.size(), value);
+    return res.ec == errc() ? value : fallback;
+}
+
+// Lets unordered_map<string, ...> be probed with a string_view without building a string
+struct StringViewHash {
+    using is_transparent = void;
+    size_t operator()(string_view s) const { return hash<string_view>{}(s); }
+};
+
+// Rows parsed from one newline-aligned slice of a file. Views point into the mapped file or
+// into `spill`.
+template <class Row>
+struct ParsedChunk {
+    vector<Row> rows;
+    deque<string> spill;
+    size_t skipped = 0;
+};
+
+// Splits `body` into newline-aligned chunks and calls parse_line(line, cols, chunk) for every
+// non-empty line, one thread per chunk. Chunks come back in file order so the caller can merge
+// them deterministically.
+template <class Row, class ParseLine>
+static vector<ParsedChunk<Row>> parseLinesParallel(string_view body, int num_threads, ParseLine parse_line) {
+    const size_t min_chunk = 256 * 1024;   // small files are not worth a thread each
+    if (num_threads <= 0)
+        num_threads = max(1u, thread::hardware_concurrency());
+    num_threads = (int)max<size_t>(1, min<size_t>(num_threads, body.size() / min_chunk + 1));
+
+    vector<size_t> bounds(num_threads + 1, body.size());
+    bounds[0] = 0;
+    for (int t = 1; t < num_threads; t++) {
+        size_t pos = max(bounds[t - 1], body.size() * t / num_threads);
+        size_t nl = body.find('\n', pos);
+        bounds[t] = (nl == string_view::npos) ? body.size() : nl + 1;
+    }
+
+    vector<ParsedChunk<Row>> chunks(num_threads);
+    auto work = [&](int t) {
+        vector<string_view> cols;
+        string_view rest = body.substr(bounds[t], bounds[t + 1] - bounds[t]);
+        while (!rest.empty()) {
+            size_t nl = rest.find('\n');
+            string_view line = rest.substr(0, nl);
+            rest = (nl == string_view::npos) ? string_view() : rest.substr(nl + 1);
+            if (line.empty())
+                continue;
+            parseCsvLine(line, cols, chunks[t].spill);
+            parse_line(line, cols, chunks[t]);
+        }
+    };
+
+    vector<thread> workers;
+    for (int t = 1; t < num_threads; t++)
+        workers.emplace_back(work, t);
+    work(0);
+    for (auto& w : workers)
+        w.join();
+    return chunks;
+}
+
+// Wall time of each loader phase, filled in by loadFromEstimatedCSV / loadAirportsDat
+struct LoadPhaseTimes {
+    double map_ms = 0;      // open + mmap
+    double parse_ms = 0;    // split lines and parse fields (parallel)
+    double intern_ms = 0;   // resolve codes/strings to ids and stage edges (sequential, file order)
+    double build_ms = 0;    // freeze(): merge staged edges into the CSR arrays
+    int threads = 0;
+    size_t rows = 0, added = 0, skipped = 0;
+
+    void print(ostream& out, const string& label) const {
+        out << fixed << setprecision(2)
+            << label << ": map " << map_ms << " ms | parse " << parse_ms << " ms (" << threads
+            << " threads) | intern " << intern_ms << " ms | build " << build_ms << " ms | rows "
+            << rows << " added " << added << " skipped " << skipped << "\n";
     }
+};
+
+static inline double msSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
 }
 
-// Directed edge (u -> v). Stored inside the source Airport's node adjacency list.
+// Directed edge (u -> v) with its full route details. The routing core does not store these;
+// FlightGraph::edgeDetail() rebuilds one from the CSR attribute arrays when it is needed.
 struct Edge {
     int dest_index;            // Destination airport index
     string airline;            // Airline code
@@ -77,336 +208,3070 @@ struct Edge {
     double est_time_hr;        // Edge weight which is the estimated arrival time. This is calculated by the formula 30 mins + 1 hour per 500 miles (https://openflights.org/faq)
 };
 
-// Airport node. Adjacency list = vector<Edge>.
+// Airport node. Its outgoing edges live in the graph's CSR arrays.
 struct Airport {
     string code;                    // IATA/ICAO code (graph key)
     int openflights_id = -1;        // Optional Airport_ID
-    vector<Edge> edges;             // Outgoing edges (adjacency list)
     double latitude = 0.0;
     double longitude = 0.0;
+    bool has_coords = false;        // set once airports.dat gave a position (0,0 otherwise)
 };
 
-//stores all nodes (airports) and their edges (flight to destination)
-class FlightGraph {
+// Airport position as a unit vector; x is NaN when the airport has no coordinates.
+struct GeoPoint {
+    double x, y, z;
+
+    static GeoPoint fromLatLon(double lat_deg, double lon_deg) {
+        const double rad = std::numbers::pi / 180.0;
+        const double lat = lat_deg * rad, lon = lon_deg * rad;
+        return {cos(lat) * cos(lon), cos(lat) * sin(lon), sin(lat)};
+    }
+
+    bool known() const { return !std::isnan(x); }
+};
+
+static const double EARTH_RADIUS_MILES = 3958.8;
+
+// Great-circle distance in miles between two known points
+static inline double greatCircleMiles(const GeoPoint& a, const GeoPoint& b) {
+    const double dx = a.x - b.x, dy = a.y - b.y, dz = a.z - b.z;
+    const double chord = sqrt(dx * dx + dy * dy + dz * dz);
+    return 2.0 * EARTH_RADIUS_MILES * asin(min(1.0, chord / 2.0));
+}
+
+// Lower bound on flight time used by astar(): any trip between two airports with coordinates
+// takes at least offset_hr + hr_per_mile * great-circle miles. Calibrated from the edges at
+// freeze() time, so it holds for this data set even where weights stray from the formula.
+struct GeoBound {
+    double offset_hr = 0.0;
+    double hr_per_mile = 0.0;
+};
+
+// Interns repeated strings (airline codes, equipment lists) so each edge stores a small id.
+struct StringPool {
+    vector<string> names;
+    unordered_map<string,int,StringViewHash,equal_to<>> ids;
+
+    int intern(string_view s) {
+        auto it = ids.find(s);
+        if (it != ids.end())
+            return it->second;
+        const int id = (int)names.size();
+        names.emplace_back(s);
+        ids.emplace(names.back(), id);
+        return id;
+    }
+
+    const string& name(int id) const {
+        return names[id];
+    }
+};
+
+// Read-only array that either owns its elements or views a section of a mapped snapshot.
+// Assigning a vector makes it owning again.
+template <class T>
+class Column {
 public:
-    vector<Airport> airports;       // All airports are stored in this vector
+    Column() = default;
+    Column(const Column& other) { *this = other; }
+    Column(Column&& other) noexcept { *this = std::move(other); }
 
-    // read the data from the file to create all the nodes and edges
-    // A row is skipped only if a source or destination CODE is missing.
-    bool loadFromEstimatedCSV(const string& routes_csv_path) {
-        ifstream fin(routes_csv_path);
-        if (!fin) {
-            cerr << "Error: cannot open " << routes_csv_path << "\n";
-            return false;
+    Column& operator=(const Column& other) {
+        if (this != &other) {
+            owned = other.owned;
+            ptr = other.isMapped() ? other.ptr : owned.data();
+            len = other.len;
         }
+        return *this;
+    }
 
-        string header;
-        //return if the file is empty
-        if (!getline(fin, header)) {
-            cerr << "Error: CSV file is empty.\n";
-            return false;
+    Column& operator=(Column&& other) noexcept {
+        if (this != &other) {
+            const bool mapped = other.isMapped();
+            owned = std::move(other.owned);
+            ptr = mapped ? other.ptr : owned.data();
+            len = other.len;
+            other.ptr = nullptr;
+            other.len = 0;
         }
+        return *this;
+    }
 
-        size_t added = 0, skipped = 0;
-        string line;
-        while (getline(fin, line)) {
-            if (line.empty())
-                continue;
-            auto cols = parseCsvLine(line);
-
-            // Extract needed fields
-            const string& airline      = cols[0];
-            const string& airline_id_s = cols[1];
-            const string& src_code     = cols[2];
-            const string& src_id_s     = cols[3];
-            const string& dst_code     = cols[4];
-            const string& dst_id_s     = cols[5];
-            const string& codeshare_s  = cols[6];
-            const string& stops_s      = cols[7];
-            const string& equipment    = cols[8];
-            const string& est_time_s   = cols[9];
-
-            // Require codes; IDs are optional (\N are still read)
-            if (missing(src_code) || missing(dst_code)) {
-                skipped++;
-                continue;
-            }
+    Column& operator=(vector<T>&& v) {
+        owned = std::move(v);
+        ptr = owned.data();
+        len = owned.size();
+        return *this;
+    }
 
-            // Parse values
-            const int airline_id = parseIntOr(airline_id_s, -1);
-            const int src_id = parseIntOr(src_id_s, -1);
-            const int dst_id = parseIntOr(dst_id_s, -1);
-            const bool codeshare = (!missing(codeshare_s) && (codeshare_s == "Y" || codeshare_s == "y"));
-            const int stops = parseIntOr(stops_s, 0);
-            const double est_time_hr = parseDoubleOr(est_time_s, numeric_limits<double>::quiet_NaN());
+    // Points at memory owned by someone else (a mapped snapshot)
+    void mapTo(const T* p, size_t n) {
+        owned = vector<T>();
+        ptr = p;
+        len = n;
+    }
 
-            // Create/fetch airports by code
-            const int sidx = getOrCreateAirportIndexByCode(src_code);
-            const int didx = getOrCreateAirportIndexByCode(dst_code);
-            if (sidx < 0 || didx < 0) {
-                skipped++;
-                continue;
-            }
+    // Copy of the elements, e.g. to modify a mapped column and assign it back
+    vector<T> toVector() const {
+        return vector<T>(ptr, ptr + len);
+    }
+
+    // Writable pointer for in-place updates; a mapped column is copied into owned storage first
+    T* mutableData() {
+        if (isMapped())
+            *this = toVector();
+        return owned.data();
+    }
+
+    bool isMapped() const { return len > 0 && ptr != owned.data(); }
+    const T& operator[](size_t i) const { return ptr[i]; }
+    const T* data() const { return ptr; }
+    size_t size() const { return len; }
+    bool empty() const { return len == 0; }
+    const T* begin() const { return ptr; }
+    const T* end() const { return ptr + len; }
 
-            // Update airport IDs if present and not set yet
-            if (src_id >= 0 && airports[sidx].openflights_id < 0)
-                airports[sidx].openflights_id = src_id;
-            if (dst_id >= 0 && airports[didx].openflights_id < 0)
-                airports[didx].openflights_id = dst_id;
+    using value_type = T;
+
+private:
+    vector<T> owned;
+    const T* ptr = nullptr;
+    size_t len = 0;
+};
+
+// Airport codes of up to 4 characters (every IATA and ICAO code) packed into a uint32_t, first
+// character in the low byte. Returns 0 for codes that do not fit (empty, longer, or with a NUL).
+static inline uint32_t packAirportCode(string_view code) {
+    if (code.empty() || code.size() > 4)
+        return 0;
+    uint32_t key = 0;
+    for (size_t i = 0; i < code.size(); i++) {
+        if (code[i] == '\0')
+            return 0;
+        key |= (uint32_t)(unsigned char)code[i] << (8 * i);
+    }
+    return key;
+}
+
+// Airport code -> airport index. Packed codes live in an open-addressing table (linear probing,
+// at most half full) whose arrays are Columns, so a snapshot maps the index in place; codes that
+// do not pack go to a small string map. Lookups take a string_view and never allocate.
+class AirportCodeIndex {
+public:
+    Column<uint32_t> keys;          // packed code, 0 = empty slot; power-of-two size
+    Column<int> values;
 
-            // Append the directed edge to the source's adjacency list (vector<Edge>)
-            Edge e;
-            e.dest_index   = didx;
-            e.airline      = airline;
-            e.airline_id   = airline_id;
-            e.stops        = stops;
-            e.equipment    = equipment;
-            e.codeshare    = codeshare;
-            e.est_time_hr  = est_time_hr;
+    int find(string_view code) const {
+        const uint32_t key = packAirportCode(code);
+        if (key == 0) {
+            auto it = overflow.find(code);
+            return it == overflow.end() ? -1 : it->second;
+        }
+        if (keys.empty())
+            return -1;
+        const size_t mask = keys.size() - 1;
+        for (size_t slot = slotOf(key, mask);; slot = (slot + 1) & mask) {
+            if (keys[slot] == key)
+                return values[slot];
+            if (keys[slot] == 0)
+                return -1;
+        }
+    }
 
-            airports[sidx].edges.push_back(std::move(e));
-            added++;
+    // code must not be in the index yet
+    void insert(string_view code, int idx) {
+        const uint32_t key = packAirportCode(code);
+        if (key == 0) {
+            overflow.emplace(string(code), idx);
+            return;
         }
+        if (2 * (packed + 1) > keys.size())
+            rehash(max<size_t>(16, keys.size() * 2));
+        place(key, idx);
+        packed++;
+    }
 
-        return added > 0;
+    void reserve(size_t n) {
+        size_t capacity = 16;
+        while (capacity < 2 * n)
+            capacity *= 2;
+        if (capacity > keys.size())
+            rehash(capacity);
     }
 
-    bool loadAirportsDat(const std::string& path) {
-        std::ifstream fin(path);
-        if (!fin)
-        {
-            std::cerr << "Error: cannot open " << path << "\n";
-            return false;
+    // Re-derives the bookkeeping after keys/values were mapped from a snapshot; codes that do
+    // not pack are re-added from the airport list
+    void attach(const vector<Airport>& airports) {
+        overflow.clear();
+        packed = 0;
+        for (size_t i = 0; i < airports.size(); i++) {
+            if (packAirportCode(airports[i].code) == 0)
+                overflow.emplace(airports[i].code, (int)i);
+            else
+                packed++;
         }
+    }
 
-        std::string line;
-        while (std::getline(fin,line))
-        {
-            if (line.empty()) continue;
-            auto cols = parseCsvLine(line);
-            if (cols.size() < 8) continue;
+private:
+    size_t packed = 0;
+    unordered_map<string,int,StringViewHash,equal_to<>> overflow;
+
+    static size_t slotOf(uint32_t key, size_t mask) {
+        return (size_t)(((uint64_t)key * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+    }
+
+    void place(uint32_t key, int idx) {
+        uint32_t* k = keys.mutableData();
+        int* v = values.mutableData();
+        const size_t mask = keys.size() - 1;
+        size_t slot = slotOf(key, mask);
+        while (k[slot] != 0)
+            slot = (slot + 1) & mask;
+        k[slot] = key;
+        v[slot] = idx;
+    }
+
+    void rehash(size_t capacity) {
+        vector<uint32_t> old_keys = keys.toVector();
+        vector<int> old_values = values.toVector();
+        keys = vector<uint32_t>(capacity, 0);
+        values = vector<int>(capacity, -1);
+        for (size_t i = 0; i < old_keys.size(); i++)
+            if (old_keys[i] != 0)
+                place(old_keys[i], old_values[i]);
+    }
+};
 
-            std::string code = cols[4];
-            if (missing(code)) continue;
+// One arrival of a round-based search (FlightGraph::hopLimitedBellmanFord, paretoRoutes): the
+// airport, its time, the round (= flights taken) and the label one flight earlier
+struct HopLabel {
+    int node;
+    int prev;       // -1 at the source
+    int round;
+    double dist;
+};
 
-            double lat = parseDoubleOr(cols[6], 0.0);
-            double lon = parseDoubleOr(cols[7], 0.0);
+// Scratch state for one search at a time: tentative distances, parents, settled flags and the
+// heap. Reuse one per thread (forThisThread()) or per worker instead of allocating per query.
+//
+// Reset is lazy: begin() bumps an epoch, and any entry whose stamp predates it reads as
+// untouched (distance +inf, no parent, not settled). A query that explores 30 airports only
+// writes 30 entries, whatever the size of the graph.
+class QueryWorkspace {
+public:
+    vector<pair<double, int>> heap;   // reusable (distance, node) min-heap storage
+    vector<HopLabel> labels;          // reusable label pool of round-based searches
+    vector<int> frontier, next_frontier;
+    // Round buffers of FlightGraph::bellmanFord(): distances and improved-destination flags of the
+    // current and next round, parents, and the caller's weights in in-edge order
+    vector<double> round_dist[2];
+    vector<uint8_t> round_dirty[2];
+    vector<int> round_parent;
+    vector<double> round_weight;
+    SearchCounters counters;          // effort of the last query (search_stats.h), zero unless compiled in
 
-            int idx = getOrCreateAirportIndexByCode(code);
-            airports[idx].latitude = lat;
-            airports[idx].longitude = lon;
+    // Starts a new query over a graph with num_nodes airports
+    void begin(size_t num_nodes) {
+        if (entries.size() < num_nodes)
+            entries.resize(num_nodes);
+        epoch += 2;
+        if (epoch < 2) {                // wrapped: clear stamps once every 2^31 queries
+            for (auto& en : entries)
+                en.stamp = 0;
+            epoch = 2;
         }
+        heap.clear();
+        labels.clear();
+        if constexpr (SEARCH_STATS_ENABLED)
+            counters.clear();
+    }
 
-        return true;
+    double dist(int v) const {
+        return entries[v].stamp >= epoch ? entries[v].dist : numeric_limits<double>::infinity();
     }
 
-    // Prints up to `max_edges` outgoing edges for a given airport code for test purposes
-    void printSampleEdges(const string& code, size_t max_edges) const {
-        const int idx = findAirportIndexByCode(code);
-        if (idx < 0) {
-            cout << "Airport not found: " << code << "\n";
-            return;
-        }
-        const Airport& A = airports[idx];
-        cout << "Airport " << A.code
-             << " Airline_ID=" << A.openflights_id
-             << " — # of outgoing edges: " << A.edges.size() << "\n";
+    int parent(int v) const {
+        return entries[v].stamp >= epoch ? entries[v].parent : -1;
+    }
 
-        for (int i = 0; i < A.edges.size() && i < max_edges; ++i) {
-            const Edge& e = A.edges[i];
-            const Airport& B = airports[e.dest_index];
-            cout << "  -> " << B.code
-                 << "  airline=" << e.airline
-                 << "  ID=" << e.airline_id
-                 << "  stops=" << e.stops
-                 << "  equip=" << e.equipment
-                 << "  codeshare=" << (e.codeshare ? "Y" : "N")
-                 << fixed << setprecision(2)
-                 << "  est_time_hr=" << (std::isnan(e.est_time_hr) ? -1.0 : e.est_time_hr)
-                 << "\n";
-        }
+    bool settled(int v) const {
+        return entries[v].stamp == epoch + 1;
     }
 
-    // returns the fastest direct time from src->dst among parallel edges
-    double getFastestDirectTime(const string& src_code, const string& dst_code) const {
-        const int sidx = findAirportIndexByCode(src_code);
-        const int didx = findAirportIndexByCode(dst_code);
-        if (sidx < 0) {
-            cout << "Source not found: " << src_code << "\n";
-            exit(0);
-        }
-        if (didx < 0) {
-            cout << "Destination not found: " << dst_code << "\n";
-            exit(0);
-        }
+    bool reached(int v) const {
+        return entries[v].stamp >= epoch;
+    }
 
-        double best = numeric_limits<double>::infinity(); //assign to positive infinity, the highest
+    void set(int v, double d, int parent_node) {
+        Entry& en = entries[v];
+        en.dist = d;
+        en.parent = parent_node;
+        if (en.stamp < epoch)
+            en.stamp = epoch;
+    }
 
-        for (int i = 0; i < airports[sidx].edges.size(); ++i) {
-            const Edge& e = airports[sidx].edges[i];
-            if (e.dest_index == didx && !std::isnan(e.est_time_hr))
-                best = min(best, e.est_time_hr);
-        }
+    void settle(int v) {
+        entries[v].stamp = epoch + 1;
+    }
 
-        return best;
+    // Clears the settled flag of a reached node so it can be expanded again
+    void reopen(int v) {
+        entries[v].stamp = epoch;
     }
 
-    // dijkstra's algorithm
-    pair<double, vector<string>> dijkstra(const string& source_code, const string& destination_code) const {
-        int source_idx = findAirportIndexByCode(source_code);
-        int dest_idx = findAirportIndexByCode(destination_code);
+    // Per-thread workspaces; searches that need two at once (bidirectional) use slots 0 and 1
+    static QueryWorkspace& forThisThread(int slot = 0) {
+        thread_local QueryWorkspace ws[2];
+        return ws[slot];
+    }
 
-        vector<string> empty_path;
-        if (source_idx < 0 || dest_idx < 0) {
-            return {numeric_limits<double>::infinity(), empty_path};
-        }
+private:
+    // stamp == epoch: reached this query; stamp == epoch + 1: also settled
+    struct Entry {
+        double dist = 0.0;
+        int parent = -1;
+        uint32_t stamp = 0;
+    };
+    vector<Entry> entries;
+    uint32_t epoch = 0;
+};
 
-        int num_airports = airports.size();
-        vector<double> distance_array(num_airports, numeric_limits<double>::infinity());
-        vector<int> parent_array(num_airports, -1);
-        vector<bool> visited_array(num_airports, false);
+// Scratch state for FlightGraph::kShortestPaths(): the reverse shortest-path tree to the
+// destination and one spur-search workspace per worker. Kept across queries like QueryWorkspace.
+struct KspWorkspace {
+    QueryWorkspace reverse;         // dist = fastest time to the destination, parent = next hop
+    double reverse_radius = 0;      // every airport not settled in `reverse` is at least this far
+    vector<QueryWorkspace> spur;    // grown to the number of workers on first use
+};
 
-        priority_queue<pair<double, int>, vector<pair<double, int>>, greater<pair<double, int>>> pq;
+// Airport numberings for FlightGraph::reorder(). Searches walk the CSR arrays by airport index,
+// so numbering airports that are routed together close to each other keeps their entries on
+// shared cache lines.
+enum class AirportOrder {
+    LOAD,       // first appearance in the input files (the loaders' numbering)
+    DEGREE,     // most routes first: the hubs every search touches share a few cache lines
+    BFS,        // breadth-first from the busiest hub over routes in both directions
+    RCM,        // reverse Cuthill-McKee: breadth-first from low-degree airports, neighbours by
+                // ascending degree, then reversed; keeps every route's endpoints close
+};
 
-        distance_array[source_idx] = 0.0;
-        pq.push(make_pair(0.0, source_idx));
+// One change to the flight table, for FlightGraph::applyUpdates(). Flights are identified by
+// their airports and airline: REMOVE and RETIME apply to every flight of that airline on the pair,
+// including flights an earlier ADD of the same batch introduced.
+struct FlightUpdate {
+    enum Kind { ADD, REMOVE, RETIME };
+    Kind kind = ADD;
+    string source, destination;     // airport codes; ADD may introduce new airports
+    string airline;
+    double est_time_hr = numeric_limits<double>::quiet_NaN();     // ADD / RETIME; NaN or < 0 = unusable
+    // ADD only
+    int airline_id = -1;
+    int stops = 0;
+    string equipment;
+    bool codeshare = false;
+};
 
-        while (!pq.empty()) {
-            pair<double, int> top = pq.top();
-            pq.pop();
-            double current_dist = top.first;
-            int current_node = top.second;
+// A collapsed route whose time changed; +inf means the pair had (or now has) no usable flight
+struct RouteChange {
+    int source, destination;
+    double old_time, new_time;
+};
 
-            if (visited_array[current_node]) {
-                continue;
-            }
-            visited_array[current_node] = true;
+// Outcome of FlightGraph::applyUpdates()
+struct UpdateReport {
+    size_t applied = 0;
+    size_t unmatched = 0;           // REMOVE / RETIME that named no existing flight
+    size_t flights_changed = 0;
+    bool restructured = false;      // routes appeared or vanished: direct, reverse and SCC rebuilt
+    bool geo_recalibrated = false;  // the A* bound was loosened (or rebuilt with new airports)
+    double ms = 0;
+    vector<RouteChange> routes;     // sorted by (source, destination)
+};
 
-            if (current_node == dest_idx) {
-                break;
-            }
+// Which flights a constrained search may use (FlightGraph::constrainedRoute). Every field
+// narrows the set; the default allows every flight. Flight attributes are precomputed as Flag
+// bits per flight (FlightGraph::edge_flags): exactly one alliance bit, at least one equipment bit.
+struct FlightFilter {
+    enum Flag : uint16_t {
+        STAR_ALLIANCE = 1 << 0,
+        ONEWORLD = 1 << 1,
+        SKYTEAM = 1 << 2,
+        NO_ALLIANCE = 1 << 3,
+        ANY_ALLIANCE = 0x000F,
+        WIDEBODY = 1 << 4,
+        NARROWBODY = 1 << 5,
+        REGIONAL_JET = 1 << 6,
+        TURBOPROP = 1 << 7,
+        OTHER_EQUIPMENT = 1 << 8,   // unknown or missing aircraft codes
+        ANY_EQUIPMENT = 0x01F0,
+        CODESHARE = 1 << 9,
+    };
+    uint16_t alliances = ANY_ALLIANCE;      // the carrier's alliance must be one of these
+    uint16_t equipment = ANY_EQUIPMENT;     // some aircraft on the flight must be one of these
+    bool allow_codeshare = true;
+    vector<string> airlines;                // carrier codes as in the route file; empty = any
+};
 
-            for (int i = 0; i < airports[current_node].edges.size(); i++) {
-                Edge current_edge = airports[current_node].edges[i];
-                int neighbor = current_edge.dest_index;
-                double edge_weight = current_edge.est_time_hr;
+// A FlightFilter resolved against one graph (FlightGraph::compileFilter): a flight passes on
+// three mask tests and, with an airline list, one bit lookup.
+struct FlightMask {
+    static constexpr bool active = true;
+    uint16_t alliances = FlightFilter::ANY_ALLIANCE;
+    uint16_t equipment = FlightFilter::ANY_EQUIPMENT;
+    uint16_t forbidden = 0;
+    vector<uint64_t> airlines;              // bitset over airline ids; empty = any
 
-                if (std::isnan(edge_weight) || edge_weight < 0) {
-                    continue;
-                }
+    bool allows(uint16_t flags, int airline) const {
+        return (flags & alliances) && (flags & equipment) && !(flags & forbidden) &&
+               (airlines.empty() || ((airlines[airline >> 6] >> (airline & 63)) & 1));
+    }
+};
 
-                // relaxation
-                if (!visited_array[neighbor] && distance_array[current_node] + edge_weight < distance_array[neighbor]) {
-                    distance_array[neighbor] = distance_array[current_node] + edge_weight;
-                    parent_array[neighbor] = current_node;
-                    pq.push(make_pair(distance_array[neighbor], neighbor));
-                }
+// The unfiltered policy: searches instantiated with it compile to the plain route loop
+struct AllFlights {
+    static constexpr bool active = false;
+};
+
+// Alliance bit of a carrier by its IATA code (membership as of 2025)
+static inline uint16_t allianceOf(string_view airline) {
+    static const string_view star[] = {"A3", "AC", "AI", "AV", "BR", "CA", "CM", "ET", "LH", "LO", "LX", "MS", "NH",
+                                       "NZ", "OS", "OU", "OZ", "SA", "SN", "SQ", "TG", "TK", "TP", "UA", "ZH"};
+    static const string_view oneworld[] = {"AA", "AS", "AT", "AY", "BA", "CX", "FJ", "IB", "JL", "MH", "QF", "QR",
+                                           "RJ", "UL", "WY"};
+    static const string_view skyteam[] = {"AF", "AM", "AR", "CI", "DL", "GA", "KE", "KL", "KQ", "ME", "MF", "MU",
+                                          "RO", "SK", "SV", "UX", "VN", "VS"};
+    for (string_view code : star)
+        if (code == airline)
+            return FlightFilter::STAR_ALLIANCE;
+    for (string_view code : oneworld)
+        if (code == airline)
+            return FlightFilter::ONEWORLD;
+    for (string_view code : skyteam)
+        if (code == airline)
+            return FlightFilter::SKYTEAM;
+    return FlightFilter::NO_ALLIANCE;
+}
+
+// Equipment bits of a route's space-separated IATA aircraft codes. Prefix rules, first match
+// wins; a code no rule knows (or an empty list) counts as OTHER_EQUIPMENT.
+static inline uint16_t equipmentClasses(string_view equipment) {
+    static const pair<string_view, uint16_t> rules[] = {
+        {"310", FlightFilter::WIDEBODY}, {"312", FlightFilter::WIDEBODY}, {"313", FlightFilter::WIDEBODY},
+        {"31", FlightFilter::NARROWBODY}, {"32", FlightFilter::NARROWBODY}, {"22", FlightFilter::NARROWBODY},
+        {"CS", FlightFilter::NARROWBODY}, {"71", FlightFilter::NARROWBODY}, {"72", FlightFilter::NARROWBODY},
+        {"73", FlightFilter::NARROWBODY}, {"75", FlightFilter::NARROWBODY}, {"M8", FlightFilter::NARROWBODY},
+        {"M9", FlightFilter::NARROWBODY}, {"D9", FlightFilter::NARROWBODY}, {"DC9", FlightFilter::NARROWBODY},
+        {"TU", FlightFilter::NARROWBODY}, {"T20", FlightFilter::NARROWBODY}, {"YK4", FlightFilter::NARROWBODY},
+        {"30", FlightFilter::WIDEBODY}, {"33", FlightFilter::WIDEBODY}, {"34", FlightFilter::WIDEBODY},
+        {"35", FlightFilter::WIDEBODY}, {"38", FlightFilter::WIDEBODY}, {"AB", FlightFilter::WIDEBODY},
+        {"74", FlightFilter::WIDEBODY}, {"76", FlightFilter::WIDEBODY}, {"77", FlightFilter::WIDEBODY},
+        {"78", FlightFilter::WIDEBODY}, {"D1", FlightFilter::WIDEBODY}, {"M1", FlightFilter::WIDEBODY},
+        {"L10", FlightFilter::WIDEBODY}, {"IL9", FlightFilter::WIDEBODY},
+        {"CR", FlightFilter::REGIONAL_JET}, {"ER", FlightFilter::REGIONAL_JET}, {"E7", FlightFilter::REGIONAL_JET},
+        {"E9", FlightFilter::REGIONAL_JET}, {"EMJ", FlightFilter::REGIONAL_JET}, {"100", FlightFilter::REGIONAL_JET},
+        {"F70", FlightFilter::REGIONAL_JET}, {"F28", FlightFilter::REGIONAL_JET}, {"14", FlightFilter::REGIONAL_JET},
+        {"AR", FlightFilter::REGIONAL_JET}, {"SU", FlightFilter::REGIONAL_JET}, {"YK2", FlightFilter::REGIONAL_JET},
+        {"FRJ", FlightFilter::REGIONAL_JET}, {"A81", FlightFilter::REGIONAL_JET},
+        {"AT", FlightFilter::TURBOPROP}, {"DH", FlightFilter::TURBOPROP}, {"SF", FlightFilter::TURBOPROP},
+        {"BE", FlightFilter::TURBOPROP}, {"J3", FlightFilter::TURBOPROP}, {"J4", FlightFilter::TURBOPROP},
+        {"F50", FlightFilter::TURBOPROP}, {"S20", FlightFilter::TURBOPROP}, {"L4T", FlightFilter::TURBOPROP},
+        {"CN", FlightFilter::TURBOPROP}, {"BN", FlightFilter::TURBOPROP}, {"EM2", FlightFilter::TURBOPROP},
+        {"EMB", FlightFilter::TURBOPROP}, {"PL", FlightFilter::TURBOPROP}, {"PA", FlightFilter::TURBOPROP},
+        {"SWM", FlightFilter::TURBOPROP}, {"D28", FlightFilter::TURBOPROP}, {"D38", FlightFilter::TURBOPROP},
+        {"AN", FlightFilter::TURBOPROP}, {"YN", FlightFilter::TURBOPROP},
+    };
+    uint16_t bits = 0;
+    while (!equipment.empty()) {
+        const size_t space = equipment.find(' ');
+        const string_view code = equipment.substr(0, space);
+        equipment = space == string_view::npos ? string_view() : equipment.substr(space + 1);
+        if (code.empty())
+            continue;
+        uint16_t cls = FlightFilter::OTHER_EQUIPMENT;
+        for (const auto& [prefix, bit] : rules) {
+            if (code.substr(0, prefix.size()) == prefix) {
+                cls = bit;
+                break;
             }
         }
+        bits |= cls;
+    }
+    return bits ? bits : (uint16_t)FlightFilter::OTHER_EQUIPMENT;
+}
 
-        if (distance_array[dest_idx] == numeric_limits<double>::infinity()) {
-            return {numeric_limits<double>::infinity(), empty_path};
-        }
+// Distances and parents from one source to every airport (FlightGraph::singleSourceAll)
+struct ShortestPathTree {
+    int source = -1;
+    vector<double> dist;    // +inf if unreachable
+    vector<int> parent;     // previous airport on the fastest route; -1 for the source / unreachable
+};
 
-        // build path
-        vector<string> path_result;
-        int current = dest_idx;
-        while (current != -1) {
-            path_result.push_back(airports[current].code);
-            current = parent_array[current];
-        }
-        reverse(path_result.begin(), path_result.end());
+//stores all nodes (airports) and their edges (flight to destination)
+//
+// Every airline flight is an edge in the compressed sparse row (CSR) edge_* arrays: the flights
+// out of airport u are [edge_offsets[u], edge_offsets[u + 1]). Many flights share a (src, dst)
+// pair (one per airline or codeshare), and only the fastest can matter to a search, so freeze()
+// also builds a collapsed routing view: one fwd_* "route" per pair with the minimum time, again
+// in CSR form, plus a back-reference to the flights behind it. The searches only touch fwd_dest
+// and fwd_weight; airline detail is expanded for a final path only (pathFlights()).
+// Loaders stage new edges and call freeze() to merge them into the CSR arrays. The arrays are
+// Columns, so openSnapshot() can point them straight into a mapped snapshot file.
+class FlightGraph {
+public:
+    vector<Airport> airports;       // All airports are stored in this vector
 
-        return {distance_array[dest_idx], path_result};
-    }
+    // Routing CSR (hot): one route per (src, dst) pair with at least one usable flight
+    Column<uint32_t> fwd_offsets;   // size airports.size() + 1
+    Column<int> fwd_dest;           // destination airport index per route
+    Column<double> fwd_weight;      // fastest est_time_hr among the route's flights
 
-    // bellman-ford algorithm
-    pair<double, vector<string>> bellmanFord(const string& source_code, const string& destination_code) const {
-        int source_idx = findAirportIndexByCode(source_code);
-        int dest_idx = findAirportIndexByCode(destination_code);
+    // Flights behind route r: edge ids fwd_edge_ids[fwd_edge_offsets[r] .. fwd_edge_offsets[r + 1])
+    Column<uint32_t> fwd_edge_offsets;
+    Column<uint32_t> fwd_edge_ids;
+    Column<uint32_t> fwd_best_flight;   // the flight that sets fwd_weight (first listed on a tie)
 
-        vector<string> empty_path;
-        if (source_idx < 0 || dest_idx < 0) {
-            return {numeric_limits<double>::infinity(), empty_path};
+    // (src, dst) -> route hash index, open addressing with linear probing. A slot holds
+    // key = src << 32 | dst (or DIRECT_EMPTY) and the route index.
+    static constexpr uint64_t DIRECT_EMPTY = ~0ULL;
+    Column<uint64_t> direct_keys;   // power-of-two size
+    Column<uint32_t> direct_routes;
+
+    // Every airline flight (cold), in CSR form by source airport. edge_weight is +inf for
+    // flights without a usable (non-negative) time.
+    Column<uint32_t> edge_offsets;  // size airports.size() + 1
+    Column<int> edge_dest;
+    Column<double> edge_weight;
+    Column<int> edge_airline;       // id into airline_names
+    Column<int> edge_airline_id;    // OpenFlights airline ID, -1 if missing
+    Column<int> edge_equipment;     // id into equipment_names
+    Column<uint8_t> edge_stops;     // clamped to 255
+    Column<uint8_t> edge_codeshare;
+    Column<uint16_t> edge_flags;    // FlightFilter::Flag bits: alliance, equipment class, codeshare
+    StringPool airline_names;
+    StringPool equipment_names;
+
+    // Reverse (incoming) routing CSR, built by freeze(): the routes into airport v are
+    // [rev_offsets[v], rev_offsets[v + 1]); rev_edge maps each back to its fwd_* index.
+    Column<uint32_t> rev_offsets;
+    Column<int> rev_src;            // source airport index per incoming route
+    Column<double> rev_weight;      // copy of fwd_weight, kept here for locality
+    Column<uint32_t> rev_edge;
+
+    // Geography for goal-directed search (built by freeze())
+    Column<GeoPoint> airport_geo;   // per airport
+    Column<GeoBound> geo_bound;     // single element
+
+    // Strongly connected components of the routes (built by freeze()). Components are numbered
+    // in Tarjan completion order, which is reverse topological: a route between two components
+    // always leads from the higher id to the lower. Components with a route to or from another
+    // component get a row in scc_reach, the transitive closure of the component DAG as bitsets
+    // ([row * scc_reach_words + word]); it is left empty when there are more than
+    // SCC_REACH_MAX_ROWS such components.
+    static constexpr size_t SCC_REACH_MAX_ROWS = 16384;    // 32 MiB of closure
+    Column<int> scc_id;             // per airport
+    Column<uint32_t> scc_size;      // airports per component
+    Column<int> scc_dag_row;        // per component: row in scc_reach, -1 if it has no such route
+    Column<uint64_t> scc_reach;
+
+    // Phase timings of the most recent loadFromEstimatedCSV / loadAirportsDat call
+    LoadPhaseTimes routes_load_times;
+    LoadPhaseTimes airports_load_times;
+    LoadPhaseTimes snapshot_load_times;
+
+    // read the data from the file to create all the nodes and edges
+    // A row is skipped only if a source or destination CODE is missing.
+    // The file is mmap'ed and parsed in parallel chunks (num_threads <= 0 means one per core);
+    // rows are then merged in file order, so the resulting graph does not depend on threading.
+    bool loadFromEstimatedCSV(const string& routes_csv_path, int num_threads = 0) {
+        LoadPhaseTimes& times = routes_load_times;
+        times = LoadPhaseTimes();
+
+        auto phase_start = chrono::steady_clock::now();
+        MappedFile file;
+        if (!file.open(routes_csv_path, true)) {
+            cerr << "Error: cannot open " << routes_csv_path << "\n";
+            return false;
         }
+        string_view data = file.view();
+        times.map_ms = msSince(phase_start);
 
-        int num_airports = airports.size();
-        vector<double> distance_array(num_airports, numeric_limits<double>::infinity());
-        vector<int> parent_array(num_airports, -1);
+        //return if the file is empty
+        if (data.empty()) {
+            cerr << "Error: CSV file is empty.\n";
+            return false;
+        }
+        size_t header_end = data.find('\n');
+        string_view body = (header_end == string_view::npos) ? string_view() : data.substr(header_end + 1);
 
-        distance_array[source_idx] = 0.0;
+        struct RouteRow {
+            string_view airline, src_code, dst_code, equipment;
+            int airline_id, src_id, dst_id, stops;
+            bool codeshare;
+            double est_time_hr;
+        };
 
-        // relax edges v-1 times
-        for (int iteration = 0; iteration < num_airports - 1; iteration++) {
-            bool any_update = false;
+        phase_start = chrono::steady_clock::now();
+        auto chunks = parseLinesParallel<RouteRow>(body, num_threads,
+            [](string_view, const vector<string_view>& cols, ParsedChunk<RouteRow>& chunk) {
+                auto col = [&](size_t i) { return i < cols.size() ? cols[i] : string_view(); };
 
-            for (int current_node = 0; current_node < num_airports; current_node++) {
-                if (distance_array[current_node] == numeric_limits<double>::infinity()) {
-                    continue;
+                // Require codes; IDs are optional (\N are still read)
+                if (missing(col(2)) || missing(col(4))) {
+                    chunk.skipped++;
+                    return;
                 }
 
-                for (int j = 0; j < airports[current_node].edges.size(); j++) {
-                    Edge current_edge = airports[current_node].edges[j];
-                    int neighbor_node = current_edge.dest_index;
-                    double edge_weight = current_edge.est_time_hr;
+                // Parse values
+                const string_view codeshare_s = col(6);
+                RouteRow r;
+                r.airline     = col(0);
+                r.airline_id  = parseIntOr(col(1), -1);
+                r.src_code    = col(2);
+                r.src_id      = parseIntOr(col(3), -1);
+                r.dst_code    = col(4);
+                r.dst_id      = parseIntOr(col(5), -1);
+                r.codeshare   = (!missing(codeshare_s) && (codeshare_s == "Y" || codeshare_s == "y"));
+                r.stops       = parseIntOr(col(7), 0);
+                r.equipment   = col(8);
+                r.est_time_hr = parseDoubleOr(col(9), numeric_limits<double>::quiet_NaN());
+                chunk.rows.push_back(r);
+            });
+        times.parse_ms = msSince(phase_start);
+        times.threads = (int)chunks.size();
 
-                    if (std::isnan(edge_weight) || edge_weight < 0) {
-                        continue;
-                    }
+        phase_start = chrono::steady_clock::now();
+        for (const auto& chunk : chunks) {
+            times.skipped += chunk.skipped;
+            for (const RouteRow& r : chunk.rows) {
+                // Create/fetch airports by code
+                const int sidx = getOrCreateAirportIndexByCode(r.src_code);
+                const int didx = getOrCreateAirportIndexByCode(r.dst_code);
 
-                    if (distance_array[current_node] + edge_weight < distance_array[neighbor_node]) {
-                        distance_array[neighbor_node] = distance_array[current_node] + edge_weight;
-                        parent_array[neighbor_node] = current_node;
-                        any_update = true;
-                    }
-                }
-            }
-            if (!any_update) {
-                break;
+                // Update airport IDs if present and not set yet
+                if (r.src_id >= 0 && airports[sidx].openflights_id < 0)
+                    airports[sidx].openflights_id = r.src_id;
+                if (r.dst_id >= 0 && airports[didx].openflights_id < 0)
+                    airports[didx].openflights_id = r.dst_id;
+
+                // Stage the directed edge; freeze() moves it into the CSR arrays
+                stageEdge(sidx, didx, airline_names.intern(r.airline), r.airline_id, r.stops,
+                          equipment_names.intern(r.equipment), r.codeshare, r.est_time_hr);
+                times.added++;
             }
         }
+        times.rows = times.added + times.skipped;
+        times.intern_ms = msSince(phase_start);
 
-        if (distance_array[dest_idx] == numeric_limits<double>::infinity()) {
-            return {numeric_limits<double>::infinity(), empty_path};
+        phase_start = chrono::steady_clock::now();
+        freeze();
+        times.build_ms = msSince(phase_start);
+
+        return times.added > 0;
+    }
+
+    bool loadAirportsDat(const std::string& path, int num_threads = 0) {
+        LoadPhaseTimes& times = airports_load_times;
+        times = LoadPhaseTimes();
+
+        auto phase_start = chrono::steady_clock::now();
+        MappedFile file;
+        if (!file.open(path, true))
+        {
+            std::cerr << "Error: cannot open " << path << "\n";
+            return false;
         }
+        times.map_ms = msSince(phase_start);
 
-        // build path
-        vector<string> path_result;
-        int current = dest_idx;
-        while (current != -1) {
-            path_result.push_back(airports[current].code);
-            current = parent_array[current];
+        struct AirportRow {
+            string_view code;
+            double lat, lon;
+        };
+
+        phase_start = chrono::steady_clock::now();
+        auto chunks = parseLinesParallel<AirportRow>(file.view(), num_threads,
+            [](string_view, const vector<string_view>& cols, ParsedChunk<AirportRow>& chunk) {
+                if (cols.size() < 8 || missing(cols[4])) {
+                    chunk.skipped++;
+                    return;
+                }
+                const double nan = numeric_limits<double>::quiet_NaN();
+                chunk.rows.push_back({cols[4], parseDoubleOr(cols[6], nan), parseDoubleOr(cols[7], nan)});
+            });
+        times.parse_ms = msSince(phase_start);
+        times.threads = (int)chunks.size();
+
+        phase_start = chrono::steady_clock::now();
+        for (const auto& chunk : chunks) {
+            times.skipped += chunk.skipped;
+            for (const AirportRow& r : chunk.rows) {
+                int idx = getOrCreateAirportIndexByCode(r.code);
+                // \N or unparsable coordinates leave the airport without a position, like one
+                // missing from the file, rather than placing it at (0,0)
+                const bool has_coords = isfinite(r.lat) && isfinite(r.lon);
+                airports[idx].latitude = has_coords ? r.lat : 0.0;
+                airports[idx].longitude = has_coords ? r.lon : 0.0;
+                airports[idx].has_coords = has_coords;
+                times.added++;
+            }
         }
-        reverse(path_result.begin(), path_result.end());
+        times.rows = times.added + times.skipped;
+        times.intern_ms = msSince(phase_start);
 
-        return {distance_array[dest_idx], path_result};
+        phase_start = chrono::steady_clock::now();
+        freeze();
+        times.build_ms = msSince(phase_start);
+        return true;
     }
 
-private:
-    // Maps airport_CODE -> index in Airports vector
-    unordered_map<string,int> code_to_index;
-
-    // Return existing airport index by CODE, or create a new node.
-    int getOrCreateAirportIndexByCode(const string& code) {
-        auto it = code_to_index.find(code);
-        if (it != code_to_index.end()) //if found
-            return it->second;
+    // Prints the phase timings of both loaders
+    void printLoadReport(ostream& out = cout) const {
+        if (airports_load_times.threads > 0)
+            airports_load_times.print(out, "airports.dat");
+        if (routes_load_times.threads > 0)
+            routes_load_times.print(out, "routes csv");
+        if (snapshot_load_times.rows > 0)
+            snapshot_load_times.print(out, "snapshot");
+    }
 
-        //if not in the vector then add it
-        Airport ap;
-        ap.code = code;
+    // Writes the loaded graph to a binary snapshot (see snapshot.h). The size and mtime of the
+    // source files are recorded so openSnapshot() can tell when the snapshot is stale.
+    bool saveSnapshot(const string& snapshot_path, const string& routes_csv_path,
+                      const string& airports_dat_path = "") const {
+        vector<SnapshotAirport> records(airports.size());
+        vector<string> codes(airports.size());
+        for (size_t i = 0; i < airports.size(); i++) {
+            codes[i] = airports[i].code;
+            SnapshotAirport& r = records[i];
+            memset(&r, 0, sizeof(r));
+            memcpy(r.code, airports[i].code.data(), min(airports[i].code.size(), sizeof(r.code) - 1));
+            r.openflights_id = airports[i].openflights_id;
+            r.latitude = airports[i].latitude;
+            r.longitude = airports[i].longitude;
+            r.flags = airports[i].has_coords ? SNAPSHOT_AIRPORT_HAS_COORDS : 0;
+        }
 
-        const int idx = (int)airports.size();
-        airports.push_back(std::move(ap));
-        code_to_index[code] = idx;
-        return idx;
+        SnapshotWriter writer;
+        writer.add(SEC_AIRPORTS, records.data(), records.size());
+        writer.addStrings(SEC_AIRPORT_CODES, codes);
+        writer.addStrings(SEC_AIRLINE_NAMES, airline_names.names);
+        writer.addStrings(SEC_EQUIPMENT_NAMES, equipment_names.names);
+        forEachColumn([&](uint32_t id, const auto& col) {
+            writer.add(id, col.data(), col.size());
+        });
+        return writer.write(snapshot_path, SnapshotSourceStamp::of(routes_csv_path),
+                           SnapshotSourceStamp::of(airports_dat_path));
     }
 
-    // Find airport index by CODE; -1 if not found.
-    int findAirportIndexByCode(const string& code) const {
-        auto it = code_to_index.find(code);
-        if (it != code_to_index.end())
-            return it->second;
-        return -1;
+    // Maps a snapshot and points the graph's columns into it. Returns false (leaving the graph
+    // untouched) if the file is missing, corrupt, from another version, or older than the given
+    // source files. Edge arrays are used in place; only the small airport table, code index and
+    // string pools are rebuilt. The mapping is shared by copies of this graph and by every other
+    // process that opens the same snapshot.
+    bool openSnapshot(const string& snapshot_path, const string& routes_csv_path,
+                      const string& airports_dat_path = "", bool verify_payload = false) {
+        auto start = chrono::steady_clock::now();
+        auto file = make_shared<MappedFile>();
+        if (!file->open(snapshot_path))
+            return false;
+        SnapshotReader reader;
+        if (!reader.open(file->data(), file->size(), verify_payload))
+            return false;
+        if (!(reader.header->routes_source == SnapshotSourceStamp::of(routes_csv_path)) ||
+            !(reader.header->airports_source == SnapshotSourceStamp::of(airports_dat_path)))
+            return false;
+
+        size_t num_airports = 0;
+        const SnapshotAirport* records = reader.get<SnapshotAirport>(SEC_AIRPORTS, num_airports);
+        const vector<string> codes = reader.getStrings(SEC_AIRPORT_CODES);
+        if (!records || codes.size() != num_airports)
+            return false;
+        bool complete = true;
+        forEachColumn([&](uint32_t id, auto& col) {
+            using T = typename remove_reference_t<decltype(col)>::value_type;
+            size_t n = 0;
+            complete = complete && reader.get<T>(id, n) != nullptr;
+        });
+        if (!complete || !snapshotColumnsFit(reader, num_airports))
+            return false;
+        const double map_ms = msSince(start);
+
+        start = chrono::steady_clock::now();
+        *this = FlightGraph();
+        snapshot_file = file;
+        forEachColumn([&](uint32_t id, auto& col) {
+            using T = typename remove_reference_t<decltype(col)>::value_type;
+            size_t n = 0;
+            const T* p = reader.get<T>(id, n);
+            col.mapTo(p, n);
+        });
+
+        airports.resize(num_airports);
+        for (size_t i = 0; i < num_airports; i++) {
+            const SnapshotAirport& r = records[i];
+            airports[i].code = codes[i];
+            airports[i].openflights_id = r.openflights_id;
+            airports[i].latitude = r.latitude;
+            airports[i].longitude = r.longitude;
+            airports[i].has_coords = (r.flags & SNAPSHOT_AIRPORT_HAS_COORDS) != 0;
+        }
+        code_index.attach(airports);
+        attachSccIndex();
+        for (const string& name : reader.getStrings(SEC_AIRLINE_NAMES))
+            airline_names.intern(name);
+        for (const string& name : reader.getStrings(SEC_EQUIPMENT_NAMES))
+            equipment_names.intern(name);
+
+        snapshot_load_times.map_ms = map_ms;
+        snapshot_load_times.build_ms = msSince(start);
+        snapshot_load_times.rows = edgeCount();
+        snapshot_load_times.added = edgeCount();
+        return true;
     }
-};
\ No newline at end of file
+
+    // Opens snapshot_path if it matches the source files; otherwise loads the CSV files and
+    // (re)writes the snapshot for the next start. airports_dat_path may be empty.
+    bool loadWithSnapshot(const string& snapshot_path, const string& routes_csv_path,
+                          const string& airports_dat_path = "") {
+        if (openSnapshot(snapshot_path, routes_csv_path, airports_dat_path))
+            return true;
+        if (!airports_dat_path.empty() && !loadAirportsDat(airports_dat_path))
+            return false;
+        if (!loadFromEstimatedCSV(routes_csv_path))
+            return false;
+        if (!saveSnapshot(snapshot_path, routes_csv_path, airports_dat_path))
+            cerr << "Warning: could not write snapshot " << snapshot_path << "\n";
+        return true;
+    }
+
+    // Merges staged edges into the CSR arrays and rebuilds the indexes derived from them.
+    // Called by the loaders.
+    void freeze() {
+        mergeStagedEdges();
+        buildDerivedIndexes();
+    }
+
+    // Renumbers the airports by `strategy` and rebuilds the CSR arrays and every derived index to
+    // match. Codes keep resolving through code_index; a caller holding airport indices translates
+    // them with the returned map (old index -> new index). Flights keep their order within an
+    // airport and distances do not change, but a tie between equally fast routes may now be
+    // broken the other way. Indexes built over the graph before
+    // (ContractionHierarchy, LandmarkIndex, HubLabelIndex) must be rebuilt.
+    vector<int> reorder(AirportOrder strategy) {
+        if (!staged_src.empty())
+            freeze();
+        const int num_airports = airports.size();
+        const vector<int> order = airportOrder(strategy);      // new index -> old index
+        vector<int> new_index(num_airports);
+        for (int i = 0; i < num_airports; i++)
+            new_index[order[i]] = i;
+
+        const size_t num_edges = edgeCount();
+        vector<Airport> moved(num_airports);
+        vector<uint32_t> offsets(num_airports + 1, 0);
+        vector<int> dest, airline, airline_id, equipment;
+        vector<double> weight;
+        vector<uint8_t> stops, codeshare;
+        dest.reserve(num_edges);
+        airline.reserve(num_edges);
+        airline_id.reserve(num_edges);
+        equipment.reserve(num_edges);
+        weight.reserve(num_edges);
+        stops.reserve(num_edges);
+        codeshare.reserve(num_edges);
+        for (int i = 0; i < num_airports; i++) {
+            const int u = order[i];
+            moved[i] = std::move(airports[u]);
+            for (uint32_t e = edge_offsets[u]; e < edge_offsets[u + 1]; e++) {
+                dest.push_back(new_index[edge_dest[e]]);
+                weight.push_back(edge_weight[e]);
+                airline.push_back(edge_airline[e]);
+                airline_id.push_back(edge_airline_id[e]);
+                equipment.push_back(edge_equipment[e]);
+                stops.push_back(edge_stops[e]);
+                codeshare.push_back(edge_codeshare[e]);
+            }
+            offsets[i + 1] = (uint32_t)dest.size();
+        }
+
+        airports = std::move(moved);
+        edge_offsets = std::move(offsets);
+        edge_dest = std::move(dest);
+        edge_weight = std::move(weight);
+        edge_airline = std::move(airline);
+        edge_airline_id = std::move(airline_id);
+        edge_equipment = std::move(equipment);
+        edge_stops = std::move(stops);
+        edge_codeshare = std::move(codeshare);
+
+        code_index = AirportCodeIndex();
+        code_index.reserve(num_airports);
+        for (int i = 0; i < num_airports; i++)
+            code_index.insert(airports[i].code, i);
+        buildDerivedIndexes();
+        return new_index;
+    }
+
+    // Applies a batch of flight changes in place, without a reload. Retimes patch the route and
+    // reverse weights directly; adds and removes rewrite the flight table and the route view
+    // (O(flights), no parsing), and the direct, reverse and SCC indexes are rebuilt only if a
+    // (source, destination) pair gained its first or lost its last usable flight. The A* bound is
+    // loosened just enough if a faster route breaks it, without a recalibration. The changed routes are returned so
+    // caches over this graph can repair themselves (SptCache::repair()).
+    //
+    // The update is in memory only: a snapshot saved afterwards still carries the CSV stamps.
+    // Indexes built over the graph (ContractionHierarchy, LandmarkIndex, HubLabelIndex) must be
+    // rebuilt.
+    UpdateReport applyUpdates(span<const FlightUpdate> updates) {
+        auto start = chrono::steady_clock::now();
+        UpdateReport report;
+        if (!staged_src.empty())
+            freeze();
+        const size_t old_airports = airports.size();
+        unordered_map<uint64_t, double> before;         // touched pair -> route time before
+        auto touch = [&](int u, int v) {
+            before.try_emplace(directKey(u, v), routeTime(u, v));
+        };
+
+        // flights to remove, sized on first use: the flight table, then the flights this batch staged
+        vector<uint8_t> drop;
+        auto dropFlight = [&](size_t f) {
+            if (drop.size() <= f)
+                drop.resize(edgeCount() + staged_src.size(), 0);
+            drop[f] = 1;
+        };
+        auto dropped = [&](size_t f) { return f < drop.size() && drop[f]; };
+        bool regroup = false;
+        for (const FlightUpdate& up : updates) {
+            if (up.kind == FlightUpdate::ADD) {
+                const int u = getOrCreateAirportIndexByCode(up.source);
+                const int v = getOrCreateAirportIndexByCode(up.destination);
+                touch(u, v);
+                stageEdge(u, v, airline_names.intern(up.airline), up.airline_id, up.stops,
+                          equipment_names.intern(up.equipment), up.codeshare, up.est_time_hr);
+                report.applied++;
+                report.flights_changed++;
+                continue;
+            }
+            const int u = findAirportIndexByCode(up.source);
+            const int v = findAirportIndexByCode(up.destination);
+            auto airline = airline_names.ids.find(up.airline);
+            size_t matched = 0;
+            if (u >= 0 && v >= 0 && u < (int)old_airports && airline != airline_names.ids.end()) {
+                for (uint32_t e = edge_offsets[u]; e < edge_offsets[u + 1]; e++) {
+                    if (edge_dest[e] != v || edge_airline[e] != airline->second || dropped(e))
+                        continue;
+                    if (up.kind == FlightUpdate::REMOVE) {
+                        dropFlight(e);
+                    } else {
+                        const double time = usableTime(up.est_time_hr);
+                        // a flight becoming (un)usable changes which flights the route lists
+                        regroup |= std::isinf(time) != std::isinf(edge_weight[e]);
+                        edge_weight.mutableData()[e] = time;
+                    }
+                    matched++;
+                }
+            }
+            // flights added earlier in this batch (staged, merged below)
+            if (u >= 0 && v >= 0 && airline != airline_names.ids.end()) {
+                for (size_t i = 0; i < staged_src.size(); i++) {
+                    if (staged_src[i] != u || staged_dest[i] != v || staged_airline[i] != airline->second ||
+                        dropped(edgeCount() + i))
+                        continue;
+                    if (up.kind == FlightUpdate::REMOVE)
+                        dropFlight(edgeCount() + i);
+                    else
+                        staged_weight[i] = usableTime(up.est_time_hr);
+                    matched++;
+                }
+            }
+            if (matched == 0) {
+                report.unmatched++;
+                continue;
+            }
+            touch(u, v);
+            report.applied++;
+            report.flights_changed += matched;
+        }
+
+        // new fastest time per touched pair, from the flight table as it is now
+        auto fastest = [&](int u, int v) {
+            double best = numeric_limits<double>::infinity();
+            if (u < (int)old_airports)
+                for (uint32_t e = edge_offsets[u]; e < edge_offsets[u + 1]; e++)
+                    if (edge_dest[e] == v && !dropped(e))
+                        best = min(best, edge_weight[e]);
+            return best;
+        };
+        bool rebuild_routes = airports.size() != old_airports || !staged_src.empty() || !drop.empty() || regroup;
+        if (!rebuild_routes) {
+            for (const auto& [key, old_time] : before) {
+                // a pair gaining its first or losing its last usable flight changes the structure
+                if (std::isinf(old_time) != std::isinf(fastest(key >> 32, (uint32_t)key))) {
+                    rebuild_routes = true;
+                    break;
+                }
+            }
+        }
+
+        if (!rebuild_routes) {
+            double* fwd = fwd_weight.mutableData();
+            double* rev = rev_weight.mutableData();
+            uint32_t* best_flight = fwd_best_flight.mutableData();
+            for (const auto& [key, old_time] : before) {
+                const int u = key >> 32, v = (uint32_t)key;
+                const int r = findRoute(u, v);
+                if (r < 0)
+                    continue;       // still no usable flight
+                best_flight[r] = fwd_edge_ids[fwd_edge_offsets[r]];
+                for (uint32_t k = fwd_edge_offsets[r]; k < fwd_edge_offsets[r + 1]; k++)
+                    if (edge_weight[fwd_edge_ids[k]] < edge_weight[best_flight[r]])
+                        best_flight[r] = fwd_edge_ids[k];
+                fwd[r] = edge_weight[best_flight[r]];
+                for (uint32_t i = rev_offsets[v]; i < rev_offsets[v + 1]; i++)
+                    if (rev_edge[i] == (uint32_t)r)
+                        rev[i] = fwd[r];
+            }
+        } else if (airports.size() != old_airports) {
+            mergeStagedEdges(drop);
+            buildDerivedIndexes();
+            report.restructured = report.geo_recalibrated = true;
+        } else {
+            mergeStagedEdges(drop);
+            buildFlightFlags();
+            const vector<uint32_t> old_offsets = fwd_offsets.toVector();
+            const vector<int> old_dest = fwd_dest.toVector();
+            buildRouteIndex();
+            if (fwd_dest.size() != old_dest.size() || !equal(old_offsets.begin(), old_offsets.end(), fwd_offsets.begin()) ||
+                !equal(old_dest.begin(), old_dest.end(), fwd_dest.begin())) {
+                buildDirectIndex();
+                buildReverseIndex();
+                buildSccIndex();
+                report.restructured = true;
+            } else {
+                double* rev = rev_weight.mutableData();
+                for (size_t i = 0; i < rev_edge.size(); i++)
+                    rev[i] = fwd_weight[rev_edge[i]];
+            }
+        }
+
+        // without any coordinates the bound is never consulted and every chain search would
+        // walk the whole graph
+        const bool geo_rebuilt = report.geo_recalibrated ||
+                                 none_of(airport_geo.begin(), airport_geo.end(), [](const GeoPoint& p) { return p.known(); });
+        for (const auto& [key, old_time] : before) {
+            const int u = key >> 32, v = (uint32_t)key;
+            const double new_time = routeTime(u, v);
+            if (new_time == old_time)
+                continue;
+            report.routes.push_back({u, v, old_time, new_time});
+            // the bound holds segment by segment, so only a faster route can break it: flatten it
+            // under the segments through this route (chains over airports without coordinates
+            // count as one segment, as in buildGeoIndex())
+            if (geo_rebuilt || new_time >= old_time || geo_bound.empty())
+                continue;
+            for (const auto& [a, to_u] : geoChainEnds(u, false))
+                for (const auto& [b, from_v] : geoChainEnds(v, true))
+                    report.geo_recalibrated |= loosenGeoBound(to_u + new_time + from_v,
+                                                              greatCircleMiles(airport_geo[a], airport_geo[b]));
+        }
+        sort(report.routes.begin(), report.routes.end(), [](const RouteChange& a, const RouteChange& b) {
+            return a.source != b.source ? a.source < b.source : a.destination < b.destination;
+        });
+        report.ms = msSince(start);
+        return report;
+    }
+
+    // Time of the direct route u -> v, +inf if there is none. O(1).
+    double routeTime(int u, int v) const {
+        const int r = findRoute(u, v);
+        return r < 0 ? numeric_limits<double>::infinity() : fwd_weight[r];
+    }
+
+    // Number of airline flights
+    size_t edgeCount() const {
+        return edge_dest.size();
+    }
+
+    // Number of collapsed (src, dst) routes
+    size_t routeCount() const {
+        return fwd_dest.size();
+    }
+
+    // False only if no route from s to t can exist; O(1). Exact unless the component DAG was too
+    // large for the closure table, in which case some unreachable pairs still answer true.
+    bool mayReach(int s, int t) const {
+        if (s == t || scc_id.empty())
+            return true;
+        const int a = scc_id[s], b = scc_id[t];
+        if (a == b)
+            return true;
+        if (a < b)
+            return false;
+        const int ra = scc_dag_row[a], rb = scc_dag_row[b];
+        if (ra < 0 || rb < 0)
+            return false;
+        if (scc_reach_words == 0)
+            return true;
+        return (scc_reach[(size_t)ra * scc_reach_words + rb / 64] >> (rb % 64)) & 1;
+    }
+
+    size_t sccCount() const {
+        return scc_size.size();
+    }
+
+    // Component of airport idx and its number of airports
+    int sccOf(int idx) const {
+        return scc_id[idx];
+    }
+
+    size_t sccSize(int component) const {
+        return scc_size[component];
+    }
+
+    // Component with the most airports (-1 if there are no airports)
+    int largestScc() const {
+        int best = -1;
+        for (int c = 0; c < (int)scc_size.size(); c++)
+            if (best < 0 || scc_size[c] > scc_size[best])
+                best = c;
+        return best;
+    }
+
+    // Number of flights out of airport idx
+    size_t outDegree(int idx) const {
+        return edge_offsets[idx + 1] - edge_offsets[idx];
+    }
+
+    // Route index for the direct src -> dst pair, or -1 if no usable flight exists. O(1).
+    int findRoute(int src, int dst) const {
+        if (direct_keys.empty() || src < 0 || dst < 0)
+            return -1;
+        const uint64_t key = directKey(src, dst);
+        const size_t mask = direct_keys.size() - 1;
+        for (size_t slot = directHash(key) & mask;; slot = (slot + 1) & mask) {
+            if (direct_keys[slot] == key)
+                return (int)direct_routes[slot];
+            if (direct_keys[slot] == DIRECT_EMPTY)
+                return -1;
+        }
+    }
+
+    // Hash of the routing arrays. Indexes built from this graph (contraction hierarchy, ...)
+    // store it so a saved index is never used with a different graph.
+    uint64_t fingerprint() const {
+        uint64_t h = snapshotChecksum(reinterpret_cast<const char*>(fwd_offsets.data()), fwd_offsets.size() * sizeof(uint32_t));
+        h = snapshotChecksum(reinterpret_cast<const char*>(fwd_dest.data()), fwd_dest.size() * sizeof(int), h);
+        h = snapshotChecksum(reinterpret_cast<const char*>(fwd_weight.data()), fwd_weight.size() * sizeof(double), h);
+        return h;
+    }
+
+    // Rebuilds the full record for flight e (for printing or expanding a final path)
+    Edge edgeDetail(uint32_t e) const {
+        Edge out;
+        out.dest_index  = edge_dest[e];
+        out.airline     = airline_names.name(edge_airline[e]);
+        out.airline_id  = edge_airline_id[e];
+        out.stops       = edge_stops[e];
+        out.equipment   = equipment_names.name(edge_equipment[e]);
+        out.codeshare   = edge_codeshare[e] != 0;
+        out.est_time_hr = std::isinf(edge_weight[e]) ? numeric_limits<double>::quiet_NaN() : edge_weight[e];
+        return out;
+    }
+
+    // Airline detail for a path of airport indices: for each hop, the fastest flight behind its
+    // route that the filter allows (the first one listed on a tie). Empty if some hop has none.
+    template <class Filter = AllFlights>
+    vector<Edge> pathFlights(const vector<int>& path, const Filter& filter = Filter()) const {
+        vector<Edge> flights;
+        for (size_t i = 0; i + 1 < path.size(); i++) {
+            const int r = findRoute(path[i], path[i + 1]);
+            const int64_t best = r < 0 ? -1 : routeFlight(r, filter);
+            if (best < 0)
+                return {};
+            flights.push_back(edgeDetail((uint32_t)best));
+        }
+        return flights;
+    }
+
+    // Resolves a filter's airline codes against this graph. Codes the graph does not know match
+    // no flight.
+    FlightMask compileFilter(const FlightFilter& filter) const {
+        FlightMask mask;
+        mask.alliances = filter.alliances & FlightFilter::ANY_ALLIANCE;
+        mask.equipment = filter.equipment & FlightFilter::ANY_EQUIPMENT;
+        mask.forbidden = filter.allow_codeshare ? 0 : FlightFilter::CODESHARE;
+        if (!filter.airlines.empty()) {
+            mask.airlines.assign(max<size_t>(1, (airline_names.names.size() + 63) / 64), 0);
+            for (const string& code : filter.airlines) {
+                auto it = airline_names.ids.find(code);
+                if (it != airline_names.ids.end())
+                    mask.airlines[it->second >> 6] |= 1ULL << (it->second & 63);
+            }
+        }
+        return mask;
+    }
+
+    // Time of route r under a filter: fwd_weight if its fastest flight passes (always, for
+    // AllFlights, which compiles to the plain load), otherwise the fastest flight that does
+    // (+inf if none)
+    template <class Filter>
+    double routeWeight(uint32_t r, const Filter& filter) const {
+        if constexpr (!Filter::active) {
+            return fwd_weight[r];
+        } else {
+            const uint32_t best = fwd_best_flight[r];
+            if (filter.allows(edge_flags[best], edge_airline[best]))
+                return fwd_weight[r];
+            const int64_t e = routeFlight(r, filter);
+            return e < 0 ? numeric_limits<double>::infinity() : edge_weight[e];
+        }
+    }
+
+    // Fastest flight behind route r that the filter allows, -1 if none
+    template <class Filter>
+    int64_t routeFlight(uint32_t r, const Filter& filter) const {
+        if constexpr (!Filter::active) {
+            return fwd_best_flight[r];
+        } else {
+            int64_t best = -1;
+            for (uint32_t k = fwd_edge_offsets[r]; k < fwd_edge_offsets[r + 1]; k++) {
+                const uint32_t e = fwd_edge_ids[k];
+                if (filter.allows(edge_flags[e], edge_airline[e]) && (best < 0 || edge_weight[e] < edge_weight[best]))
+                    best = e;
+            }
+            return best;
+        }
+    }
+
+    // Prints up to `max_edges` outgoing edges for a given airport code for test purposes
+    void printSampleEdges(const string& code, size_t max_edges) const {
+        const int idx = findAirportIndexByCode(code);
+        if (idx < 0) {
+            cout << "Airport not found: " << code << "\n";
+            return;
+        }
+        const Airport& A = airports[idx];
+        cout << "Airport " << A.code
+             << " Airline_ID=" << A.openflights_id
+             << " — # of outgoing edges: " << outDegree(idx) << "\n";
+
+        for (uint32_t i = edge_offsets[idx]; i < edge_offsets[idx + 1] && i - edge_offsets[idx] < max_edges; ++i) {
+            const Edge e = edgeDetail(i);
+            const Airport& B = airports[e.dest_index];
+            cout << "  -> " << B.code
+                 << "  airline=" << e.airline
+                 << "  ID=" << e.airline_id
+                 << "  stops=" << e.stops
+                 << "  equip=" << e.equipment
+                 << "  codeshare=" << (e.codeshare ? "Y" : "N")
+                 << fixed << setprecision(2)
+                 << "  est_time_hr=" << (std::isnan(e.est_time_hr) ? -1.0 : e.est_time_hr)
+                 << "\n";
+        }
+    }
+
+    // returns the fastest direct time from src->dst among parallel edges; +inf if either code
+    // is unknown or there is no usable direct flight. O(1) through the route index.
+    double getFastestDirectTime(const string& src_code, const string& dst_code) const {
+        const int r = findRoute(findAirportIndexByCode(src_code), findAirportIndexByCode(dst_code));
+        return r < 0 ? numeric_limits<double>::infinity() : fwd_weight[r];
+    }
+
+
+    // Find airport index by CODE; -1 if not found.
+    int findAirportIndexByCode(string_view code) const {
+        return code_index.find(code);
+    }
+
+    // dijkstra's algorithm
+    pair<double, vector<string>> dijkstra(const string& source_code, const string& destination_code) const {
+        return dijkstra(source_code, destination_code, QueryWorkspace::forThisThread());
+    }
+
+    pair<double, vector<string>> dijkstra(const string& source_code, const string& destination_code,
+                                          QueryWorkspace& ws) const {
+        int source_idx = findAirportIndexByCode(source_code);
+        int dest_idx = findAirportIndexByCode(destination_code);
+
+        vector<string> empty_path;
+        if (source_idx < 0 || dest_idx < 0) {
+            return {numeric_limits<double>::infinity(), empty_path};
+        }
+
+        double dist = dijkstra(source_idx, dest_idx, ws);
+        if (dist == numeric_limits<double>::infinity()) {
+            return {numeric_limits<double>::infinity(), empty_path};
+        }
+        return {dist, buildPath(ws, dest_idx)};
+    }
+
+    // Answers every (source, destination) pair with dijkstra(). Pairs are spread over
+    // num_threads workers (0 = one per hardware thread) by a work-stealing loop, and each worker
+    // reuses its own workspace, so queries share nothing mutable. results[i] answers pairs[i].
+    vector<pair<double, vector<string>>> dijkstraBatch(span<const pair<string, string>> pairs,
+                                                       int num_threads = 0) const {
+        if (num_threads <= 0)
+            num_threads = max(1u, thread::hardware_concurrency());
+        vector<pair<double, vector<string>>> results(pairs.size());
+        vector<QueryWorkspace> workspaces(num_threads);
+        WorkStealingLoop::run(pairs.size(), num_threads, 16, [&](int worker, size_t i) {
+            results[i] = dijkstra(pairs[i].first, pairs[i].second, workspaces[worker]);
+        });
+        return results;
+    }
+
+    // Index-based dijkstra. Leaves distances/parents of everything it reached in ws and
+    // returns the distance to dest_idx (+inf if unreachable). dest_idx = -1 searches the whole
+    // graph and returns +inf.
+    double dijkstra(int source_idx, int dest_idx, QueryWorkspace& ws) const {
+        BinaryHeapQueue queue(ws.heap);
+        return dijkstra(source_idx, dest_idx, ws, queue);
+    }
+
+    // Same search on a chosen priority-queue policy (priority_queues.h), over the flights a
+    // filter allows (FlightMask; the default AllFlights reads fwd_weight directly). Both are
+    // template parameters, so each combination gets its own fully inlined loop. ws.counters
+    // holds the queue operations of this query.
+    template <class Queue, class Filter = AllFlights>
+    double dijkstra(int source_idx, int dest_idx, QueryWorkspace& ws, Queue& queue,
+                    const Filter& filter = Filter()) const {
+        ws.begin(airports.size());
+        SearchRecord record("dijkstra", ws.counters);
+        queue.reset(airports.size());
+        if (dest_idx >= 0 && !mayReach(source_idx, dest_idx))
+            return numeric_limits<double>::infinity();
+
+        ws.set(source_idx, 0.0, -1);
+        queue.push(source_idx, 0.0);
+        searchCount(ws.counters.pushes);
+
+        while (!queue.empty()) {
+            int current_node = queue.pop().second;
+            searchCount(ws.counters.pops);
+
+            if (ws.settled(current_node)) {
+                searchCount(ws.counters.stale);
+                continue;
+            }
+            ws.settle(current_node);
+            searchCount(ws.counters.settled);
+
+            if (current_node == dest_idx) {
+                break;
+            }
+
+            // unusable edges carry +inf, so they never pass the relaxation test
+            const double current_dist = ws.dist(current_node);
+            searchCount(ws.counters.relaxed, fwd_offsets[current_node + 1] - fwd_offsets[current_node]);
+            for (uint32_t e = fwd_offsets[current_node]; e < fwd_offsets[current_node + 1]; e++) {
+                int neighbor = fwd_dest[e];
+                double edge_weight = routeWeight(e, filter);
+
+                // relaxation
+                if (!ws.settled(neighbor) && current_dist + edge_weight < ws.dist(neighbor)) {
+                    ws.set(neighbor, current_dist + edge_weight, current_node);
+                    queue.push(neighbor, current_dist + edge_weight);
+                    searchCount(ws.counters.improved);
+                    searchCount(ws.counters.pushes);
+                }
+            }
+        }
+
+        return dest_idx >= 0 ? ws.dist(dest_idx) : numeric_limits<double>::infinity();
+    }
+
+    // Shortest and longest usable flight time in hours ({+inf, 0} without any), e.g. the width
+    // and span of a BucketQueue (priority_queues.h)
+    pair<double, double> flightTimeRange() const {
+        double shortest = numeric_limits<double>::infinity(), longest = 0;
+        for (double w : edge_weight) {
+            if (std::isinf(w))
+                continue;
+            shortest = min(shortest, w);
+            longest = max(longest, w);
+        }
+        return {shortest, longest};
+    }
+
+    // Default delta-stepping bucket width in hours: the longest flight over the average
+    // out-degree (the usual Theta(1/degree) choice), but at least the shortest flight. Flights up
+    // to this long are "light" and may be relaxed repeatedly inside a bucket; longer ones are
+    // relaxed once per bucket. Weights are sampled, so this is cheap on large graphs.
+    double deltaSteppingWidth() const {
+        double shortest = numeric_limits<double>::infinity(), longest = 0;
+        const size_t step = max<size_t>(1, fwd_weight.size() / 65536);
+        for (size_t e = 0; e < fwd_weight.size(); e += step) {
+            if (std::isinf(fwd_weight[e]))
+                continue;
+            shortest = min(shortest, fwd_weight[e]);
+            longest = max(longest, fwd_weight[e]);
+        }
+        if (longest <= 0 || airports.empty())
+            return 1.0;
+        const double avg_degree = max(1.0, (double)routeCount() / airports.size());
+        return max(shortest, longest / avg_degree);
+    }
+
+    // Fastest time from source_idx to every airport, by parallel delta-stepping (weights must be
+    // non-negative). Airports are split into num_threads contiguous ranges (0 = one per hardware
+    // thread); each worker keeps buckets of width delta (0 = deltaSteppingWidth()) for its own
+    // airports and sends relaxations of other workers' airports to them through per-pair request
+    // buffers, so only the owner ever writes a distance. Phases are separated by barriers.
+    //
+    // The result equals a full sequential dijkstra(): distances are the same sums, and parents
+    // are chosen afterwards with dijkstra's tie-breaking (the first in-neighbour in settle order,
+    // i.e. by (distance, index), that achieves the distance; exact for positive weights).
+    ShortestPathTree singleSourceAll(int source_idx, int num_threads = 0, double delta = 0) const {
+        const int n = airports.size();
+        const double inf = numeric_limits<double>::infinity();
+        if (delta <= 0)
+            delta = deltaSteppingWidth();
+        if (num_threads <= 0)
+            num_threads = max(1u, thread::hardware_concurrency());
+        num_threads = max(1, min(num_threads, n));
+
+        ShortestPathTree tree;
+        tree.source = source_idx;
+        tree.dist.assign(n, inf);
+        tree.parent.assign(n, -1);
+        vector<double>& dist = tree.dist;
+        if (source_idx < 0 || source_idx >= n)
+            return tree;
+
+        struct Request {
+            int node;
+            double dist;
+        };
+        struct Worker {
+            vector<vector<int>> buckets;        // own airports by floor(dist / delta); stale entries skipped
+            vector<vector<Request>> outbox;     // relaxations for each owner
+            vector<int> removed;                // airports taken from the current bucket
+            size_t lowest = 0;                  // first bucket that may be non-empty
+        };
+        vector<int> bounds(num_threads + 1);
+        for (int t = 0; t <= num_threads; t++)
+            bounds[t] = (int)((int64_t)n * t / num_threads);
+        auto owner = [&](int v) {
+            return (int)(upper_bound(bounds.begin(), bounds.end(), v) - bounds.begin()) - 1;
+        };
+        auto bucketOf = [&](double d) { return (size_t)(d / delta); };
+
+        vector<Worker> workers(num_threads);
+        for (auto& w : workers)
+            w.outbox.resize(num_threads);
+        vector<char> in_bucket(n, 0);           // listed in bucketOf(dist[v]) and not yet taken
+        vector<size_t> removed_in(n, SIZE_MAX); // bucket an airport was last removed from
+
+        auto push = [&](Worker& w, int v, double d) {
+            const size_t b = bucketOf(d);
+            const bool listed = in_bucket[v] && dist[v] != inf && bucketOf(dist[v]) == b;
+            dist[v] = d;
+            if (listed)
+                return;
+            if (w.buckets.size() <= b)
+                w.buckets.resize(b + 1);
+            w.buckets[b].push_back(v);
+            w.lowest = min(w.lowest, b);
+            in_bucket[v] = 1;
+        };
+        push(workers[owner(source_idx)], source_idx, 0.0);
+
+        // first bucket at or after w.lowest holding a live entry (SIZE_MAX if none)
+        auto findLowest = [&](Worker& w) {
+            for (; w.lowest < w.buckets.size(); w.lowest++) {
+                auto& bucket = w.buckets[w.lowest];
+                bucket.erase(remove_if(bucket.begin(), bucket.end(),
+                                       [&](int v) { return !in_bucket[v] || bucketOf(dist[v]) != w.lowest; }),
+                             bucket.end());
+                if (!bucket.empty())
+                    return w.lowest;
+            }
+            return SIZE_MAX;
+        };
+
+        size_t current = 0;
+        bool light_more = false;
+        vector<size_t> lowest(num_threads, SIZE_MAX);
+        vector<char> more(num_threads, 0);
+        barrier sync(num_threads);
+        barrier sync_bucket(num_threads, [&]() noexcept {
+            current = *min_element(lowest.begin(), lowest.end());
+        });
+        barrier sync_light(num_threads, [&]() noexcept {
+            light_more = find(more.begin(), more.end(), 1) != more.end();
+        });
+
+        // Sends relaxations of u's light (w <= delta) or heavy flights to the owners
+        auto relax = [&](Worker& w, int u, bool light) {
+            const double du = dist[u];
+            for (uint32_t e = fwd_offsets[u]; e < fwd_offsets[u + 1]; e++) {
+                const double weight = fwd_weight[e];
+                if ((weight <= delta) != light || std::isinf(weight))
+                    continue;
+                const int v = fwd_dest[e];
+                w.outbox[owner(v)].push_back({v, du + weight});
+            }
+        };
+        // Applies every request addressed to worker t
+        auto apply = [&](int t) {
+            for (auto& from : workers) {
+                for (const Request& r : from.outbox[t])
+                    if (r.dist < dist[r.node])
+                        push(workers[t], r.node, r.dist);
+                from.outbox[t].clear();
+            }
+        };
+
+        auto work = [&](int t) {
+            Worker& w = workers[t];
+            while (true) {
+                lowest[t] = findLowest(w);
+                sync_bucket.arrive_and_wait();
+                if (current == SIZE_MAX)
+                    return;
+
+                // light phase: repeat until the bucket stays empty everywhere
+                while (true) {
+                    vector<int> frontier;
+                    if (current < w.buckets.size())
+                        frontier.swap(w.buckets[current]);
+                    for (int u : frontier) {
+                        if (!in_bucket[u] || bucketOf(dist[u]) != current)
+                            continue;       // stale: moved to a lower bucket or already taken
+                        in_bucket[u] = 0;
+                        if (removed_in[u] != current) {
+                            removed_in[u] = current;
+                            w.removed.push_back(u);
+                        }
+                        relax(w, u, true);
+                    }
+                    sync.arrive_and_wait();
+                    apply(t);
+                    more[t] = current < w.buckets.size() && !w.buckets[current].empty();
+                    sync_light.arrive_and_wait();
+                    if (!light_more)
+                        break;
+                }
+
+                // heavy phase: distances in this bucket are final now
+                for (int u : w.removed)
+                    relax(w, u, false);
+                w.removed.clear();
+                sync.arrive_and_wait();
+                apply(t);
+                sync.arrive_and_wait();
+            }
+        };
+        runWorkers(num_threads, work);
+
+        // parents with dijkstra's tie-breaking: settle order is (distance, index), source first
+        auto settlesBefore = [&](int a, int b) {
+            if (dist[a] != dist[b])
+                return dist[a] < dist[b];
+            if (a == source_idx || b == source_idx)
+                return a == source_idx && b != source_idx;
+            return a < b;
+        };
+        runWorkers(num_threads, [&](int t) {
+            for (int v = bounds[t]; v < bounds[t + 1]; v++) {
+                if (v == source_idx || dist[v] == inf)
+                    continue;
+                int best = -1;
+                for (uint32_t a = rev_offsets[v]; a < rev_offsets[v + 1]; a++) {
+                    const int u = rev_src[a];
+                    if (dist[u] + rev_weight[a] == dist[v] && settlesBefore(u, v) &&
+                        (best < 0 || settlesBefore(u, best)))
+                        best = u;
+                }
+                tree.parent[v] = best;
+            }
+        });
+        return tree;
+    }
+
+    // A* search guided by the great-circle lower bound (see GeoBound). Returns the same optimal
+    // time as dijkstra(). Falls back to plain Dijkstra order when the destination has no
+    // coordinates; airports without coordinates along the way get a zero bound.
+    pair<double, vector<string>> astar(const string& source_code, const string& destination_code) const {
+        return astar(source_code, destination_code, QueryWorkspace::forThisThread());
+    }
+
+    pair<double, vector<string>> astar(const string& source_code, const string& destination_code,
+                                       QueryWorkspace& ws) const {
+        int source_idx = findAirportIndexByCode(source_code);
+        int dest_idx = findAirportIndexByCode(destination_code);
+
+        vector<string> empty_path;
+        if (source_idx < 0 || dest_idx < 0) {
+            return {numeric_limits<double>::infinity(), empty_path};
+        }
+
+        double dist = astar(source_idx, dest_idx, ws);
+        if (dist == numeric_limits<double>::infinity()) {
+            return {numeric_limits<double>::infinity(), empty_path};
+        }
+        return {dist, buildPath(ws, dest_idx)};
+    }
+
+    // Index-based A*. The bound is admissible but not always consistent (airports without
+    // coordinates break it), so an airport whose distance improves after it was expanded is
+    // reopened; the heap holds (distance + bound, node).
+    double astar(int source_idx, int dest_idx, QueryWorkspace& ws) const {
+        return astar(source_idx, dest_idx, ws, [&](int u) { return geoLowerBound(u, dest_idx); });
+    }
+
+    // A* with any admissible bound(u) on the time from u to dest_idx (e.g. LandmarkIndex).
+    // A bound of +inf means dest_idx is unreachable from u, and u is not queued. `engine` names
+    // the bound in the search stats.
+    template <class Bound>
+    double astar(int source_idx, int dest_idx, QueryWorkspace& ws, Bound bound, const char* engine = "astar") const {
+        ws.begin(airports.size());
+        SearchRecord record(engine, ws.counters);
+        if (!mayReach(source_idx, dest_idx))
+            return numeric_limits<double>::infinity();
+        auto& pq = ws.heap;
+        auto later = greater<pair<double, int>>();
+
+        ws.set(source_idx, 0.0, -1);
+        pq.push_back(make_pair(bound(source_idx), source_idx));
+        searchCount(ws.counters.pushes);
+
+        while (!pq.empty()) {
+            pop_heap(pq.begin(), pq.end(), later);
+            int current_node = pq.back().second;
+            pq.pop_back();
+            searchCount(ws.counters.pops);
+
+            // every improvement pushes a smaller key, so a settled node's entries are stale
+            if (ws.settled(current_node)) {
+                searchCount(ws.counters.stale);
+                continue;
+            }
+            ws.settle(current_node);
+            searchCount(ws.counters.settled);
+
+            if (current_node == dest_idx) {
+                break;
+            }
+
+            const double current_dist = ws.dist(current_node);
+            searchCount(ws.counters.relaxed, fwd_offsets[current_node + 1] - fwd_offsets[current_node]);
+            for (uint32_t e = fwd_offsets[current_node]; e < fwd_offsets[current_node + 1]; e++) {
+                int neighbor = fwd_dest[e];
+                double candidate = current_dist + fwd_weight[e];
+
+                if (candidate < ws.dist(neighbor)) {
+                    const double h = bound(neighbor);
+                    if (std::isinf(h))
+                        continue;
+                    ws.set(neighbor, candidate, current_node);
+                    ws.reopen(neighbor);
+                    pq.push_back(make_pair(candidate + h, neighbor));
+                    push_heap(pq.begin(), pq.end(), later);
+                    searchCount(ws.counters.improved);
+                    searchCount(ws.counters.pushes);
+                }
+            }
+        }
+
+        return ws.dist(dest_idx);
+    }
+
+    // Lower bound on the time from airport u to airport t; 0 if either has no coordinates
+    double geoLowerBound(int u, int t) const {
+        if (u == t || geo_bound.empty())
+            return 0.0;
+        const GeoPoint& a = airport_geo[u];
+        const GeoPoint& b = airport_geo[t];
+        if (!a.known() || !b.known())
+            return 0.0;
+        return geo_bound[0].offset_hr + geo_bound[0].hr_per_mile * greatCircleMiles(a, b);
+    }
+
+    // Bidirectional Dijkstra: grows a forward search from the source over the outgoing edges and
+    // a backward search from the destination over the incoming ones, always expanding the side
+    // with the smaller key, and stops once the two keys together reach the best meeting path.
+    pair<double, vector<string>> bidirectionalDijkstra(const string& source_code, const string& destination_code) const {
+        return bidirectionalDijkstra(source_code, destination_code, QueryWorkspace::forThisThread(0),
+                                     QueryWorkspace::forThisThread(1));
+    }
+
+    pair<double, vector<string>> bidirectionalDijkstra(const string& source_code, const string& destination_code,
+                                                       QueryWorkspace& fwd_ws, QueryWorkspace& bwd_ws) const {
+        int source_idx = findAirportIndexByCode(source_code);
+        int dest_idx = findAirportIndexByCode(destination_code);
+
+        vector<string> empty_path;
+        if (source_idx < 0 || dest_idx < 0) {
+            return {numeric_limits<double>::infinity(), empty_path};
+        }
+
+        int meet = -1;
+        bidirectionalDijkstra(source_idx, dest_idx, fwd_ws, bwd_ws, meet);
+        if (meet < 0) {
+            return {numeric_limits<double>::infinity(), empty_path};
+        }
+
+        vector<int> nodes = bidirectionalPath(fwd_ws, bwd_ws, meet);
+        vector<string> path_result;
+        for (int v : nodes)
+            path_result.push_back(airports[v].code);
+        return {pathTime(nodes), path_result};
+    }
+
+    // Index-based bidirectional Dijkstra. Returns the distance and sets meet to the airport where
+    // the best path crosses from the forward into the backward tree (-1 if unreachable).
+    double bidirectionalDijkstra(int source_idx, int dest_idx, QueryWorkspace& fwd_ws, QueryWorkspace& bwd_ws,
+                                 int& meet) const {
+        const int num_airports = airports.size();
+        fwd_ws.begin(num_airports);
+        bwd_ws.begin(num_airports);
+        SearchCounters& counters = fwd_ws.counters;     // both sides
+        SearchRecord record("bidirectional", counters);
+        meet = -1;
+        if (!mayReach(source_idx, dest_idx))
+            return numeric_limits<double>::infinity();
+        auto later = greater<pair<double, int>>();
+
+        fwd_ws.set(source_idx, 0.0, -1);
+        fwd_ws.heap.push_back(make_pair(0.0, source_idx));
+        bwd_ws.set(dest_idx, 0.0, -1);
+        bwd_ws.heap.push_back(make_pair(0.0, dest_idx));
+        searchCount(counters.pushes, 2);
+
+        double best = numeric_limits<double>::infinity();
+        meet = -1;
+        if (source_idx == dest_idx) {
+            best = 0.0;
+            meet = source_idx;
+        }
+
+        auto dropSettled = [&](QueryWorkspace& ws) {
+            while (!ws.heap.empty() && ws.settled(ws.heap.front().second)) {
+                pop_heap(ws.heap.begin(), ws.heap.end(), later);
+                ws.heap.pop_back();
+                searchCount(counters.pops);
+                searchCount(counters.stale);
+            }
+        };
+
+        while (true) {
+            dropSettled(fwd_ws);
+            dropSettled(bwd_ws);
+            if (fwd_ws.heap.empty() || bwd_ws.heap.empty())
+                break;
+            const double fwd_top = fwd_ws.heap.front().first;
+            const double bwd_top = bwd_ws.heap.front().first;
+            if (fwd_top + bwd_top >= best)
+                break;
+
+            const bool forward = fwd_top <= bwd_top;
+            QueryWorkspace& ws = forward ? fwd_ws : bwd_ws;
+            const QueryWorkspace& other = forward ? bwd_ws : fwd_ws;
+            const Column<uint32_t>& offsets = forward ? fwd_offsets : rev_offsets;
+            const Column<int>& adj = forward ? fwd_dest : rev_src;
+            const Column<double>& weights = forward ? fwd_weight : rev_weight;
+
+            pop_heap(ws.heap.begin(), ws.heap.end(), later);
+            int current_node = ws.heap.back().second;
+            ws.heap.pop_back();
+            ws.settle(current_node);
+            searchCount(counters.pops);
+            searchCount(counters.settled);
+
+            const double current_dist = ws.dist(current_node);
+            searchCount(counters.relaxed, offsets[current_node + 1] - offsets[current_node]);
+            for (uint32_t e = offsets[current_node]; e < offsets[current_node + 1]; e++) {
+                int neighbor = adj[e];
+                double candidate = current_dist + weights[e];
+
+                if (!ws.settled(neighbor) && candidate < ws.dist(neighbor)) {
+                    ws.set(neighbor, candidate, current_node);
+                    ws.heap.push_back(make_pair(candidate, neighbor));
+                    push_heap(ws.heap.begin(), ws.heap.end(), later);
+                    searchCount(counters.improved);
+                    searchCount(counters.pushes);
+                }
+                if (other.reached(neighbor) && candidate + other.dist(neighbor) < best) {
+                    best = candidate + other.dist(neighbor);
+                    meet = neighbor;
+                }
+            }
+        }
+
+        return best;
+    }
+
+    // Airport indices source..dest of a bidirectional search that met at `meet`
+    vector<int> bidirectionalPath(const QueryWorkspace& fwd_ws, const QueryWorkspace& bwd_ws, int meet) const {
+        vector<int> nodes;
+        for (int v = meet; v != -1; v = fwd_ws.parent(v))
+            nodes.push_back(v);
+        reverse(nodes.begin(), nodes.end());
+        for (int v = bwd_ws.parent(meet); v != -1; v = bwd_ws.parent(v))
+            nodes.push_back(v);
+        return nodes;
+    }
+
+    // Time along a path of airport indices, using the route (fastest flight) for each hop and
+    // summing from the source like dijkstra() does (+inf if a hop has no edge)
+    double pathTime(const vector<int>& nodes) const {
+        double total = 0.0;
+        for (size_t i = 0; i + 1 < nodes.size(); i++) {
+            const int r = findRoute(nodes[i], nodes[i + 1]);
+            total += r < 0 ? numeric_limits<double>::infinity() : fwd_weight[r];
+        }
+        return total;
+    }
+
+    // Yen's K fastest loopless itineraries from source to destination, fastest first (fewer if
+    // there are not that many). Each is (total time, airport codes).
+    vector<pair<double, vector<string>>> kShortestPaths(const string& source_code, const string& destination_code,
+                                                        int K, int num_threads = 1) const {
+        thread_local KspWorkspace ws;
+        vector<pair<double, vector<string>>> result;
+        const int source_idx = findAirportIndexByCode(source_code);
+        const int dest_idx = findAirportIndexByCode(destination_code);
+        if (source_idx < 0 || dest_idx < 0)
+            return result;
+        for (auto& [time, nodes] : kShortestPaths(source_idx, dest_idx, K, ws, num_threads)) {
+            vector<string> codes;
+            for (int v : nodes)
+                codes.push_back(airports[v].code);
+            result.push_back({time, std::move(codes)});
+        }
+        return result;
+    }
+
+    // Index-based Yen with a reverse shortest-path tree. One backward Dijkstra from the
+    // destination, stopped once the source settles, gives the exact time to the destination from
+    // every airport it settled; any other airport is at least its radius away. The first path is
+    // read off that tree, and every spur search is an A* guided by it: the bound is exact (or the
+    // radius) on the full graph and can only be low once root airports and routes are blocked. A
+    // spur whose tree path avoids the blocked airports and routes is taken straight from the tree
+    // without a search.
+    //
+    // Only spurs at or after the point where a path left its parent are searched (Lawler); the
+    // earlier ones would repeat the parent's. Blocked root airports are marked in the spur
+    // workspace with distance -inf, so nothing relaxes them, and the workspaces are reset lazily,
+    // so a spur search costs only what it explores. The spurs of one path are independent and run
+    // on num_threads workers (0 = one per hardware thread); candidates are merged in spur order
+    // and ties broken by airport sequence, so the answer does not depend on the thread count.
+    vector<pair<double, vector<int>>> kShortestPaths(int source_idx, int dest_idx, int K, KspWorkspace& ws,
+                                                     int num_threads = 1) const {
+        vector<pair<double, vector<int>>> found;
+        if (K <= 0 || source_idx < 0 || dest_idx < 0 || !mayReach(source_idx, dest_idx))
+            return found;
+        if (num_threads <= 0)
+            num_threads = max(1u, thread::hardware_concurrency());
+        if ((int)ws.spur.size() < num_threads)
+            ws.spur.resize(num_threads);
+
+        const QueryWorkspace& to_dest = ws.reverse;
+        ws.reverse_radius = reverseTree(dest_idx, source_idx, ws.reverse);
+        if (!to_dest.settled(source_idx))
+            return found;
+        vector<int> first;
+        for (int v = source_idx; v != -1; v = to_dest.parent(v))
+            first.push_back(v);
+        found.push_back({pathTime(first), first});
+        vector<int> deviation{0};       // spur index at which each found path left its parent
+
+        struct Candidate {
+            double time;
+            vector<int> nodes;
+            int deviation;
+        };
+        auto worse = [](const Candidate& a, const Candidate& b) {
+            return a.time != b.time ? a.time > b.time : a.nodes > b.nodes;
+        };
+        vector<Candidate> candidates;   // min-heap under `worse`
+        set<vector<int>> seen{first};   // every path ever found or queued
+        vector<vector<int>> spurs;
+
+        while ((int)found.size() < K) {
+            const vector<int>& prev = found.back().second;
+            const int from = deviation.back();
+            const int count = max(0, (int)prev.size() - 1 - from);
+            spurs.assign(count, {});
+            WorkStealingLoop::run(count, num_threads, 1, [&](int worker, size_t k) {
+                spurs[k] = spurPath(found, from + (int)k, to_dest, ws.reverse_radius, ws.spur[worker]);
+            });
+            for (int k = 0; k < count; k++) {
+                if (spurs[k].empty() || !seen.insert(spurs[k]).second)
+                    continue;
+                candidates.push_back({pathTime(spurs[k]), std::move(spurs[k]), from + k});
+                push_heap(candidates.begin(), candidates.end(), worse);
+            }
+            if (candidates.empty())
+                break;
+            pop_heap(candidates.begin(), candidates.end(), worse);
+            Candidate next = std::move(candidates.back());
+            candidates.pop_back();
+            if (std::isinf(next.time))
+                break;
+            found.push_back({next.time, std::move(next.nodes)});
+            deviation.push_back(next.deviation);
+        }
+        return found;
+    }
+
+    // Fastest itinerary using only the flights `filter` allows and at most max_flights flights
+    // (0 = no limit; at most 2 stops is max_flights = 3). Without a limit this is dijkstra() over
+    // the filtered flights, with one by hopLimitedBellmanFord().
+    pair<double, vector<string>> constrainedRoute(const string& source_code, const string& destination_code,
+                                                  const FlightFilter& filter, int max_flights = 0) const {
+        QueryWorkspace& ws = QueryWorkspace::forThisThread();
+        int source_idx = findAirportIndexByCode(source_code);
+        int dest_idx = findAirportIndexByCode(destination_code);
+
+        vector<string> empty_path;
+        if (source_idx < 0 || dest_idx < 0) {
+            return {numeric_limits<double>::infinity(), empty_path};
+        }
+
+        const FlightMask mask = compileFilter(filter);
+        if (max_flights <= 0) {
+            BinaryHeapQueue queue(ws.heap);
+            double dist = dijkstra(source_idx, dest_idx, ws, queue, mask);
+            if (dist == numeric_limits<double>::infinity())
+                return {dist, empty_path};
+            return {dist, buildPath(ws, dest_idx)};
+        }
+        vector<int> nodes;
+        double dist = hopLimitedBellmanFord(source_idx, dest_idx, max_flights, ws, nodes, mask);
+        vector<string> path_result;
+        for (int v : nodes)
+            path_result.push_back(airports[v].code);
+        return {dist, path_result};
+    }
+
+    // Fastest time from source to destination over at most max_flights flights, by bounded-round
+    // Bellman-Ford (see labelRounds()). `path` gets the airports (empty if unreachable).
+    template <class Filter = AllFlights>
+    double hopLimitedBellmanFord(int source_idx, int dest_idx, int max_flights, QueryWorkspace& ws,
+                                 vector<int>& path, const Filter& filter = Filter()) const {
+        labelRounds(source_idx, dest_idx, max_flights, ws, filter, [](int) {});
+        path = labelPath(ws, dest_idx);
+        return ws.dist(dest_idx);
+    }
+
+    // The Pareto front of (time, flights) from source to destination: for every flight count the
+    // fastest itinerary, kept only if it is faster than every itinerary with fewer flights.
+    // Ordered by flights (stops = flights - 1), so times strictly decrease. Each entry is
+    // (time, airport codes). max_flights = 0 means no limit.
+    vector<pair<double, vector<string>>> paretoRoutes(const string& source_code, const string& destination_code,
+                                                      int max_flights = 0) const {
+        vector<pair<double, vector<string>>> result;
+        const int source_idx = findAirportIndexByCode(source_code);
+        const int dest_idx = findAirportIndexByCode(destination_code);
+        if (source_idx < 0 || dest_idx < 0)
+            return result;
+        for (auto& [time, nodes] : paretoRoutes(source_idx, dest_idx, QueryWorkspace::forThisThread(), max_flights)) {
+            vector<string> codes;
+            for (int v : nodes)
+                codes.push_back(airports[v].code);
+            result.push_back({time, std::move(codes)});
+        }
+        return result;
+    }
+
+    // Index-based Pareto search: the rounds of labelRounds(), recording the destination after
+    // every round that made it faster
+    template <class Filter = AllFlights>
+    vector<pair<double, vector<int>>> paretoRoutes(int source_idx, int dest_idx, QueryWorkspace& ws,
+                                                   int max_flights = 0, const Filter& filter = Filter()) const {
+        vector<pair<double, vector<int>>> front;
+        if (source_idx == dest_idx) {
+            ws.begin(airports.size());
+            front.push_back({0.0, {source_idx}});
+            return front;
+        }
+        labelRounds(source_idx, dest_idx, max_flights > 0 ? max_flights : (int)airports.size() - 1, ws, filter,
+                    [&](int round) {
+                        const int l = ws.parent(dest_idx);
+                        if (l >= 0 && ws.labels[l].round == round)
+                            front.push_back({ws.dist(dest_idx), labelPath(ws, dest_idx)});
+                    });
+        return front;
+    }
+
+    // bellman-ford algorithm (time is -inf with an empty path if a negative cycle is reachable)
+    pair<double, vector<string>> bellmanFord(const string& source_code, const string& destination_code) const {
+        return bellmanFord(source_code, destination_code, QueryWorkspace::forThisThread());
+    }
+
+    pair<double, vector<string>> bellmanFord(const string& source_code, const string& destination_code,
+                                             QueryWorkspace& ws) const {
+        int source_idx = findAirportIndexByCode(source_code);
+        int dest_idx = findAirportIndexByCode(destination_code);
+
+        vector<string> empty_path;
+        if (source_idx < 0 || dest_idx < 0) {
+            return {numeric_limits<double>::infinity(), empty_path};
+        }
+
+        double dist = bellmanFord(source_idx, dest_idx, ws);
+        if (dist == numeric_limits<double>::infinity() || dist == -numeric_limits<double>::infinity()) {
+            return {dist, empty_path};
+        }
+        return {dist, buildPath(ws, dest_idx)};
+    }
+
+    // Index-based bellman-ford; same contract as the index-based dijkstra, over the route
+    // weights (never negative, so it cannot meet a negative cycle).
+    //
+    // Runs over the edge list grouped by destination, i.e. the reverse CSR: src = rev_src,
+    // w = rev_weight, dst implicit from rev_offsets. Each round is a Jacobi step that pulls
+    // next[v] = min(cur[v], min over in-edges of cur[src] + w) from the previous round's
+    // distances, so destination ranges split across threads without locks, and the inner loop is
+    // a branch-free gather/add/min. Only destinations with an in-neighbour that improved in the
+    // previous round are pulled (an SPFA-style worklist kept as flags). Distances after round k
+    // are the best over paths of at most k flights, hence exact after at most V-1 rounds; a
+    // change in round V means a negative cycle.
+    //
+    // The round buffers live in ws, so repeated queries do not allocate, and the threads come
+    // from ThreadTeam::shared(). num_threads = 0 picks a count from the graph size: one (no
+    // threads, no barrier) below 256k routes, where a round is too short to split.
+    double bellmanFord(int source_idx, int dest_idx, QueryWorkspace& ws, int num_threads = 0) const {
+        // an unreachable destination cannot hide a negative cycle here
+        if (!mayReach(source_idx, dest_idx)) {
+            ws.begin(airports.size());
+            SearchRecord record("bellmanFord", ws.counters);
+            return numeric_limits<double>::infinity();
+        }
+        return bellmanFordRounds(source_idx, dest_idx, ws, rev_weight.data(), num_threads);
+    }
+
+    // Bellman-Ford over caller-supplied route weights instead of the flight times, e.g. times
+    // adjusted by penalties or credits. route_weight[r] is the weight of route r (fwd_* order,
+    // routeCount() entries); it may be negative, and +inf or NaN marks a route as unusable.
+    // Returns -inf, with nothing reached in ws, if a negative cycle is reachable from the source.
+    double bellmanFord(int source_idx, int dest_idx, QueryWorkspace& ws, span<const double> route_weight,
+                       int num_threads = 0) const {
+        if (route_weight.size() != routeCount()) {
+            ws.begin(airports.size());
+            return numeric_limits<double>::quiet_NaN();
+        }
+        vector<double>& w = ws.round_weight;
+        w.resize(routeCount());
+        for (size_t a = 0; a < w.size(); a++) {
+            const double x = route_weight[rev_edge[a]];
+            w[a] = std::isnan(x) ? numeric_limits<double>::infinity() : x;
+        }
+        return bellmanFordRounds(source_idx, dest_idx, ws, w.data(), num_threads);
+    }
+
+    // Airport codes along the parent links ws holds for dest_idx (empty if it was not reached)
+    vector<string> buildPath(const QueryWorkspace& ws, int dest_idx) const {
+        vector<string> path_result;
+        if (ws.dist(dest_idx) == numeric_limits<double>::infinity())
+            return path_result;
+        int current = dest_idx;
+        while (current != -1) {
+            path_result.push_back(airports[current].code);
+            current = ws.parent(current);
+        }
+        reverse(path_result.begin(), path_result.end());
+        return path_result;
+    }
+
+private:
+    // Round-based label search from source_idx, RAPTOR-style over the routes: round k relaxes the
+    // routes out of the airports whose best time improved in round k - 1, so after it every
+    // airport holds its best time over at most k flights, and after_round(k) is called. An
+    // arrival no faster than one with fewer flights is dropped, and so is one that cannot beat
+    // the destination's current time even at the great-circle bound: neither can lead to a faster
+    // itinerary.
+    //
+    // Labels go to ws.labels, one per improvement, and ws.parent(v) is v's latest label. A round
+    // reads only the labels of the one before, which it never changes, so labelPath() can rebuild
+    // the path of any label afterwards.
+    template <class Filter, class AfterRound>
+    void labelRounds(int source_idx, int dest_idx, int max_rounds, QueryWorkspace& ws, const Filter& filter,
+                     AfterRound after_round) const {
+        ws.begin(airports.size());
+        SearchRecord record("rounds", ws.counters);
+        if (!mayReach(source_idx, dest_idx))
+            return;
+        vector<HopLabel>& labels = ws.labels;
+        vector<int>& frontier = ws.frontier;
+        vector<int>& next = ws.next_frontier;
+        labels.push_back({source_idx, -1, 0, 0.0});
+        frontier.assign(1, 0);
+        ws.set(source_idx, 0.0, 0);
+        // lower bound to the destination, worth computing only once it has been reached
+        auto bound = [&](int v) { return ws.reached(dest_idx) ? geoLowerBound(v, dest_idx) : 0.0; };
+        for (int round = 1; round <= max_rounds && !frontier.empty(); round++) {
+            next.clear();
+            searchCount(ws.counters.passes);
+            for (int l : frontier) {
+                const int u = labels[l].node;
+                const double du = labels[l].dist;   // u's best over round - 1 flights
+                if (u == dest_idx || !(du + bound(u) < ws.dist(dest_idx)))
+                    continue;
+                searchCount(ws.counters.settled);
+                searchCount(ws.counters.relaxed, fwd_offsets[u + 1] - fwd_offsets[u]);
+                for (uint32_t r = fwd_offsets[u]; r < fwd_offsets[u + 1]; r++) {
+                    const int v = fwd_dest[r];
+                    const double candidate = du + routeWeight(r, filter);
+                    if (!(candidate < ws.dist(v)) || !(candidate + bound(v) < ws.dist(dest_idx)))
+                        continue;
+                    int own = ws.parent(v);
+                    if (own < 0 || labels[own].round != round) {
+                        own = (int)labels.size();
+                        labels.push_back({v, l, round, candidate});
+                        next.push_back(own);
+                    } else {
+                        labels[own].prev = l;       // a better arrival within the same round
+                        labels[own].dist = candidate;
+                    }
+                    ws.set(v, candidate, own);
+                    searchCount(ws.counters.improved);
+                }
+            }
+            swap(frontier, next);
+            after_round(round);
+        }
+    }
+
+    // Airports along the labels ending at v's latest label (empty if v was not reached)
+    vector<int> labelPath(const QueryWorkspace& ws, int v) const {
+        vector<int> path;
+        if (!ws.reached(v))
+            return path;
+        for (int l = ws.parent(v); l >= 0; l = ws.labels[l].prev)
+            path.push_back(ws.labels[l].node);
+        reverse(path.begin(), path.end());
+        return path;
+    }
+
+    // Backward Dijkstra from dest_idx over the incoming routes until stop_idx settles: for every
+    // settled v, ws.dist(v) is the fastest time from v to dest_idx and ws.parent(v) the next
+    // airport on that path. Returns the radius, the largest settled distance (+inf if the search
+    // ran out first), which is a lower bound for every airport left unsettled.
+    double reverseTree(int dest_idx, int stop_idx, QueryWorkspace& ws) const {
+        ws.begin(airports.size());
+        auto later = greater<pair<double, int>>();
+        ws.set(dest_idx, 0.0, -1);
+        ws.heap.push_back(make_pair(0.0, dest_idx));
+        while (!ws.heap.empty()) {
+            pop_heap(ws.heap.begin(), ws.heap.end(), later);
+            const int current_node = ws.heap.back().second;
+            ws.heap.pop_back();
+            if (ws.settled(current_node))
+                continue;
+            ws.settle(current_node);
+            const double current_dist = ws.dist(current_node);
+            if (current_node == stop_idx)
+                return current_dist;
+            for (uint32_t e = rev_offsets[current_node]; e < rev_offsets[current_node + 1]; e++) {
+                const int neighbor = rev_src[e];
+                const double candidate = current_dist + rev_weight[e];
+                if (!ws.settled(neighbor) && candidate < ws.dist(neighbor)) {
+                    ws.set(neighbor, candidate, current_node);
+                    ws.heap.push_back(make_pair(candidate, neighbor));
+                    push_heap(ws.heap.begin(), ws.heap.end(), later);
+                }
+            }
+        }
+        return numeric_limits<double>::infinity();
+    }
+
+    // Yen's spur at index i of the last found path: its root up to airport i, then the fastest
+    // way on to the destination that avoids the root and the routes out of airport i taken by
+    // any found path with the same root. Empty if there is none.
+    vector<int> spurPath(const vector<pair<double, vector<int>>>& found, int i, const QueryWorkspace& to_dest,
+                         double radius, QueryWorkspace& ws) const {
+        const vector<int>& prev = found.back().second;
+        const int spur = prev[i];
+        const int dest_idx = prev.back();
+        const double inf = numeric_limits<double>::infinity();
+        ws.begin(airports.size());
+        for (int j = 0; j < i; j++)
+            ws.set(prev[j], -inf, -1);      // root airports: never relaxed
+        vector<int> blocked;                // next airports out of the spur that are taken
+        for (const auto& [time, nodes] : found)
+            if ((int)nodes.size() > i + 1 && equal(prev.begin(), prev.begin() + i + 1, nodes.begin()))
+                blocked.push_back(nodes[i + 1]);
+        auto isBlocked = [&](int v) { return find(blocked.begin(), blocked.end(), v) != blocked.end(); };
+        // lower bound on the time from v to the destination (+inf: cannot reach it)
+        auto bound = [&](int v) {
+            if (to_dest.settled(v))
+                return to_dest.dist(v);
+            return mayReach(v, dest_idx) ? radius : inf;
+        };
+
+        vector<int> path(prev.begin(), prev.begin() + i);
+        // the tree path, if it avoids everything blocked
+        bool clear = to_dest.settled(spur) && !isBlocked(to_dest.parent(spur));
+        for (int v = to_dest.parent(spur); clear && v != -1; v = to_dest.parent(v))
+            clear = !ws.reached(v);
+        if (clear) {
+            for (int v = spur; v != -1; v = to_dest.parent(v))
+                path.push_back(v);
+            return path;
+        }
+
+        // A* on the tree distances; reopening keeps it exact where rounding makes them inconsistent
+        auto later = greater<pair<double, int>>();
+        ws.set(spur, 0.0, -1);
+        ws.heap.push_back(make_pair(bound(spur), spur));
+        while (!ws.heap.empty()) {
+            pop_heap(ws.heap.begin(), ws.heap.end(), later);
+            const int current_node = ws.heap.back().second;
+            ws.heap.pop_back();
+            if (ws.settled(current_node))
+                continue;
+            ws.settle(current_node);
+            if (current_node == dest_idx)
+                break;
+            const double current_dist = ws.dist(current_node);
+            for (uint32_t e = fwd_offsets[current_node]; e < fwd_offsets[current_node + 1]; e++) {
+                const int neighbor = fwd_dest[e];
+                const double candidate = current_dist + fwd_weight[e];
+                if (!(candidate < ws.dist(neighbor)) || (current_node == spur && isBlocked(neighbor)))
+                    continue;
+                const double h = bound(neighbor);
+                if (std::isinf(h))
+                    continue;
+                ws.set(neighbor, candidate, current_node);
+                ws.reopen(neighbor);
+                ws.heap.push_back(make_pair(candidate + h, neighbor));
+                push_heap(ws.heap.begin(), ws.heap.end(), later);
+            }
+        }
+        if (!ws.settled(dest_idx))
+            return {};
+        const size_t root = path.size();
+        for (int v = dest_idx; v != -1; v = ws.parent(v))
+            path.push_back(v);
+        reverse(path.begin() + root, path.end());
+        return path;
+    }
+
+    // The rounds of bellmanFord() with in-edge weights w (rev_* order)
+    double bellmanFordRounds(int source_idx, int dest_idx, QueryWorkspace& ws, const double* w, int num_threads) const {
+        const int num_airports = airports.size();
+        const double inf = numeric_limits<double>::infinity();
+        if (num_threads <= 0)
+            num_threads = (int)min<size_t>(max(1u, thread::hardware_concurrency()), 1 + routeCount() / 262144);
+        num_threads = max(1, min(num_threads, num_airports));
+
+        vector<double>* dist = ws.round_dist;
+        vector<uint8_t>* dirty = ws.round_dirty;
+        for (int r = 0; r < 2; r++) {
+            dist[r].assign(num_airports, inf);
+            dirty[r].assign(num_airports, 0);
+        }
+        ws.round_parent.assign(num_airports, -1);
+        dist[0][source_idx] = 0.0;
+        for (uint32_t e = fwd_offsets[source_idx]; e < fwd_offsets[source_idx + 1]; e++)
+            dirty[0][fwd_dest[e]] = 1;
+
+        // destination ranges with roughly equal numbers of in-edges
+        vector<int> bounds(num_threads + 1, num_airports);
+        bounds[0] = 0;
+        for (int t = 1; t < num_threads; t++)
+            bounds[t] = (int)(upper_bound(rev_offsets.begin(), rev_offsets.end(),
+                                          (uint32_t)((uint64_t)routeCount() * t / num_threads)) - rev_offsets.begin()) - 1;
+
+        vector<char> changed(num_threads, 0);
+        vector<SearchCounters> counters(SEARCH_STATS_ENABLED ? num_threads : 0);
+        bool negative_cycle = false;
+        int round = 0;
+        uint64_t passes = 0;
+        auto endRound = [&]() noexcept {
+            passes++;
+            bool any = false;
+            for (char c : changed)
+                any = any || c;
+            if (any && round == num_airports - 1)
+                negative_cycle = true;
+            round = (any && !negative_cycle) ? round + 1 : num_airports;
+        };
+        auto relax = [&](int t) {
+            const int r = round & 1;
+            copy(dist[r].begin() + bounds[t], dist[r].begin() + bounds[t + 1], dist[r ^ 1].begin() + bounds[t]);
+            changed[t] = relaxInEdges(dist[r], dist[r ^ 1], ws.round_parent, w, dirty[r], dirty[r ^ 1], bounds[t],
+                                      bounds[t + 1], SEARCH_STATS_ENABLED ? &counters[t] : nullptr);
+        };
+        if (num_threads == 1) {
+            while (round < num_airports) {
+                relax(0);
+                endRound();
+            }
+        } else {
+            barrier sync(num_threads, endRound);
+            runWorkers(num_threads, [&](int t) {
+                while (round < num_airports) {
+                    relax(t);
+                    sync.arrive_and_wait();
+                }
+            });
+        }
+
+        ws.begin(num_airports);
+        SearchRecord record("bellmanFord", ws.counters);
+        for (const SearchCounters& c : counters)
+            ws.counters += c;
+        searchCount(ws.counters.passes, passes);
+        if (negative_cycle)
+            return -inf;
+        const vector<double>& final_dist = dist[round & 1];    // the last round changed nothing
+        for (int v = 0; v < num_airports; v++)
+            if (final_dist[v] != inf)
+                ws.set(v, final_dist[v], ws.round_parent[v]);
+        return ws.dist(dest_idx);
+    }
+
+    // Runs work(t) for t in [0, num_threads) at once on the shared ThreadTeam
+    template <class Work>
+    static void runWorkers(int num_threads, Work work) {
+        ThreadTeam::shared().run(num_threads, work);
+    }
+
+    // One Bellman-Ford round for the dirty destinations in [first, last): next[v] = best of
+    // cur[v] and every cur[src] + w over v's in-edges. Out-neighbours of improved airports are
+    // flagged in dirty_next, which other threads flag too (hence the atomic_ref); dirty_cur[v] is
+    // only touched by the thread owning v. Returns true if any distance dropped.
+    bool relaxInEdges(const vector<double>& cur, vector<double>& next, vector<int>& parent, const double* w,
+                      vector<uint8_t>& dirty_cur, vector<uint8_t>& dirty_next, int first, int last,
+                      SearchCounters* counters) const {
+        const uint32_t* off = rev_offsets.data();
+        const int* src = rev_src.data();
+        const double* d = cur.data();
+        bool changed = false;
+        for (int v = first; v < last; v++) {
+            if (!dirty_cur[v])
+                continue;
+            dirty_cur[v] = 0;
+            if constexpr (SEARCH_STATS_ENABLED) {
+                counters->settled++;
+                counters->relaxed += off[v + 1] - off[v];
+            }
+
+            // four independent running minima keep the loop free of a serial dependency
+            double m0 = d[v], m1 = m0, m2 = m0, m3 = m0;
+            uint32_t a = off[v];
+            const uint32_t end = off[v + 1];
+            for (; a + 4 <= end; a += 4) {
+                m0 = min(m0, d[src[a]] + w[a]);
+                m1 = min(m1, d[src[a + 1]] + w[a + 1]);
+                m2 = min(m2, d[src[a + 2]] + w[a + 2]);
+                m3 = min(m3, d[src[a + 3]] + w[a + 3]);
+            }
+            for (; a < end; a++)
+                m0 = min(m0, d[src[a]] + w[a]);
+            const double best = min(min(m0, m1), min(m2, m3));
+            if (best < d[v]) {
+                // find which in-edge achieved it
+                for (a = off[v]; d[src[a]] + w[a] != best; a++) {
+                }
+                parent[v] = src[a];
+                next[v] = best;
+                changed = true;
+                if constexpr (SEARCH_STATS_ENABLED)
+                    counters->improved++;
+                for (uint32_t e = fwd_offsets[v]; e < fwd_offsets[v + 1]; e++)
+                    atomic_ref<uint8_t>(dirty_next[fwd_dest[e]]).store(1, memory_order_relaxed);
+            }
+        }
+        return changed;
+    }
+
+    // Keeps a mapped snapshot alive while columns point into it
+    shared_ptr<MappedFile> snapshot_file;
+
+    // Checks that the columns of a snapshot with num_airports airports keep every search inside
+    // its arrays: CSR offsets rise from 0 to the length of the columns they index, parallel
+    // columns have equal lengths, airport / route / flight / name ids are in range, and the hash
+    // tables have a power-of-two size with an empty slot to end each probe. The payload
+    // checksum is optional, so openSnapshot() runs this before mapping anything.
+    static bool snapshotColumnsFit(const SnapshotReader& reader, size_t num_airports) {
+        const size_t n = num_airports;
+        auto offsetsFit = [](span<const uint32_t> offsets, size_t rows, size_t count) {
+            if (offsets.size() != rows + 1 || offsets[0] != 0 || offsets[rows] != count)
+                return false;
+            for (size_t i = 0; i < rows; i++)
+                if (offsets[i] > offsets[i + 1])
+                    return false;
+            return true;
+        };
+        auto idsBelow = [](auto ids, size_t limit, long long allowed_negative) {
+            for (auto id : ids)
+                if (!((long long)id >= 0 ? (size_t)id < limit : (long long)id == allowed_negative))
+                    return false;
+            return true;
+        };
+        auto probeTableFits = [](auto keys, size_t values, auto empty) {
+            if (keys.size() != values || (keys.size() & (keys.size() - 1)) != 0)
+                return false;
+            return keys.empty() || find(keys.begin(), keys.end(), empty) != keys.end();
+        };
+        const long long none = numeric_limits<long long>::min();    // no negative id allowed
+
+        // routes
+        const auto fwd_offsets = reader.array<uint32_t>(SEC_FWD_OFFSETS);
+        const auto fwd_dest = reader.array<int>(SEC_FWD_DEST);
+        const size_t routes = fwd_dest.size();
+        if (!offsetsFit(fwd_offsets, n, routes) || reader.array<double>(SEC_FWD_WEIGHT).size() != routes ||
+            !idsBelow(fwd_dest, n, none))
+            return false;
+        const auto rev_offsets = reader.array<uint32_t>(SEC_REV_OFFSETS);
+        const auto rev_src = reader.array<int>(SEC_REV_SRC);
+        const auto rev_edge = reader.array<uint32_t>(SEC_REV_EDGE);
+        if (!offsetsFit(rev_offsets, n, routes) || rev_src.size() != routes || rev_edge.size() != routes ||
+            reader.array<double>(SEC_REV_WEIGHT).size() != routes || !idsBelow(rev_src, n, none) ||
+            !idsBelow(rev_edge, routes, none))
+            return false;
+
+        // flights
+        const auto edge_offsets = reader.array<uint32_t>(SEC_EDGE_OFFSETS);
+        const auto edge_dest = reader.array<int>(SEC_EDGE_DEST);
+        const size_t flights = edge_dest.size();
+        const auto edge_airline = reader.array<int>(SEC_EDGE_AIRLINE);
+        const auto edge_equipment = reader.array<int>(SEC_EDGE_EQUIPMENT);
+        if (!offsetsFit(edge_offsets, n, flights) || !idsBelow(edge_dest, n, none) ||
+            reader.array<double>(SEC_EDGE_WEIGHT).size() != flights || edge_airline.size() != flights ||
+            reader.array<int>(SEC_EDGE_AIRLINE_ID).size() != flights || edge_equipment.size() != flights ||
+            reader.array<uint8_t>(SEC_EDGE_STOPS).size() != flights ||
+            reader.array<uint8_t>(SEC_EDGE_CODESHARE).size() != flights ||
+            reader.array<uint16_t>(SEC_EDGE_FLAGS).size() != flights ||
+            !idsBelow(edge_airline, reader.getStrings(SEC_AIRLINE_NAMES).size(), -1) ||
+            !idsBelow(edge_equipment, reader.getStrings(SEC_EQUIPMENT_NAMES).size(), -1))
+            return false;
+        const auto fwd_edge_ids = reader.array<uint32_t>(SEC_FWD_EDGE_IDS);
+        const auto fwd_best_flight = reader.array<uint32_t>(SEC_FWD_BEST_FLIGHT);
+        if (!offsetsFit(reader.array<uint32_t>(SEC_FWD_EDGE_OFFSETS), routes, fwd_edge_ids.size()) ||
+            !idsBelow(fwd_edge_ids, flights, none) || fwd_best_flight.size() != routes ||
+            !idsBelow(fwd_best_flight, flights, none))
+            return false;
+
+        // hash indexes
+        const auto direct_keys = reader.array<uint64_t>(SEC_DIRECT_KEYS);
+        const auto direct_routes = reader.array<uint32_t>(SEC_DIRECT_ROUTES);
+        if (!probeTableFits(direct_keys, direct_routes.size(), DIRECT_EMPTY))
+            return false;
+        for (size_t slot = 0; slot < direct_keys.size(); slot++)
+            if (direct_keys[slot] != DIRECT_EMPTY && direct_routes[slot] >= routes)
+                return false;
+        const auto code_keys = reader.array<uint32_t>(SEC_CODE_KEYS);
+        const auto code_values = reader.array<int>(SEC_CODE_VALUES);
+        if (!probeTableFits(code_keys, code_values.size(), 0u))
+            return false;
+        for (size_t slot = 0; slot < code_keys.size(); slot++)
+            if (code_keys[slot] != 0 && (code_values[slot] < 0 || (size_t)code_values[slot] >= n))
+                return false;
+
+        // geography and components
+        if (reader.array<GeoPoint>(SEC_AIRPORT_GEO).size() != n || reader.array<GeoBound>(SEC_GEO_BOUND).size() != 1)
+            return false;
+        const auto scc_id = reader.array<int>(SEC_SCC_ID);
+        const auto scc_dag_row = reader.array<int>(SEC_SCC_DAG_ROW);
+        const size_t components = reader.array<uint32_t>(SEC_SCC_SIZE).size();
+        if (scc_id.size() != n || !idsBelow(scc_id, components, none) || scc_dag_row.size() != components)
+            return false;
+        const size_t rows = count_if(scc_dag_row.begin(), scc_dag_row.end(), [](int row) { return row >= 0; });
+        const size_t reach = reader.array<uint64_t>(SEC_SCC_REACH).size();
+        return idsBelow(scc_dag_row, rows, -1) && (reach == 0 || reach == rows * ((rows + 63) / 64));
+    }
+
+    // Calls f(section_id, column) for every column stored in a snapshot
+    template <class F>
+    void forEachColumn(F f) {
+        f(SEC_FWD_OFFSETS, fwd_offsets);
+        f(SEC_FWD_DEST, fwd_dest);
+        f(SEC_FWD_WEIGHT, fwd_weight);
+        f(SEC_FWD_EDGE_OFFSETS, fwd_edge_offsets);
+        f(SEC_FWD_EDGE_IDS, fwd_edge_ids);
+        f(SEC_DIRECT_KEYS, direct_keys);
+        f(SEC_DIRECT_ROUTES, direct_routes);
+        f(SEC_EDGE_OFFSETS, edge_offsets);
+        f(SEC_EDGE_DEST, edge_dest);
+        f(SEC_EDGE_WEIGHT, edge_weight);
+        f(SEC_EDGE_AIRLINE, edge_airline);
+        f(SEC_EDGE_AIRLINE_ID, edge_airline_id);
+        f(SEC_EDGE_EQUIPMENT, edge_equipment);
+        f(SEC_EDGE_STOPS, edge_stops);
+        f(SEC_EDGE_CODESHARE, edge_codeshare);
+        f(SEC_REV_OFFSETS, rev_offsets);
+        f(SEC_REV_SRC, rev_src);
+        f(SEC_REV_WEIGHT, rev_weight);
+        f(SEC_REV_EDGE, rev_edge);
+        f(SEC_AIRPORT_GEO, airport_geo);
+        f(SEC_GEO_BOUND, geo_bound);
+        f(SEC_CODE_KEYS, code_index.keys);
+        f(SEC_CODE_VALUES, code_index.values);
+        f(SEC_SCC_ID, scc_id);
+        f(SEC_SCC_SIZE, scc_size);
+        f(SEC_SCC_DAG_ROW, scc_dag_row);
+        f(SEC_SCC_REACH, scc_reach);
+        f(SEC_EDGE_FLAGS, edge_flags);
+        f(SEC_FWD_BEST_FLIGHT, fwd_best_flight);
+    }
+
+    template <class F>
+    void forEachColumn(F f) const {
+        const_cast<FlightGraph*>(this)->forEachColumn([&](uint32_t id, const auto& col) { f(id, col); });
+    }
+
+    // Maps airport_CODE -> index in Airports vector
+    AirportCodeIndex code_index;
+
+    size_t scc_reach_words = 0;     // uint64_t words per scc_reach row, 0 without a closure table
+
+    // Edges read by a loader but not yet merged into the CSR arrays (see freeze())
+    vector<int> staged_src, staged_dest, staged_airline, staged_airline_id, staged_equipment;
+    vector<double> staged_weight;
+    vector<uint8_t> staged_stops, staged_codeshare;
+
+    void stageEdge(int src, int dst, int airline, int airline_id, int stops, int equipment,
+                   bool codeshare, double est_time_hr) {
+        staged_src.push_back(src);
+        staged_dest.push_back(dst);
+        staged_airline.push_back(airline);
+        staged_airline_id.push_back(airline_id);
+        staged_equipment.push_back(equipment);
+        staged_stops.push_back((uint8_t)min(max(stops, 0), 255));
+        staged_codeshare.push_back(codeshare ? 1 : 0);
+        staged_weight.push_back(usableTime(est_time_hr));
+    }
+
+    // Airports with coordinates that reach x (forward = false) or that x reaches (forward = true)
+    // over airports without coordinates only, with the cheapest such chain; just (x, 0) if x has
+    // coordinates itself
+    vector<pair<int, double>> geoChainEnds(int x, bool forward) const {
+        if (airport_geo[x].known())
+            return {{x, 0.0}};
+        vector<pair<int, double>> ends;
+        unordered_map<int, double> best{{x, 0.0}};
+        vector<pair<double, int>> heap{{0.0, x}};
+        while (!heap.empty()) {
+            pop_heap(heap.begin(), heap.end(), greater<pair<double, int>>());
+            auto [d, y] = heap.back();
+            heap.pop_back();
+            if (d > best[y])
+                continue;
+            if (airport_geo[y].known()) {
+                ends.push_back({y, d});
+                continue;
+            }
+            const uint32_t first = forward ? fwd_offsets[y] : rev_offsets[y];
+            const uint32_t last = forward ? fwd_offsets[y + 1] : rev_offsets[y + 1];
+            for (uint32_t i = first; i < last; i++) {
+                const int z = forward ? fwd_dest[i] : rev_src[i];
+                const double nd = d + (forward ? fwd_weight[i] : rev_weight[i]);
+                if (std::isinf(nd) || (best.count(z) && best[z] <= nd))
+                    continue;
+                best[z] = nd;
+                heap.push_back({nd, z});
+                push_heap(heap.begin(), heap.end(), greater<pair<double, int>>());
+            }
+        }
+        return ends;
+    }
+
+    // Lowers the A* bound just enough to stay under one more (hours, miles) segment; true if it
+    // had to change
+    bool loosenGeoBound(double hours, double miles) {
+        GeoBound bound = geo_bound[0];
+        if (hours >= bound.offset_hr + bound.hr_per_mile * miles)
+            return false;
+        if (hours < bound.offset_hr)
+            bound.offset_hr = hours * (1 - 1e-9);
+        if (miles > 0 && hours < bound.offset_hr + bound.hr_per_mile * miles)
+            bound.hr_per_mile = max(0.0, (hours - bound.offset_hr) / miles) * (1 - 1e-9);
+        geo_bound = vector<GeoBound>{bound};
+        return true;
+    }
+
+    // Missing or negative times become +inf so the search loops need no extra check
+    static double usableTime(double est_time_hr) {
+        return std::isnan(est_time_hr) || est_time_hr < 0 ? numeric_limits<double>::infinity() : est_time_hr;
+    }
+
+    // Merges staged edges into the edge_* arrays. Each airport keeps its existing edges first,
+    // followed by its staged edges in the order they were added.
+    // Flights flagged in `drop` are left out: index e for edge e, edgeCount() + i for staged edge i.
+    // It may be empty or shorter than that; missing entries keep the flight.
+    void mergeStagedEdges(const vector<uint8_t>& drop = {}) {
+        const int num_airports = airports.size();
+        if (staged_src.empty() && drop.empty() && (int)edge_offsets.size() == num_airports + 1)
+            return;
+
+        const size_t staged_base = edge_dest.size();
+        auto kept = [&](size_t f) { return f >= drop.size() || !drop[f]; };
+        vector<uint32_t> offsets(num_airports + 1, 0);
+        for (int u = 0; u + 1 < (int)edge_offsets.size(); u++)
+            for (uint32_t e = edge_offsets[u]; e < edge_offsets[u + 1]; e++)
+                offsets[u + 1] += kept(e);
+        for (size_t i = 0; i < staged_src.size(); i++)
+            offsets[staged_src[i] + 1] += kept(staged_base + i);
+        for (int u = 0; u < num_airports; u++)
+            offsets[u + 1] += offsets[u];
+
+        const size_t num_edges = offsets[num_airports];
+        vector<int> dest(num_edges), airline(num_edges), airline_id(num_edges), equipment(num_edges);
+        vector<double> weight(num_edges);
+        vector<uint8_t> stops(num_edges), codeshare(num_edges);
+
+        vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+        auto place = [&](int u, int d, double w, int al, int al_id, int eq, uint8_t st, uint8_t cs) {
+            const uint32_t e = cursor[u]++;
+            dest[e] = d;
+            weight[e] = w;
+            airline[e] = al;
+            airline_id[e] = al_id;
+            equipment[e] = eq;
+            stops[e] = st;
+            codeshare[e] = cs;
+        };
+        for (int u = 0; u + 1 < (int)edge_offsets.size(); u++) {
+            for (uint32_t e = edge_offsets[u]; e < edge_offsets[u + 1]; e++)
+                if (kept(e))
+                    place(u, edge_dest[e], edge_weight[e], edge_airline[e], edge_airline_id[e],
+                          edge_equipment[e], edge_stops[e], edge_codeshare[e]);
+        }
+        for (size_t i = 0; i < staged_src.size(); i++)
+            if (kept(staged_base + i))
+                place(staged_src[i], staged_dest[i], staged_weight[i], staged_airline[i], staged_airline_id[i],
+                      staged_equipment[i], staged_stops[i], staged_codeshare[i]);
+
+        edge_offsets = std::move(offsets);
+        edge_dest = std::move(dest);
+        edge_weight = std::move(weight);
+        edge_airline = std::move(airline);
+        edge_airline_id = std::move(airline_id);
+        edge_equipment = std::move(equipment);
+        edge_stops = std::move(stops);
+        edge_codeshare = std::move(codeshare);
+
+        staged_src.clear();
+        staged_dest.clear();
+        staged_weight.clear();
+        staged_airline.clear();
+        staged_airline_id.clear();
+        staged_equipment.clear();
+        staged_stops.clear();
+        staged_codeshare.clear();
+    }
+
+    // New -> old airport numbering for reorder(). Airports without routes always go last, in
+    // load order.
+    vector<int> airportOrder(AirportOrder strategy) const {
+        const int num_airports = airports.size();
+        vector<int> order(num_airports);
+        for (int v = 0; v < num_airports; v++)
+            order[v] = v;
+        if (strategy == AirportOrder::LOAD)
+            return order;
+
+        vector<uint32_t> degree(num_airports);
+        for (int v = 0; v < num_airports; v++)
+            degree[v] = (fwd_offsets[v + 1] - fwd_offsets[v]) + (rev_offsets[v + 1] - rev_offsets[v]);
+        vector<int> by_degree = order;
+        stable_sort(by_degree.begin(), by_degree.end(), [&](int a, int b) { return degree[a] > degree[b]; });
+        if (strategy == AirportOrder::DEGREE)
+            return by_degree;
+
+        // breadth-first over routes in both directions, one component at a time; `out` doubles
+        // as the queue. BFS starts from the busiest unvisited airport, RCM from the quietest.
+        const bool rcm = strategy == AirportOrder::RCM;
+        vector<char> seen(num_airports, 0);
+        vector<int> out, neighbours;
+        out.reserve(num_airports);
+        auto visit = [&](int v) {
+            if (!seen[v]) {
+                seen[v] = 1;
+                neighbours.push_back(v);
+            }
+        };
+        for (int k = 0; k < num_airports; k++) {
+            const int root = rcm ? by_degree[num_airports - 1 - k] : by_degree[k];
+            if (seen[root] || degree[root] == 0)
+                continue;
+            seen[root] = 1;
+            out.push_back(root);
+            for (size_t head = out.size() - 1; head < out.size(); head++) {
+                const int u = out[head];
+                neighbours.clear();
+                for (uint32_t e = fwd_offsets[u]; e < fwd_offsets[u + 1]; e++)
+                    visit(fwd_dest[e]);
+                for (uint32_t e = rev_offsets[u]; e < rev_offsets[u + 1]; e++)
+                    visit(rev_src[e]);
+                if (rcm)
+                    stable_sort(neighbours.begin(), neighbours.end(), [&](int a, int b) { return degree[a] < degree[b]; });
+                out.insert(out.end(), neighbours.begin(), neighbours.end());
+            }
+        }
+        if (rcm)
+            reverse(out.begin(), out.end());
+        for (int v = 0; v < num_airports; v++)
+            if (degree[v] == 0)
+                out.push_back(v);
+        return out;
+    }
+
+    // Rebuilds everything derived from the airports and CSR arrays
+    void buildDerivedIndexes() {
+        buildFlightFlags();
+        buildRouteIndex();
+        buildDirectIndex();
+        buildReverseIndex();
+        buildGeoIndex();
+        buildSccIndex();
+    }
+
+    // FlightFilter::Flag bits of every flight, from its carrier, aircraft codes and codeshare flag.
+    // Carriers and equipment lists are classified once per interned name.
+    void buildFlightFlags() {
+        vector<uint16_t> alliance(airline_names.names.size()), equipment(equipment_names.names.size());
+        for (size_t i = 0; i < alliance.size(); i++)
+            alliance[i] = allianceOf(airline_names.names[i]);
+        for (size_t i = 0; i < equipment.size(); i++)
+            equipment[i] = equipmentClasses(equipment_names.names[i]);
+        vector<uint16_t> flags(edgeCount());
+        for (size_t e = 0; e < flags.size(); e++)
+            flags[e] = alliance[edge_airline[e]] | equipment[edge_equipment[e]] |
+                       (edge_codeshare[e] ? FlightFilter::CODESHARE : 0);
+        edge_flags = std::move(flags);
+    }
+
+    // Collapses the flights of each airport into one route per destination, in order of first
+    // appearance, weighted by the fastest usable flight. Pairs with no usable flight get no route.
+    void buildRouteIndex() {
+        const int num_airports = airports.size();
+        vector<uint32_t> offsets(num_airports + 1, 0), edge_offs(1, 0), edge_ids, best_flight;
+        vector<int> dest;
+        vector<double> weight;
+        vector<int> slot(num_airports, -1);     // route of each destination of the current airport
+        vector<int> order;
+        vector<vector<uint32_t>> flights;
+        for (int u = 0; u < num_airports; u++) {
+            order.clear();
+            for (uint32_t e = edge_offsets[u]; e < edge_offsets[u + 1]; e++) {
+                const int v = edge_dest[e];
+                if (std::isinf(edge_weight[e]))
+                    continue;
+                if (slot[v] < 0) {
+                    slot[v] = (int)order.size();
+                    order.push_back(v);
+                    if (flights.size() < order.size())
+                        flights.emplace_back();
+                    flights[slot[v]].clear();
+                }
+                flights[slot[v]].push_back(e);
+            }
+            for (size_t i = 0; i < order.size(); i++) {
+                double best = numeric_limits<double>::infinity();
+                uint32_t best_e = 0;
+                for (uint32_t e : flights[i]) {
+                    if (edge_weight[e] < best) {
+                        best = edge_weight[e];
+                        best_e = e;
+                    }
+                    edge_ids.push_back(e);
+                }
+                dest.push_back(order[i]);
+                weight.push_back(best);
+                best_flight.push_back(best_e);
+                edge_offs.push_back((uint32_t)edge_ids.size());
+                slot[order[i]] = -1;
+            }
+            offsets[u + 1] = (uint32_t)dest.size();
+        }
+
+        fwd_offsets = std::move(offsets);
+        fwd_dest = std::move(dest);
+        fwd_weight = std::move(weight);
+        fwd_edge_offsets = std::move(edge_offs);
+        fwd_edge_ids = std::move(edge_ids);
+        fwd_best_flight = std::move(best_flight);
+    }
+
+    static uint64_t directKey(int src, int dst) {
+        return (uint64_t)(uint32_t)src << 32 | (uint32_t)dst;
+    }
+
+    static uint64_t directHash(uint64_t key) {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        return key;
+    }
+
+    // Open-addressing (src, dst) -> route table at most half full
+    void buildDirectIndex() {
+        size_t capacity = 16;
+        while (capacity < 2 * routeCount())
+            capacity *= 2;
+        vector<uint64_t> keys(capacity, DIRECT_EMPTY);
+        vector<uint32_t> routes(capacity, 0);
+        const size_t mask = capacity - 1;
+        for (int u = 0; u + 1 < (int)fwd_offsets.size(); u++) {
+            for (uint32_t r = fwd_offsets[u]; r < fwd_offsets[u + 1]; r++) {
+                const uint64_t key = directKey(u, fwd_dest[r]);
+                size_t slot = directHash(key) & mask;
+                while (keys[slot] != DIRECT_EMPTY)
+                    slot = (slot + 1) & mask;
+                keys[slot] = key;
+                routes[slot] = r;
+            }
+        }
+        direct_keys = std::move(keys);
+        direct_routes = std::move(routes);
+    }
+
+    // Incoming-route CSR: a stable counting sort of the routes by destination
+    void buildReverseIndex() {
+        const int num_airports = airports.size();
+        const size_t num_edges = routeCount();
+        vector<uint32_t> offsets(num_airports + 1, 0);
+        for (size_t e = 0; e < num_edges; e++)
+            offsets[fwd_dest[e] + 1]++;
+        for (int v = 0; v < num_airports; v++)
+            offsets[v + 1] += offsets[v];
+
+        vector<int> src(num_edges);
+        vector<double> weight(num_edges);
+        vector<uint32_t> edge(num_edges);
+        vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+        for (int u = 0; u < num_airports; u++) {
+            for (uint32_t e = fwd_offsets[u]; e < fwd_offsets[u + 1]; e++) {
+                const uint32_t r = cursor[fwd_dest[e]]++;
+                src[r] = u;
+                weight[r] = fwd_weight[e];
+                edge[r] = e;
+            }
+        }
+
+        rev_offsets = std::move(offsets);
+        rev_src = std::move(src);
+        rev_weight = std::move(weight);
+        rev_edge = std::move(edge);
+    }
+
+    // Tarjan's algorithm over the routes, iteratively (the stack of open calls lives in `frames`),
+    // then the closure of the component DAG. Components complete sinks first, so by the time a
+    // component's row is filled every component it has a route to already has its final row.
+    void buildSccIndex() {
+        const int num_airports = airports.size();
+        vector<int> id(num_airports, -1), index(num_airports, -1), low(num_airports, 0);
+        vector<int> stack;
+        vector<pair<int, uint32_t>> frames;     // (airport, next route to look at)
+        vector<uint32_t> sizes;
+        int next_index = 0;
+        for (int root = 0; root < num_airports; root++) {
+            if (index[root] >= 0)
+                continue;
+            index[root] = low[root] = next_index++;
+            stack.push_back(root);
+            frames.push_back({root, fwd_offsets[root]});
+            while (!frames.empty()) {
+                auto& [u, e] = frames.back();
+                if (e < fwd_offsets[u + 1]) {
+                    const int v = fwd_dest[e++];
+                    if (index[v] < 0) {
+                        index[v] = low[v] = next_index++;
+                        stack.push_back(v);
+                        frames.push_back({v, fwd_offsets[v]});
+                    } else if (id[v] < 0) {
+                        low[u] = min(low[u], index[v]);     // v is still on the stack
+                    }
+                    continue;
+                }
+                const int done = u;
+                frames.pop_back();
+                if (!frames.empty())
+                    low[frames.back().first] = min(low[frames.back().first], low[done]);
+                if (low[done] == index[done]) {
+                    const int c = (int)sizes.size();
+                    uint32_t count = 0;
+                    int v;
+                    do {
+                        v = stack.back();
+                        stack.pop_back();
+                        id[v] = c;
+                        count++;
+                    } while (v != done);
+                    sizes.push_back(count);
+                }
+            }
+        }
+
+        const int num_components = sizes.size();
+        vector<int> row(num_components, -1);
+        int rows = 0;
+        for (int u = 0; u < num_airports; u++) {
+            for (uint32_t e = fwd_offsets[u]; e < fwd_offsets[u + 1]; e++) {
+                const int a = id[u], b = id[fwd_dest[e]];
+                if (a != b) {
+                    if (row[a] < 0)
+                        row[a] = rows++;
+                    if (row[b] < 0)
+                        row[b] = rows++;
+                }
+            }
+        }
+
+        vector<uint64_t> reach;
+        if ((size_t)rows <= SCC_REACH_MAX_ROWS) {
+            const size_t words = (rows + 63) / 64;
+            reach.assign((size_t)rows * words, 0);
+            vector<vector<int>> members(num_components);
+            for (int u = 0; u < num_airports; u++)
+                if (row[id[u]] >= 0)
+                    members[id[u]].push_back(u);
+            for (int c = 0; c < num_components; c++) {
+                if (row[c] < 0)
+                    continue;
+                uint64_t* mine = &reach[(size_t)row[c] * words];
+                mine[row[c] / 64] |= 1ULL << (row[c] % 64);
+                for (int u : members[c]) {
+                    for (uint32_t e = fwd_offsets[u]; e < fwd_offsets[u + 1]; e++) {
+                        const int b = id[fwd_dest[e]];
+                        if (b == c)
+                            continue;
+                        const uint64_t* theirs = &reach[(size_t)row[b] * words];
+                        for (size_t w = 0; w < words; w++)
+                            mine[w] |= theirs[w];
+                    }
+                }
+            }
+        }
+
+        scc_id = std::move(id);
+        scc_size = std::move(sizes);
+        scc_dag_row = std::move(row);
+        scc_reach = std::move(reach);
+        attachSccIndex();
+    }
+
+    // Derives the closure row width from the columns (after building or mapping them)
+    void attachSccIndex() {
+        size_t rows = 0;
+        for (size_t c = 0; c < scc_dag_row.size(); c++)
+            rows += scc_dag_row[c] >= 0;
+        scc_reach_words = scc_reach.empty() ? 0 : (rows + 63) / 64;
+    }
+
+    // Unit vectors for airports with coordinates, plus the GeoBound calibration. The bound must
+    // hold for every path between two airports with coordinates, so it is fitted over direct
+    // edges and over chains that pass only through airports without coordinates.
+    void buildGeoIndex() {
+        const int num_airports = airports.size();
+        const double nan = numeric_limits<double>::quiet_NaN();
+        vector<GeoPoint> geo(num_airports, GeoPoint{nan, nan, nan});
+        for (int i = 0; i < num_airports; i++)
+            if (airports[i].has_coords)
+                geo[i] = GeoPoint::fromLatLon(airports[i].latitude, airports[i].longitude);
+
+        // segments (weight, miles) between known airports
+        vector<pair<double, double>> segments;
+        vector<pair<double, int>> heap;
+        unordered_map<int, double> best;
+        for (int a = 0; a < num_airports; a++) {
+            if (!geo[a].known())
+                continue;
+            heap.clear();
+            best.clear();
+            for (uint32_t e = fwd_offsets[a]; e < fwd_offsets[a + 1]; e++) {
+                const int b = fwd_dest[e];
+                if (std::isinf(fwd_weight[e]))
+                    continue;
+                if (geo[b].known())
+                    segments.push_back({fwd_weight[e], greatCircleMiles(geo[a], geo[b])});
+                else if (!best.count(b) || fwd_weight[e] < best[b]) {
+                    best[b] = fwd_weight[e];
+                    heap.push_back({fwd_weight[e], b});
+                    push_heap(heap.begin(), heap.end(), greater<pair<double, int>>());
+                }
+            }
+            // cheapest chains a -> (no coordinates)+ -> b
+            while (!heap.empty()) {
+                pop_heap(heap.begin(), heap.end(), greater<pair<double, int>>());
+                auto [d, x] = heap.back();
+                heap.pop_back();
+                if (d > best[x])
+                    continue;
+                for (uint32_t e = fwd_offsets[x]; e < fwd_offsets[x + 1]; e++) {
+                    const int b = fwd_dest[e];
+                    const double nd = d + fwd_weight[e];
+                    if (std::isinf(nd))
+                        continue;
+                    if (geo[b].known())
+                        segments.push_back({nd, greatCircleMiles(geo[a], geo[b])});
+                    else if (!best.count(b) || nd < best[b]) {
+                        best[b] = nd;
+                        heap.push_back({nd, b});
+                        push_heap(heap.begin(), heap.end(), greater<pair<double, int>>());
+                    }
+                }
+            }
+        }
+
+        // Every (offset, slope) with weight >= offset + slope * miles on all segments is valid.
+        // Raising the offset lowers the best slope, so try a few offsets and keep the pair
+        // that gives the largest bound at the median segment length.
+        //
+        // The fit is only as tight as the fastest segment per mile. On the bundled data that is
+        // far below the OpenFlights formula (30 min + 1 h / 500 mi): about 39% of the direct
+        // segments between known airports are more than 10% faster than it (the 33k added routes
+        // carry times unrelated to distance, e.g. GKA-MEI 1.85 h for 8518 mi), which gives about
+        // 0.49 h + 0.000037 h/mi. Dropping those segments would make the bound inadmissible and
+        // astar() inexact, so the bound stays loose there and A* settles about 60% of the
+        // airports dijkstra() does; data that follows the formula gets the formula back.
+        GeoBound bound;
+        if (!segments.empty()) {
+            double max_offset = 0.5;    // the OpenFlights formula's fixed 30 minutes
+            vector<double> miles;
+            for (auto& sg : segments) {
+                max_offset = min(max_offset, sg.first);
+                miles.push_back(sg.second);
+            }
+            nth_element(miles.begin(), miles.begin() + miles.size() / 2, miles.end());
+            const double reference_miles = miles[miles.size() / 2];
+
+            double best_value = -1.0;
+            const int steps = 50;
+            for (int i = 0; i <= steps; i++) {
+                const double offset = max(0.0, max_offset * i / steps);
+                double slope = numeric_limits<double>::infinity();
+                for (auto& sg : segments)
+                    if (sg.second > 0)
+                        slope = min(slope, (sg.first - offset) / sg.second);
+                if (std::isinf(slope))
+                    slope = 0.0;
+                slope = max(0.0, slope);
+                if (offset + slope * reference_miles > best_value) {
+                    best_value = offset + slope * reference_miles;
+                    bound.offset_hr = offset;
+                    bound.hr_per_mile = slope;
+                }
+            }
+            // shave a little off so rounding can never make the bound exceed a true distance
+            bound.offset_hr *= 1 - 1e-9;
+            bound.hr_per_mile *= 1 - 1e-9;
+        }
+
+        airport_geo = std::move(geo);
+        geo_bound = vector<GeoBound>{bound};
+    }
+
+    // Return existing airport index by CODE, or create a new node.
+    int getOrCreateAirportIndexByCode(string_view code) {
+        const int found = code_index.find(code);
+        if (found >= 0) //if found
+            return found;
+
+        //if not in the vector then add it
+        Airport ap;
+        ap.code = string(code);
+
+        const int idx = (int)airports.size();
+        code_index.insert(ap.code, idx);
+        airports.push_back(std::move(ap));
+        return idx;
+    }
+};
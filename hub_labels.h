@@ -0,0 +1,394 @@
+#pragma once
+#include <random>
+#include "graph.h"
+
+// Build statistics of a HubLabelIndex
+struct HubLabelStats {
+    double build_ms = 0;
+    size_t out_entries = 0, in_entries = 0;
+    size_t airports = 0;
+    size_t max_label = 0;           // largest single label (out or in)
+    size_t bytes = 0;               // all label columns
+
+    void print(ostream& out) const {
+        const double avg = airports ? (double)(out_entries + in_entries) / (2.0 * airports) : 0.0;
+        out << fixed << setprecision(2)
+            << "hub labels: built in " << build_ms << " ms | out " << out_entries << " in " << in_entries
+            << " entries (avg " << avg << ", max " << max_label << ") | " << bytes / 1048576.0 << " MiB\n";
+    }
+};
+
+// 2-hop hub labels over a FlightGraph, built by pruned landmark labeling (Akiba et al.).
+//
+// Every airport u gets an out label {(h, d(u, h))} and an in label {(h, d(h, u))}, both sorted by
+// hub rank, such that every pair s, t shares a hub on one of its fastest routes. A distance is then
+// a merge-join of out(s) and in(t), with no search at all.
+//
+// build() visits airports in rank order (most routes first) and runs a forward and a backward
+// Dijkstra from each. A search does not label or expand an airport the labels built so far already
+// cover at that distance, which keeps labels small. Searches for a batch of consecutive ranks run
+// in parallel against the labels of earlier batches only; that can only add redundant entries,
+// never drop needed ones, and batches start at one airport and grow so the important top ranks
+// still prune each other.
+//
+// Each entry also stores the next airport towards its hub (out) or from its hub (in) on the search
+// tree, whose own label holds the same hub, so paths unpack hop by hop. The index keeps a pointer
+// to its graph, like ContractionHierarchy.
+class HubLabelIndex {
+public:
+    Column<int> order;              // [rank] = airport
+    Column<uint32_t> out_offsets;
+    Column<int> out_hub;            // hub rank
+    Column<double> out_dist;        // d(u, hub)
+    Column<int> out_next;           // next airport towards the hub, -1 at the hub
+    Column<uint32_t> in_offsets;
+    Column<int> in_hub;
+    Column<double> in_dist;         // d(hub, u)
+    Column<int> in_prev;            // previous airport from the hub, -1 at the hub
+    HubLabelStats stats;
+
+    // num_threads <= 0 means one per hardware thread; one thread is plain sequential PLL
+    void build(const FlightGraph& G, int num_threads = 0) {
+        auto start = chrono::steady_clock::now();
+        graph = &G;
+        stats = HubLabelStats();
+        const int n = G.airports.size();
+        if (num_threads <= 0)
+            num_threads = max(1u, thread::hardware_concurrency());
+
+        auto degree = [&](int v) {
+            return (G.fwd_offsets[v + 1] - G.fwd_offsets[v]) + (G.rev_offsets[v + 1] - G.rev_offsets[v]);
+        };
+        vector<int> by_rank(n);
+        for (int v = 0; v < n; v++)
+            by_rank[v] = v;
+        stable_sort(by_rank.begin(), by_rank.end(), [&](int a, int b) { return degree(a) > degree(b); });
+
+        vector<vector<Entry>> out_labels(n), in_labels(n);
+        vector<Worker> workers(num_threads);
+        for (Worker& w : workers)
+            w.hub_dist.assign(n, numeric_limits<double>::infinity());
+
+        // per batch item: the entries its forward and backward searches found
+        vector<vector<Found>> fwd_found, bwd_found;
+        int done = 0;
+        while (done < n) {
+            const int batch = num_threads == 1 ? 1 : min(n - done, clamp(done / 8, 1, 64 * num_threads));
+            fwd_found.assign(batch, {});
+            bwd_found.assign(batch, {});
+            WorkStealingLoop::run(batch, num_threads, 1, [&](int worker, size_t i) {
+                const int r = done + (int)i;
+                prunedSearch(G, by_rank[r], false, out_labels, in_labels, workers[worker], fwd_found[i]);
+                prunedSearch(G, by_rank[r], true, in_labels, out_labels, workers[worker], bwd_found[i]);
+            });
+            // appending in rank order keeps every label sorted by hub rank
+            for (int i = 0; i < batch; i++) {
+                for (const Found& f : fwd_found[i])
+                    in_labels[f.node].push_back({done + i, f.dist, f.link});
+                for (const Found& f : bwd_found[i])
+                    out_labels[f.node].push_back({done + i, f.dist, f.link});
+            }
+            done += batch;
+        }
+
+        order = std::move(by_rank);
+        flatten(out_labels, out_offsets, out_hub, out_dist, out_next);
+        flatten(in_labels, in_offsets, in_hub, in_dist, in_prev);
+        finishStats();
+        stats.build_ms = msSince(start);
+    }
+
+    // Fastest time from s to t (+inf if unreachable). Sums the two label halves, so it can differ
+    // from dijkstra() in the last bits; route() re-sums the unpacked path.
+    double distance(int s, int t) const {
+        return meet(s, t).first;
+    }
+
+    pair<double, vector<string>> route(const string& source_code, const string& destination_code) const {
+        vector<string> empty_path;
+        const int s = graph->findAirportIndexByCode(source_code);
+        const int t = graph->findAirportIndexByCode(destination_code);
+        if (s < 0 || t < 0)
+            return {numeric_limits<double>::infinity(), empty_path};
+        const vector<int> nodes = path(s, t);
+        if (nodes.empty())
+            return {numeric_limits<double>::infinity(), empty_path};
+        vector<string> codes;
+        for (int v : nodes)
+            codes.push_back(graph->airports[v].code);
+        return {graph->pathTime(nodes), codes};
+    }
+
+    // Airports on a fastest route from s to t (empty if unreachable): s up to the best common hub
+    // along out_next, then the hub down to t along in_prev
+    vector<int> path(int s, int t) const {
+        const auto [dist, hub] = meet(s, t);
+        vector<int> nodes;
+        if (std::isinf(dist))
+            return nodes;
+        for (int v = s; v != -1; v = out_next[findHub(out_offsets, out_hub, v, hub)])
+            nodes.push_back(v);
+        vector<int> tail;
+        for (int v = in_prev[findHub(in_offsets, in_hub, t, hub)]; v != -1; v = in_prev[findHub(in_offsets, in_hub, v, hub)])
+            tail.push_back(v);
+        // tail runs from t's predecessor back to the hub, which is already in nodes
+        if (!tail.empty())
+            tail.pop_back();
+        nodes.insert(nodes.end(), tail.rbegin(), tail.rend());
+        if (t != order[hub])
+            nodes.push_back(t);
+        return nodes;
+    }
+
+    // Compares distance() and path() with dijkstra() on `samples` random pairs of airports that
+    // have routes. Returns the number of pairs that disagree.
+    size_t validate(size_t samples, uint32_t seed = 1) const {
+        vector<int> routed;
+        for (int v = 0; v < (int)graph->airports.size(); v++)
+            if (graph->fwd_offsets[v + 1] > graph->fwd_offsets[v])
+                routed.push_back(v);
+        if (routed.empty())
+            return 0;
+        mt19937 rng(seed);
+        QueryWorkspace& ws = QueryWorkspace::forThisThread();
+        size_t bad = 0;
+        for (size_t i = 0; i < samples; i++) {
+            const int s = routed[rng() % routed.size()], t = routed[rng() % routed.size()];
+            const double expected = graph->dijkstra(s, t, ws);
+            const double got = distance(s, t);
+            const vector<int> nodes = path(s, t);
+            bool ok;
+            if (std::isinf(expected))
+                ok = std::isinf(got) && nodes.empty();
+            else
+                ok = fabs(got - expected) <= 1e-9 * expected && !nodes.empty() && nodes.front() == s &&
+                     nodes.back() == t && fabs(graph->pathTime(nodes) - expected) <= 1e-9 * expected;
+            bad += !ok;
+        }
+        return bad;
+    }
+
+    // Writes the labels to their own snapshot-format file, tagged with the graph fingerprint
+    bool save(const string& path) const {
+        SnapshotWriter writer;
+        const uint64_t fp = graph->fingerprint();
+        writer.add(SEC_GRAPH_FINGERPRINT, &fp, 1);
+        forEachColumn([&](uint32_t id, const auto& col) {
+            writer.add(id, col.data(), col.size());
+        });
+        return writer.write(path, SnapshotSourceStamp(), SnapshotSourceStamp());
+    }
+
+    // Maps saved labels; fails if they were built from a different graph or do not fit it. On
+    // failure the current labels stay as they were.
+    bool open(const string& path, const FlightGraph& G, bool verify_payload = false) {
+        auto file = make_shared<MappedFile>();
+        SnapshotReader reader;
+        if (!file->open(path) || !reader.open(file->data(), file->size(), verify_payload))
+            return false;
+        size_t count = 0;
+        const uint64_t* fp = reader.get<uint64_t>(SEC_GRAPH_FINGERPRINT, count);
+        if (!fp || count != 1 || *fp != G.fingerprint())
+            return false;
+
+        bool complete = true;
+        forEachColumn([&](uint32_t id, auto& col) {
+            using T = typename remove_reference_t<decltype(col)>::value_type;
+            size_t n = 0;
+            complete = complete && reader.get<T>(id, n) != nullptr;
+        });
+        if (!complete)
+            return false;
+
+        const size_t n = G.airports.size();
+        size_t order_count = 0;
+        reader.get<int>(SEC_HL_ORDER, order_count);
+        if (order_count != n)
+            return false;
+        // offsets: n + 1 entries rising from 0 to the entry count of the three label columns
+        auto labelsFit = [&](uint32_t offsets_id, uint32_t hub_id, uint32_t dist_id, uint32_t link_id) {
+            size_t offsets_count = 0, hub_count = 0, dist_count = 0, link_count = 0;
+            const uint32_t* off = reader.get<uint32_t>(offsets_id, offsets_count);
+            reader.get<int>(hub_id, hub_count);
+            reader.get<double>(dist_id, dist_count);
+            reader.get<int>(link_id, link_count);
+            if (offsets_count != n + 1 || off[0] != 0 || off[n] != hub_count || dist_count != hub_count ||
+                link_count != hub_count)
+                return false;
+            for (size_t v = 0; v < n; v++)
+                if (off[v] > off[v + 1])
+                    return false;
+            return true;
+        };
+        if (!labelsFit(SEC_HL_OUT_OFFSETS, SEC_HL_OUT_HUB, SEC_HL_OUT_DIST, SEC_HL_OUT_NEXT) ||
+            !labelsFit(SEC_HL_IN_OFFSETS, SEC_HL_IN_HUB, SEC_HL_IN_DIST, SEC_HL_IN_PREV))
+            return false;
+
+        forEachColumn([&](uint32_t id, auto& col) {
+            using T = typename remove_reference_t<decltype(col)>::value_type;
+            size_t count = 0;
+            const T* p = reader.get<T>(id, count);
+            col.mapTo(p, count);
+        });
+        mapped_file = file;
+        graph = &G;
+        stats = HubLabelStats();
+        finishStats();
+        return true;
+    }
+
+private:
+    struct Entry {
+        int hub;                    // rank
+        double dist;
+        int link;                   // out_next / in_prev
+    };
+
+    struct Found {
+        int node;
+        double dist;
+        int link;
+    };
+
+    // Scratch for one build thread
+    struct Worker {
+        QueryWorkspace ws;
+        vector<double> hub_dist;    // [rank] = root's label distance, +inf elsewhere
+    };
+
+    const FlightGraph* graph = nullptr;
+    shared_ptr<MappedFile> mapped_file;
+
+    template <class F>
+    void forEachColumn(F f) {
+        f(SEC_HL_ORDER, order);
+        f(SEC_HL_OUT_OFFSETS, out_offsets);
+        f(SEC_HL_OUT_HUB, out_hub);
+        f(SEC_HL_OUT_DIST, out_dist);
+        f(SEC_HL_OUT_NEXT, out_next);
+        f(SEC_HL_IN_OFFSETS, in_offsets);
+        f(SEC_HL_IN_HUB, in_hub);
+        f(SEC_HL_IN_DIST, in_dist);
+        f(SEC_HL_IN_PREV, in_prev);
+    }
+
+    template <class F>
+    void forEachColumn(F f) const {
+        const_cast<HubLabelIndex*>(this)->forEachColumn([&](uint32_t id, const auto& col) { f(id, col); });
+    }
+
+    // (distance, hub rank) of the best common hub of out(s) and in(t); (+inf, -1) if none
+    pair<double, int> meet(int s, int t) const {
+        uint32_t i = out_offsets[s], j = in_offsets[t];
+        const uint32_t i_end = out_offsets[s + 1], j_end = in_offsets[t + 1];
+        double best = numeric_limits<double>::infinity();
+        int hub = -1;
+        while (i < i_end && j < j_end) {
+            if (out_hub[i] < in_hub[j]) {
+                i++;
+            } else if (out_hub[i] > in_hub[j]) {
+                j++;
+            } else {
+                const double d = out_dist[i] + in_dist[j];
+                if (d < best) {
+                    best = d;
+                    hub = out_hub[i];
+                }
+                i++;
+                j++;
+            }
+        }
+        return {best, hub};
+    }
+
+    // Index of hub rank `hub` in v's label (which must contain it)
+    static uint32_t findHub(const Column<uint32_t>& offsets, const Column<int>& hubs, int v, int hub) {
+        const int* first = hubs.data() + offsets[v];
+        const int* last = hubs.data() + offsets[v + 1];
+        return (uint32_t)(lower_bound(first, last, hub) - hubs.data());
+    }
+
+    // Pruned Dijkstra from root. Forward (over routes) it finds d(root, u) for in labels and checks
+    // coverage with out(root) x in(u); backward (over reversed routes) it finds d(u, root) for out
+    // labels and checks in(root) x out(u). `root_labels` / `node_labels` are those two sides.
+    static void prunedSearch(const FlightGraph& G, int root, bool backward, const vector<vector<Entry>>& root_labels,
+                             const vector<vector<Entry>>& node_labels, Worker& w, vector<Found>& found) {
+        const Column<uint32_t>& off = backward ? G.rev_offsets : G.fwd_offsets;
+        const Column<int>& adj = backward ? G.rev_src : G.fwd_dest;
+        const Column<double>& weight = backward ? G.rev_weight : G.fwd_weight;
+        QueryWorkspace& ws = w.ws;
+        for (const Entry& e : root_labels[root])
+            w.hub_dist[e.hub] = e.dist;
+
+        ws.begin(G.airports.size());
+        auto later = greater<pair<double, int>>();
+        ws.set(root, 0.0, -1);
+        ws.heap.push_back({0.0, root});
+        while (!ws.heap.empty()) {
+            pop_heap(ws.heap.begin(), ws.heap.end(), later);
+            const auto [d, u] = ws.heap.back();
+            ws.heap.pop_back();
+            if (ws.settled(u))
+                continue;
+            ws.settle(u);
+            if (u != root) {
+                bool covered = false;
+                for (const Entry& e : node_labels[u]) {
+                    if (w.hub_dist[e.hub] + e.dist <= d) {
+                        covered = true;
+                        break;
+                    }
+                }
+                if (covered)
+                    continue;
+            }
+            found.push_back({u, d, ws.parent(u)});
+            for (uint32_t e = off[u]; e < off[u + 1]; e++) {
+                const int v = adj[e];
+                const double candidate = d + weight[e];
+                if (candidate < ws.dist(v)) {
+                    ws.set(v, candidate, u);
+                    ws.heap.push_back({candidate, v});
+                    push_heap(ws.heap.begin(), ws.heap.end(), later);
+                }
+            }
+        }
+
+        for (const Entry& e : root_labels[root])
+            w.hub_dist[e.hub] = numeric_limits<double>::infinity();
+    }
+
+    static void flatten(const vector<vector<Entry>>& labels, Column<uint32_t>& offsets, Column<int>& hubs,
+                        Column<double>& dists, Column<int>& links) {
+        vector<uint32_t> off(labels.size() + 1, 0);
+        for (size_t v = 0; v < labels.size(); v++)
+            off[v + 1] = off[v] + labels[v].size();
+        vector<int> h(off.back()), l(off.back());
+        vector<double> d(off.back());
+        for (size_t v = 0; v < labels.size(); v++) {
+            for (size_t i = 0; i < labels[v].size(); i++) {
+                h[off[v] + i] = labels[v][i].hub;
+                d[off[v] + i] = labels[v][i].dist;
+                l[off[v] + i] = labels[v][i].link;
+            }
+        }
+        offsets = std::move(off);
+        hubs = std::move(h);
+        dists = std::move(d);
+        links = std::move(l);
+    }
+
+    void finishStats() {
+        stats.out_entries = out_hub.size();
+        stats.in_entries = in_hub.size();
+        stats.airports = order.size();
+        stats.max_label = 0;
+        for (size_t v = 0; v + 1 < out_offsets.size(); v++)
+            stats.max_label = max<size_t>(stats.max_label, max(out_offsets[v + 1] - out_offsets[v],
+                                                               in_offsets[v + 1] - in_offsets[v]));
+        stats.bytes = 0;
+        forEachColumn([&](uint32_t, const auto& col) {
+            stats.bytes += col.size() * sizeof(col[0]);
+        });
+    }
+};
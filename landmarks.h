@@ -0,0 +1,364 @@
+#pragma once
+#include <random>
+#include "graph.h"
+
+// Build statistics of a LandmarkIndex
+struct LandmarkStats {
+    double build_ms = 0;
+    size_t landmarks = 0;
+    size_t table_bytes = 0;         // both distance tables
+
+    void print(ostream& out) const {
+        out << fixed << setprecision(2)
+            << "landmarks: " << landmarks << " built in " << build_ms << " ms | tables "
+            << table_bytes / 1024.0 << " KiB\n";
+    }
+};
+
+// How LandmarkIndex::build() picks landmarks
+enum class LandmarkSelection {
+    FARTHEST,   // repeatedly the airport farthest from the landmarks chosen so far
+    AVOID,      // Goldberg & Harrelson "avoid": the leaf of the shortest-path tree region the
+                // current landmarks bound worst
+};
+
+// ALT (A*, landmarks, triangle inequality) lower bounds over a FlightGraph.
+//
+// For every landmark L the index stores d(v, L) and d(L, v) for all airports v. By the triangle
+// inequality d(u, t) >= d(u, L) - d(t, L) and d(u, t) >= d(L, t) - d(L, u); the maximum over all
+// landmarks (and the great-circle bound) guides FlightGraph::astar(). Unlike the great-circle
+// bound it also works for airports without coordinates and across long chains of short hops.
+//
+// Distances are stored as whole minutes in uint16_t, rounded down. A rounded-down value can be
+// up to a minute short, so the subtracted term gets one minute added and the bound stays a true
+// lower bound. Tables are node-major (the K values of an airport are adjacent) so a bound reads
+// two short runs. Like ContractionHierarchy, it keeps a pointer to its graph.
+class LandmarkIndex {
+public:
+    static constexpr uint16_t UNREACHABLE = 0xFFFF;
+    static constexpr uint16_t TOO_FAR = 0xFFFE;     // over 1092 hours: no information
+
+    Column<int> landmarks;
+    Column<uint16_t> to_landmark;   // [v * K + k] = d(v, landmark k) in minutes
+    Column<uint16_t> from_landmark; // [v * K + k] = d(landmark k, v) in minutes
+    LandmarkStats stats;
+
+    void build(const FlightGraph& G, int num_landmarks, LandmarkSelection selection = LandmarkSelection::AVOID) {
+        auto start = chrono::steady_clock::now();
+        graph = &G;
+        const int n = G.airports.size();
+        const int K = max(0, min(num_landmarks, n));
+        vector<int> chosen;
+        vector<vector<double>> to(K), from(K);
+        vector<double> nearest(n, numeric_limits<double>::infinity());   // min over landmarks of d(L, v) + d(v, L)
+
+        // arbitrary but deterministic first root: the airport with the most routes
+        int root = 0;
+        for (int v = 1; v < n; v++)
+            if (G.fwd_offsets[v + 1] - G.fwd_offsets[v] > G.fwd_offsets[root + 1] - G.fwd_offsets[root])
+                root = v;
+
+        auto routed = [&](int v) {
+            return G.fwd_offsets[v + 1] > G.fwd_offsets[v] || G.rev_offsets[v + 1] > G.rev_offsets[v];
+        };
+        vector<int> routed_airports;
+        for (int v = 0; v < n; v++)
+            if (routed(v))
+                routed_airports.push_back(v);
+        if (routed_airports.empty())
+            routed_airports.push_back(root);
+        mt19937 rng(1);     // avoid roots: random but repeatable
+
+        auto farthest = [&]() {
+            int best = root;
+            double best_d = -1.0;
+            for (int v = 0; v < n; v++) {
+                if (!routed(v))
+                    continue;
+                // airports no landmark reaches count as infinitely far, so every component gets one
+                const double d = std::isinf(nearest[v]) ? numeric_limits<double>::max() : nearest[v];
+                if (find(chosen.begin(), chosen.end(), v) == chosen.end() && d > best_d) {
+                    best_d = d;
+                    best = v;
+                }
+            }
+            return best;
+        };
+
+        for (int k = 0; k < K; k++) {
+            int L = -1;
+            if (selection == LandmarkSelection::AVOID)
+                L = avoidPick(G, routed_airports[rng() % routed_airports.size()], chosen, to, from);
+            if (L < 0)
+                L = k == 0 ? farthestFrom(G, root) : farthest();
+            chosen.push_back(L);
+            from[k] = distances(G, L, false);
+            to[k] = distances(G, L, true);
+            for (int v = 0; v < n; v++)
+                nearest[v] = min(nearest[v], from[k][v] + to[k][v]);
+        }
+
+        vector<uint16_t> to_table((size_t)n * K), from_table((size_t)n * K);
+        for (int v = 0; v < n; v++) {
+            for (int k = 0; k < K; k++) {
+                to_table[(size_t)v * K + k] = quantize(to[k][v]);
+                from_table[(size_t)v * K + k] = quantize(from[k][v]);
+            }
+        }
+        landmarks = std::move(chosen);
+        to_landmark = std::move(to_table);
+        from_landmark = std::move(from_table);
+        finishStats();
+        stats.build_ms = msSince(start);
+    }
+
+    int size() const {
+        return landmarks.size();
+    }
+
+    // Lower bound on the time from u to t: the best landmark bound, or the great-circle bound if
+    // that is larger. +inf if a landmark proves t unreachable from u.
+    double lowerBound(int u, int t) const {
+        double best = graph->geoLowerBound(u, t);
+        const int K = size();
+        if (K == 0 || u == t)
+            return best;
+        const uint16_t* to_u = &to_landmark[(size_t)u * K];
+        const uint16_t* to_t = &to_landmark[(size_t)t * K];
+        const uint16_t* from_u = &from_landmark[(size_t)u * K];
+        const uint16_t* from_t = &from_landmark[(size_t)t * K];
+        int minutes = 0;
+        for (int k = 0; k < K; k++) {
+            // t reaches L but u does not, or L reaches u but not t: no path u -> t
+            if ((to_u[k] == UNREACHABLE && to_t[k] != UNREACHABLE) ||
+                (from_t[k] == UNREACHABLE && from_u[k] != UNREACHABLE))
+                return numeric_limits<double>::infinity();
+            if (to_u[k] < TOO_FAR && to_t[k] < TOO_FAR)
+                minutes = max(minutes, (int)to_u[k] - (int)to_t[k] - 1);
+            if (from_t[k] < TOO_FAR && from_u[k] < TOO_FAR)
+                minutes = max(minutes, (int)from_t[k] - (int)from_u[k] - 1);
+        }
+        // shave a little off so rounding can never make the bound exceed a true distance
+        return max(best, minutes / 60.0 * (1 - 1e-9));
+    }
+
+    // Fastest route between two airport codes by A* on the landmark bound. Same result as
+    // FlightGraph::dijkstra().
+    pair<double, vector<string>> route(const string& source_code, const string& destination_code) const {
+        return route(source_code, destination_code, QueryWorkspace::forThisThread());
+    }
+
+    pair<double, vector<string>> route(const string& source_code, const string& destination_code,
+                                       QueryWorkspace& ws) const {
+        vector<string> empty_path;
+        const int source_idx = graph->findAirportIndexByCode(source_code);
+        const int dest_idx = graph->findAirportIndexByCode(destination_code);
+        if (source_idx < 0 || dest_idx < 0)
+            return {numeric_limits<double>::infinity(), empty_path};
+        const double dist = distance(source_idx, dest_idx, ws);
+        if (std::isinf(dist))
+            return {numeric_limits<double>::infinity(), empty_path};
+        return {dist, graph->buildPath(ws, dest_idx)};
+    }
+
+    double distance(int source_idx, int dest_idx, QueryWorkspace& ws) const {
+        if (std::isinf(lowerBound(source_idx, dest_idx))) {
+            ws.begin(graph->airports.size());
+            return numeric_limits<double>::infinity();
+        }
+        return graph->astar(source_idx, dest_idx, ws, [&](int u) { return lowerBound(u, dest_idx); }, "alt");
+    }
+
+    // Writes the tables to their own snapshot-format file, tagged with the graph fingerprint
+    bool save(const string& path) const {
+        SnapshotWriter writer;
+        const uint64_t fp = graph->fingerprint();
+        writer.add(SEC_GRAPH_FINGERPRINT, &fp, 1);
+        forEachColumn([&](uint32_t id, const auto& col) {
+            writer.add(id, col.data(), col.size());
+        });
+        return writer.write(path, SnapshotSourceStamp(), SnapshotSourceStamp());
+    }
+
+    // Maps saved tables; fails if they were built from a different graph. The sections are
+    // checked before any column points into the file, so a rejected file changes nothing.
+    bool open(const string& path, const FlightGraph& G, bool verify_payload = false) {
+        auto file = make_shared<MappedFile>();
+        SnapshotReader reader;
+        if (!file->open(path) || !reader.open(file->data(), file->size(), verify_payload))
+            return false;
+        size_t count = 0;
+        const uint64_t* fp = reader.get<uint64_t>(SEC_GRAPH_FINGERPRINT, count);
+        if (!fp || count != 1 || *fp != G.fingerprint())
+            return false;
+
+        bool complete = true;
+        forEachColumn([&](uint32_t id, auto& col) {
+            using T = typename remove_reference_t<decltype(col)>::value_type;
+            size_t n = 0;
+            complete = complete && reader.get<T>(id, n) != nullptr;
+        });
+        if (!complete)
+            return false;
+
+        // K landmark airports of this graph, then n * K cells per table
+        size_t k = 0, to_count = 0, from_count = 0;
+        const int* ids = reader.get<int>(SEC_ALT_LANDMARKS, k);
+        reader.get<uint16_t>(SEC_ALT_TO_LANDMARK, to_count);
+        reader.get<uint16_t>(SEC_ALT_FROM_LANDMARK, from_count);
+        const size_t cells = G.airports.size() * k;
+        if (to_count != cells || from_count != cells)
+            return false;
+        for (size_t i = 0; i < k; i++)
+            if (ids[i] < 0 || ids[i] >= (int)G.airports.size())
+                return false;
+
+        forEachColumn([&](uint32_t id, auto& col) {
+            using T = typename remove_reference_t<decltype(col)>::value_type;
+            size_t n = 0;
+            const T* p = reader.get<T>(id, n);
+            col.mapTo(p, n);
+        });
+        mapped_file = file;
+        graph = &G;
+        stats = LandmarkStats();
+        finishStats();
+        return true;
+    }
+
+private:
+    const FlightGraph* graph = nullptr;
+    shared_ptr<MappedFile> mapped_file;
+
+    template <class F>
+    void forEachColumn(F f) {
+        f(SEC_ALT_LANDMARKS, landmarks);
+        f(SEC_ALT_TO_LANDMARK, to_landmark);
+        f(SEC_ALT_FROM_LANDMARK, from_landmark);
+    }
+
+    template <class F>
+    void forEachColumn(F f) const {
+        const_cast<LandmarkIndex*>(this)->forEachColumn([&](uint32_t id, const auto& col) { f(id, col); });
+    }
+
+    void finishStats() {
+        stats.landmarks = landmarks.size();
+        stats.table_bytes = (to_landmark.size() + from_landmark.size()) * sizeof(uint16_t);
+    }
+
+    static uint16_t quantize(double hours) {
+        if (std::isinf(hours))
+            return UNREACHABLE;
+        const double minutes = floor(hours * 60.0);
+        return minutes >= TOO_FAR ? TOO_FAR : (uint16_t)minutes;
+    }
+
+    // Distances from source to every airport (backward = to source, over incoming routes)
+    static vector<double> distances(const FlightGraph& G, int source, bool backward, vector<int>* parent = nullptr) {
+        const int n = G.airports.size();
+        const Column<uint32_t>& off = backward ? G.rev_offsets : G.fwd_offsets;
+        const Column<int>& adj = backward ? G.rev_src : G.fwd_dest;
+        const Column<double>& w = backward ? G.rev_weight : G.fwd_weight;
+        vector<double> dist(n, numeric_limits<double>::infinity());
+        if (parent)
+            parent->assign(n, -1);
+        vector<pair<double, int>> heap;
+        auto later = greater<pair<double, int>>();
+        dist[source] = 0.0;
+        heap.push_back({0.0, source});
+        while (!heap.empty()) {
+            pop_heap(heap.begin(), heap.end(), later);
+            auto [d, u] = heap.back();
+            heap.pop_back();
+            if (d > dist[u])
+                continue;
+            for (uint32_t e = off[u]; e < off[u + 1]; e++) {
+                const int v = adj[e];
+                if (d + w[e] < dist[v]) {
+                    dist[v] = d + w[e];
+                    if (parent)
+                        (*parent)[v] = u;
+                    heap.push_back({dist[v], v});
+                    push_heap(heap.begin(), heap.end(), later);
+                }
+            }
+        }
+        return dist;
+    }
+
+    static int farthestFrom(const FlightGraph& G, int source) {
+        const vector<double> d = distances(G, source, false);
+        int best = source;
+        for (int v = 0; v < (int)d.size(); v++)
+            if (!std::isinf(d[v]) && d[v] > d[best])
+                best = v;
+        return best;
+    }
+
+    // "Avoid": grow the shortest-path tree from root and weigh every airport by how far the
+    // current landmarks' bound from root falls short of its true distance. Subtrees that already
+    // contain a landmark are skipped; the new landmark is the leaf reached by repeatedly stepping
+    // to the heaviest child.
+    static int avoidPick(const FlightGraph& G, int root, const vector<int>& chosen,
+                         const vector<vector<double>>& to, const vector<vector<double>>& from) {
+        const int n = G.airports.size();
+        vector<int> parent;
+        const vector<double> d = distances(G, root, false, &parent);
+
+        vector<double> size(n, 0.0);
+        vector<char> has_landmark(n, 0);
+        for (int L : chosen)
+            has_landmark[L] = 1;
+        for (int v = 0; v < n; v++) {
+            if (std::isinf(d[v]))
+                continue;
+            double bound = 0.0;
+            for (size_t k = 0; k < chosen.size(); k++) {
+                if (!std::isinf(to[k][root]) && !std::isinf(to[k][v]))
+                    bound = max(bound, to[k][root] - to[k][v]);
+                if (!std::isinf(from[k][v]) && !std::isinf(from[k][root]))
+                    bound = max(bound, from[k][v] - from[k][root]);
+            }
+            size[v] = max(0.0, d[v] - bound);
+        }
+
+        // accumulate subtree sizes bottom-up (children are farther than their parent)
+        vector<int> order;
+        for (int v = 0; v < n; v++)
+            if (!std::isinf(d[v]))
+                order.push_back(v);
+        sort(order.begin(), order.end(), [&](int a, int b) { return d[a] > d[b]; });
+        for (int v : order) {
+            const int p = parent[v];
+            if (p < 0)
+                continue;
+            if (has_landmark[v])
+                has_landmark[p] = 1;
+            else
+                size[p] += size[v];
+        }
+        for (int v : order)
+            if (has_landmark[v])
+                size[v] = 0.0;
+
+        vector<vector<int>> children(n);
+        for (int v : order)
+            if (parent[v] >= 0)
+                children[parent[v]].push_back(v);
+        int v = root;
+        while (true) {
+            int next = -1;
+            for (int c : children[v])
+                if (size[c] > 0 && (next < 0 || size[c] > size[next]))
+                    next = c;
+            if (next < 0)
+                break;
+            v = next;
+        }
+        // every subtree is covered already: the caller falls back to the farthest airport
+        if (v == root || find(chosen.begin(), chosen.end(), v) != chosen.end())
+            return -1;
+        return v;
+    }
+};
@@ -2,6 +2,7 @@
 // 10/26/2025
 
 #include "graph.h"
+#include "timetable.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -381,26 +382,197 @@ using namespace std;
 // };
 
 
-int main() {
+static string upperCode(string_view code) {
+    string out(code);
+    for (char& c : out) {
+        c = toupper(static_cast<unsigned char>(c));
+    }
+    return out;
+}
+
+// --batch mode: reads "source,destination" rows (an optional header line starting with
+// "source" is skipped) and writes one CSV row per pair to stdout, in input order. Pairs are
+// answered in blocks so results stream out while memory stays bounded.
+static int runBatch(const FlightGraph& G, const string& pairs_path, int num_threads) {
+    MappedFile file;
+    if (!file.open(pairs_path, true)) {
+        cerr << "Cannot open " << pairs_path << "\n";
+        return 1;
+    }
+
+    const size_t block_size = 1 << 16;
+    vector<pair<string, string>> block;
+    size_t total = 0;
+    double query_ms = 0;
+    auto flush = [&]() {
+        auto start = chrono::steady_clock::now();
+        vector<pair<double, vector<string>>> results = G.dijkstraBatch(block, num_threads);
+        query_ms += msSince(start);
+        string out;
+        for (size_t i = 0; i < block.size(); i++) {
+            out += block[i].first;
+            out += ',';
+            out += block[i].second;
+            out += ',';
+            const auto& [time, path] = results[i];
+            if (!path.empty() && isfinite(time)) {
+                char buf[32];
+                snprintf(buf, sizeof(buf), "%.6f", time);
+                out += buf;
+                out += ',';
+                out += to_string(path.size() - 1);
+                out += ',';
+                for (size_t k = 0; k < path.size(); k++) {
+                    if (k > 0)
+                        out += '-';
+                    out += path[k];
+                }
+            } else {
+                out += ",,";
+            }
+            out += '\n';
+        }
+        cout << out;
+        total += block.size();
+        block.clear();
+    };
+
+    cout << "source,destination,time_hours,stops,path\n";
+    vector<string_view> cols;
+    deque<string> spill;
+    string_view rest = file.view();
+    bool first_line = true;
+    while (!rest.empty()) {
+        size_t nl = rest.find('\n');
+        string_view line = rest.substr(0, nl);
+        rest = (nl == string_view::npos) ? string_view() : rest.substr(nl + 1);
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+        if (line.empty())
+            continue;
+        spill.clear();
+        parseCsvLine(line, cols, spill);
+        const bool header = first_line && !cols.empty() && upperCode(cols[0]).rfind("SOURCE", 0) == 0;
+        first_line = false;
+        if (header || cols.size() < 2)
+            continue;
+        block.emplace_back(upperCode(cols[0]), upperCode(cols[1]));
+        if (block.size() == block_size)
+            flush();
+    }
+    if (!block.empty())
+        flush();
+    cout.flush();
+
+    cerr << fixed << setprecision(2) << "Answered " << total << " pairs in " << query_ms << " ms ("
+         << (query_ms > 0 ? total / (query_ms / 1000.0) : 0.0) << " queries/s)\n";
+    return 0;
+}
+
+int main(int argc, char** argv) {
 
     string csv_path = "data/routes_with_estimated_times_plus_33k.csv";
 
-    cout << "Loading flight data from " << csv_path << "...\n";
+    // --batch pairs.csv [--threads N]: answer a file of pairs instead of one interactive query
+    // --order load|degree|bfs|rcm: renumber airports after loading (FlightGraph::reorder)
+    // --alternatives K: also list the K fastest loopless itineraries (FlightGraph::kShortestPaths)
+    // --alliance star|oneworld|skyteam, --no-codeshare, --max-stops N: also find the fastest
+    // itinerary under those constraints (FlightGraph::constrainedRoute)
+    // --pareto: also list the time vs. number of flights trade-offs (FlightGraph::paretoRoutes)
+    // --depart HH:MM [--schedule file.csv]: also plan on a daily timetable (generated unless a
+    // schedule file is given) from that time on, with the departure/arrival profile of the day
+    string batch_path;
+    int num_threads = 0;
+    int alternatives = 0;
+    FlightFilter filter;
+    int max_stops = -1;
+    bool pareto = false;
+    int depart = -1;
+    string schedule_path;
+    AirportOrder order = AirportOrder::LOAD;
+    auto usage = [&]() {
+        cerr << "Usage: " << argv[0] << " [--batch pairs.csv [--threads N]] [--order load|degree|bfs|rcm] [--alternatives K]\n"
+             << "       [--alliance star|oneworld|skyteam] [--no-codeshare] [--max-stops N] [--pareto]\n"
+             << "       [--depart HH:MM [--schedule file.csv]]\n";
+        return 1;
+    };
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--batch" && i + 1 < argc) {
+            batch_path = argv[++i];
+        } else if (arg == "--threads" && i + 1 < argc) {
+            num_threads = atoi(argv[++i]);
+        } else if (arg == "--alternatives" && i + 1 < argc) {
+            alternatives = atoi(argv[++i]);
+        } else if (arg == "--alliance" && i + 1 < argc) {
+            const string name = argv[++i];
+            if (name == "star")
+                filter.alliances = FlightFilter::STAR_ALLIANCE;
+            else if (name == "oneworld")
+                filter.alliances = FlightFilter::ONEWORLD;
+            else if (name == "skyteam")
+                filter.alliances = FlightFilter::SKYTEAM;
+            else
+                return usage();
+        } else if (arg == "--depart" && i + 1 < argc) {
+            depart = Timetable::parseClock(argv[++i]);
+            if (depart < 0)
+                return usage();
+        } else if (arg == "--schedule" && i + 1 < argc) {
+            schedule_path = argv[++i];
+        } else if (arg == "--pareto") {
+            pareto = true;
+        } else if (arg == "--no-codeshare") {
+            filter.allow_codeshare = false;
+        } else if (arg == "--max-stops" && i + 1 < argc) {
+            max_stops = atoi(argv[++i]);
+        } else if (arg == "--order" && i + 1 < argc) {
+            const string name = argv[++i];
+            if (name == "degree")
+                order = AirportOrder::DEGREE;
+            else if (name == "bfs")
+                order = AirportOrder::BFS;
+            else if (name == "rcm")
+                order = AirportOrder::RCM;
+            else if (name != "load")
+                return usage();
+        } else {
+            return usage();
+        }
+    }
+    // in batch mode stdout carries the CSV, so progress messages go to stderr
+    ostream& log = batch_path.empty() ? cout : cerr;
+
+    log << "Loading flight data from " << csv_path << "...\n";
 
     FlightGraph G;
     //read everything from the file and load to our graph G
-    if (!G.loadFromEstimatedCSV(csv_path)) {
+    //(a binary snapshot is written next to the data and reused while the CSV is unchanged)
+    if (!G.loadWithSnapshot("data/routes.snapshot", csv_path)) {
         cerr << "No edges loaded — check the CSV path/format.\n";
         return 0;
     }
 
+    G.printLoadReport(log);
+    if (order != AirportOrder::LOAD) {
+        auto start = chrono::steady_clock::now();
+        G.reorder(order);
+        log << "Reordered airports in " << msSince(start) << " ms\n";
+    }
+
     // just to check that all edges were captured
-    int total_edge_count = 0;
-    for (int i = 0; i < G.airports.size(); ++i) {
-        total_edge_count += G.airports[i].edges.size();
+    log << "Graph ready. Airports: " << G.airports.size()
+        << " | Edges: " << G.edgeCount() << " | Routes: " << G.routeCount() << "\n";
+    const int largest = G.largestScc();
+    log << "Components: " << G.sccCount() << " | Largest: "
+        << (largest < 0 ? 0 : G.sccSize(largest)) << " airports\n";
+
+    if (!batch_path.empty()) {
+        const int status = runBatch(G, batch_path, num_threads);
+        if (SEARCH_STATS_ENABLED)
+            SearchStatsRegistry::global().print(cerr);
+        return status;
     }
-    cout << "Graph ready. Airports: " << G.airports.size()
-         << " | Edges: " << total_edge_count << "\n";
 
     string source_airport;
     string dest_airport;
@@ -410,12 +582,8 @@ int main() {
     cout << "Enter destination airport code: ";
     cin >> dest_airport;
 
-    for (int i = 0; i < source_airport.length(); i++) {
-        source_airport[i] = toupper(source_airport[i]);
-    }
-    for (int i = 0; i < dest_airport.length(); i++) {
-        dest_airport[i] = toupper(dest_airport[i]);
-    }
+    source_airport = upperCode(source_airport);
+    dest_airport = upperCode(dest_airport);
 
     cout << "\nFinding fastest route from " << source_airport << " to " << dest_airport << "...\n\n";
 
@@ -480,5 +648,87 @@ int main() {
         cout << "Bellman-Ford took " << bellman_duration << " ms\n";
     }
 
+    if (filter.alliances != FlightFilter::ANY_ALLIANCE || !filter.allow_codeshare || max_stops >= 0) {
+        auto start = chrono::steady_clock::now();
+        pair<double, vector<string>> constrained =
+            G.constrainedRoute(source_airport, dest_airport, filter, max_stops >= 0 ? max_stops + 1 : 0);
+        const double constrained_ms = msSince(start);
+        cout << "\nWith constraints: ";
+        if (constrained.second.empty()) {
+            cout << "no route found";
+        } else {
+            for (size_t i = 0; i < constrained.second.size(); i++)
+                cout << (i ? " -> " : "") << constrained.second[i];
+            cout << " (" << fixed << setprecision(2) << constrained.first << " h)";
+        }
+        cout << " [" << setprecision(3) << constrained_ms << " ms]\n";
+    }
+
+    if (pareto) {
+        auto start = chrono::steady_clock::now();
+        vector<pair<double, vector<string>>> front = G.paretoRoutes(source_airport, dest_airport);
+        const double pareto_ms = msSince(start);
+        cout << "\nTime vs. flights (" << fixed << setprecision(3) << pareto_ms << " ms):\n";
+        for (const auto& [time, path] : front) {
+            cout << "  " << path.size() - 1 << " flights, " << setprecision(2) << time << " h: ";
+            for (size_t i = 0; i < path.size(); i++)
+                cout << (i ? " -> " : "") << path[i];
+            cout << "\n";
+        }
+    }
+
+    if (alternatives > 0) {
+        auto start = chrono::steady_clock::now();
+        vector<pair<double, vector<string>>> ranked = G.kShortestPaths(source_airport, dest_airport, alternatives);
+        const double ranked_ms = msSince(start);
+        cout << "\n" << ranked.size() << " fastest itineraries (" << fixed << setprecision(3) << ranked_ms << " ms):\n";
+        for (size_t k = 0; k < ranked.size(); k++) {
+            cout << setw(3) << k + 1 << ". " << setprecision(2) << ranked[k].first << " h, "
+                 << ranked[k].second.size() - 1 << " flights: ";
+            for (size_t i = 0; i < ranked[k].second.size(); i++)
+                cout << (i ? " -> " : "") << ranked[k].second[i];
+            cout << "\n";
+        }
+    }
+
+    if (depart >= 0) {
+        Timetable T;
+        if (schedule_path.empty()) {
+            T.generate(G);
+        } else if (!T.loadSchedule(G, schedule_path)) {
+            cerr << "Cannot open " << schedule_path << "\n";
+            return 1;
+        }
+        cout << "\n";
+        T.stats.print(cout);
+        auto start = chrono::steady_clock::now();
+        Journey journey = T.earliestArrival(source_airport, dest_airport, depart);
+        const double journey_ms = msSince(start);
+        cout << "Leaving after " << Timetable::clockString(depart) << ": ";
+        if (journey.legs.empty()) {
+            cout << "no connection";
+        } else {
+            cout << "arrive " << Timetable::clockString(journey.arrival);
+            for (uint32_t leg : journey.legs) {
+                const Connection& c = T.connections[leg];
+                cout << "\n  " << G.airports[c.from].code << " " << Timetable::clockString(c.departure) << " -> "
+                     << G.airports[c.to].code << " " << Timetable::clockString(c.arrival);
+            }
+        }
+        cout << "\n[" << fixed << setprecision(3) << journey_ms << " ms]\n";
+
+        start = chrono::steady_clock::now();
+        vector<pair<int, int>> departures = T.profile(source_airport, dest_airport, depart, Timetable::MINUTES_PER_DAY - 1);
+        const double profile_ms = msSince(start);
+        cout << "Departures until midnight (" << setprecision(3) << profile_ms << " ms):\n";
+        for (const auto& [leave, arrive] : departures)
+            cout << "  " << Timetable::clockString(leave) << " -> " << Timetable::clockString(arrive) << "\n";
+    }
+
+    if (SEARCH_STATS_ENABLED) {
+        cout << "\n";
+        SearchStatsRegistry::global().print(cout);
+    }
+
     return 0;
 }
@@ -0,0 +1,129 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX    // keep std::min / std::max usable in the headers that include this one
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only view of a whole file. The file is mapped (mmap on POSIX systems, CreateFileMapping /
+// MapViewOfFile on Windows), so the pages come straight from the page cache and are shared with
+// every other process mapping the same file.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept { *this = std::move(other); }
+    MappedFile& operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            close();
+            addr = other.addr;
+            ptr = other.ptr;
+            len = other.len;
+            opened = other.opened;
+            other.addr = nullptr;
+            other.ptr = nullptr;
+            other.len = 0;
+            other.opened = false;
+        }
+        return *this;
+    }
+
+    // sequential = true hints the kernel to read ahead aggressively (one-pass parsing)
+    bool open(const std::string& path, bool sequential = false) {
+        close();
+#ifdef _WIN32
+        const HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                        sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(file, &file_size) || (unsigned long long)file_size.QuadPart > SIZE_MAX) {
+            CloseHandle(file);
+            return false;
+        }
+        len = (size_t)file_size.QuadPart;
+        if (len > 0) {    // CreateFileMapping rejects empty files
+            const HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping) {
+                addr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                CloseHandle(mapping);    // the view keeps the mapping alive
+            }
+            if (!addr) {
+                len = 0;
+                CloseHandle(file);
+                return false;
+            }
+            ptr = static_cast<const char*>(addr);
+        }
+        CloseHandle(file);
+#else
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            ::close(fd);
+            return false;
+        }
+        len = (size_t)st.st_size;
+        if (len > 0) {
+            addr = mmap(nullptr, len, PROT_READ, MAP_SHARED, fd, 0);
+            if (addr == MAP_FAILED) {
+                addr = nullptr;
+                len = 0;
+                ::close(fd);
+                return false;
+            }
+            if (sequential)
+                madvise(addr, len, MADV_SEQUENTIAL);
+            ptr = static_cast<const char*>(addr);
+        }
+        ::close(fd);    // the mapping stays valid after the descriptor is closed
+#endif
+        opened = true;
+        return true;
+    }
+
+    void close() {
+        if (addr) {
+#ifdef _WIN32
+            UnmapViewOfFile(addr);
+#else
+            munmap(addr, len);
+#endif
+        }
+        addr = nullptr;
+        ptr = nullptr;
+        len = 0;
+        opened = false;
+    }
+
+    bool isOpen() const { return opened; }
+    const char* data() const { return ptr; }
+    size_t size() const { return len; }
+    std::string_view view() const { return {ptr, len}; }
+
+private:
+    void* addr = nullptr;
+    const char* ptr = nullptr;
+    size_t len = 0;
+    bool opened = false;
+};
@@ -0,0 +1,266 @@
+#pragma once
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include <cstdint>
+#include <cstring>
+#include <bit>
+#include <cassert>
+#include <cmath>
+
+// Priority-queue policies for FlightGraph::dijkstra<Queue>(). Each policy offers
+//
+//   void reset(size_t num_nodes);          start of a query
+//   void push(int node, double key);       insert, or lower the key of a queued node
+//   bool empty() const;
+//   pair<double, int> pop();               smallest (key, node)
+//
+// Lazy policies (binary, radix) keep stale entries after a decrease and may pop a node more
+// than once; the search skips nodes it has already settled. Keys are non-negative distances.
+//
+// Policies keep no operation counts of their own: the search counts its pushes, pops and stale
+// pops into SearchCounters (search_stats.h), compiled in only with AIRGORITHM_SEARCH_STATS. On
+// the indexed heap a push of a queued node is a decrease-key.
+
+// The std::push_heap / pop_heap binary heap with lazy deletion (ties broken by node index).
+// Works on a caller-provided vector so the existing QueryWorkspace::heap storage is reused.
+class BinaryHeapQueue {
+public:
+    explicit BinaryHeapQueue(std::vector<std::pair<double, int>>& storage) : heap(storage) {}
+
+    void reset(size_t) { heap.clear(); }
+    bool empty() const { return heap.empty(); }
+
+    void push(int node, double key) {
+        heap.push_back({key, node});
+        std::push_heap(heap.begin(), heap.end(), later);
+    }
+
+    std::pair<double, int> pop() {
+        std::pop_heap(heap.begin(), heap.end(), later);
+        auto top = heap.back();
+        heap.pop_back();
+        return top;
+    }
+
+private:
+    std::vector<std::pair<double, int>>& heap;
+    std::greater<std::pair<double, int>> later;
+};
+
+// Indexed 4-ary heap with decrease-key: every node is in the heap at most once, so there are no
+// stale pops. Ordered by (key, node) like the binary heap, so searches settle nodes in the same
+// order. pos[] is sized once; only nodes still queued are cleaned up between queries.
+class QuaternaryHeapQueue {
+public:
+    void reset(size_t num_nodes) {
+        for (const Item& it : items)
+            pos[it.node] = -1;
+        items.clear();
+        if (pos.size() < num_nodes)
+            pos.resize(num_nodes, -1);
+    }
+
+    bool empty() const { return items.empty(); }
+
+    void push(int node, double key) {
+        int i = pos[node];
+        if (i < 0) {
+            i = (int)items.size();
+            items.push_back({key, node});
+        } else {
+            items[i].key = key;
+        }
+        siftUp(i);
+    }
+
+    std::pair<double, int> pop() {
+        const Item top = items[0];
+        pos[top.node] = -1;
+        const Item last = items.back();
+        items.pop_back();
+        if (!items.empty()) {
+            items[0] = last;
+            pos[last.node] = 0;
+            siftDown(0);
+        }
+        return {top.key, top.node};
+    }
+
+private:
+    struct Item {
+        double key;
+        int node;
+    };
+    std::vector<Item> items;
+    std::vector<int> pos;           // index in items, -1 if not queued
+
+    static bool before(const Item& a, const Item& b) {
+        return a.key < b.key || (a.key == b.key && a.node < b.node);
+    }
+
+    void siftUp(int i) {
+        const Item it = items[i];
+        while (i > 0) {
+            const int parent = (i - 1) / 4;
+            if (!before(it, items[parent]))
+                break;
+            items[i] = items[parent];
+            pos[items[i].node] = i;
+            i = parent;
+        }
+        items[i] = it;
+        pos[it.node] = i;
+    }
+
+    void siftDown(int i) {
+        const Item it = items[i];
+        const int n = (int)items.size();
+        while (true) {
+            const int first = 4 * i + 1;
+            if (first >= n)
+                break;
+            int best = first;
+            for (int c = first + 1; c < std::min(first + 4, n); c++)
+                if (before(items[c], items[best]))
+                    best = c;
+            if (!before(items[best], it))
+                break;
+            items[i] = items[best];
+            pos[items[i].node] = i;
+            i = best;
+        }
+        items[i] = it;
+        pos[it.node] = i;
+    }
+};
+
+// Radix heap for monotone keys (every push is >= the last popped key, as in Dijkstra with
+// non-negative weights). Keys are bucketed by the highest bit in which they differ from the last
+// popped key, so each entry moves down at most 64 times. Non-negative doubles compare like their
+// IEEE-754 bit patterns, so the keys are the exact distances, not rounded minutes. Ties pop in
+// no particular order. Unlike BucketQueue it needs no bounds on the edge weights.
+class RadixHeapQueue {
+public:
+    void reset(size_t) {
+        for (auto& b : buckets)
+            b.clear();
+        last = 0;
+        size = 0;
+    }
+
+    bool empty() const { return size == 0; }
+
+    void push(int node, double key) {
+        const uint64_t bits = keyBits(key);
+        buckets[bucketOf(bits)].push_back({bits, node});
+        size++;
+    }
+
+    std::pair<double, int> pop() {
+        if (buckets[0].empty()) {
+            int i = 1;
+            while (buckets[i].empty())
+                i++;
+            // the smallest key in bucket i becomes `last`; everything in i moves to lower buckets
+            uint64_t smallest = buckets[i][0].bits;
+            for (const Entry& e : buckets[i])
+                smallest = std::min(smallest, e.bits);
+            last = smallest;
+            for (const Entry& e : buckets[i])
+                buckets[bucketOf(e.bits)].push_back(e);
+            buckets[i].clear();
+        }
+        const Entry e = buckets[0].back();
+        buckets[0].pop_back();
+        size--;
+        double key;
+        std::memcpy(&key, &e.bits, sizeof(key));
+        return {key, e.node};
+    }
+
+private:
+    struct Entry {
+        uint64_t bits;
+        int node;
+    };
+    std::vector<Entry> buckets[65];
+    uint64_t last = 0;
+    size_t size = 0;
+
+    static uint64_t keyBits(double key) {
+        uint64_t bits;
+        std::memcpy(&bits, &key, sizeof(bits));
+        return bits;
+    }
+
+    int bucketOf(uint64_t bits) const {
+        return bits == last ? 0 : 64 - std::countl_zero(bits ^ last);
+    }
+};
+
+// Bucket queue (Dial) over fixed-width key ranges, e.g. minutes. Buckets form a ring covering one
+// edge past the last popped key, which is all a Dijkstra queue can hold; a key further out grows
+// the ring. Within a bucket entries pop in no particular order, so the search is exact only if
+// width is at most the shortest edge weight (Dinitz): a node in the lowest bucket cannot be
+// improved by another node of that bucket. FlightGraph::flightTimeRange() gives both bounds; the
+// shortest flight is no valid width when it is 0 (zero-hour flights) or +inf (no flights).
+class BucketQueue {
+public:
+    BucketQueue(double width, double longest_edge) : width(width) {
+        assert(validWidth(width));
+        // an unknown span (+inf, NaN) starts with the smallest ring and a huge one is capped
+        // before the size_t cast; either way push() grows the ring as needed
+        const double span = longest_edge >= 0 && std::isfinite(longest_edge) ? longest_edge / width : 0;
+        ring.resize(std::max<size_t>(2, (size_t)std::min(span, 1e6) + 2));
+    }
+
+    static bool validWidth(double width) { return width > 0 && std::isfinite(width); }
+
+    void reset(size_t) {
+        for (auto& b : ring)
+            b.clear();
+        current = 0;
+        size = 0;
+    }
+
+    bool empty() const { return size == 0; }
+
+    void push(int node, double key) {
+        const size_t b = (size_t)(key / width);
+        if (b >= current + ring.size())
+            grow(b);
+        ring[b % ring.size()].push_back({key, node});
+        size++;
+    }
+
+    std::pair<double, int> pop() {
+        while (ring[current % ring.size()].empty())
+            current++;
+        auto& bucket = ring[current % ring.size()];
+        const Entry e = bucket.back();
+        bucket.pop_back();
+        size--;
+        return {e.key, e.node};
+    }
+
+private:
+    struct Entry {
+        double key;
+        int node;
+    };
+    double width;
+    std::vector<std::vector<Entry>> ring;
+    size_t current = 0;             // lowest bucket that may hold entries
+    size_t size = 0;
+
+    // Re-buckets everything into a ring that reaches bucket b
+    void grow(size_t b) {
+        std::vector<std::vector<Entry>> old(std::max(2 * ring.size(), b - current + 1));
+        old.swap(ring);
+        for (auto& bucket : old)
+            for (const Entry& e : bucket)
+                ring[(size_t)(e.key / width) % ring.size()].push_back(e);
+    }
+};
@@ -0,0 +1,163 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+// Search effort counters, for telling why a query was slow and whether a speed-up technique
+// (A*, CH, ...) really searches less.
+//
+// Counting is compiled in only with AIRGORITHM_SEARCH_STATS=1 (CMake option of the same name).
+// Otherwise searchCount() and SearchRecord compile to nothing, the hot loops are unchanged and
+// all counters read zero.
+//
+// A search counts into the SearchCounters of the QueryWorkspace it runs on (the first of the two
+// for bidirectional searches), which QueryWorkspace::begin() clears, so after a query its
+// counters sit next to its distances and parents. When the query returns it also adds them to
+// SearchStatsRegistry::global() under the engine's name.
+#ifndef AIRGORITHM_SEARCH_STATS
+#define AIRGORITHM_SEARCH_STATS 0
+#endif
+
+inline constexpr bool SEARCH_STATS_ENABLED = AIRGORITHM_SEARCH_STATS != 0;
+
+struct SearchCounters {
+    uint64_t settled = 0;       // nodes expanded (taken off the queue, or scanned in a round)
+    uint64_t relaxed = 0;       // edges examined: routes, CH arcs, timetable connections
+    uint64_t improved = 0;      // relaxations that lowered a tentative distance
+    uint64_t pushes = 0;        // queue insertions
+    uint64_t pops = 0;          // queue removals, stale ones included
+    uint64_t stale = 0;         // pops of nodes that were already settled
+    uint64_t passes = 0;        // rounds of Bellman-Ford and the round-based searches
+
+    void clear() { *this = SearchCounters(); }
+
+    SearchCounters& operator+=(const SearchCounters& o) {
+        settled += o.settled;
+        relaxed += o.relaxed;
+        improved += o.improved;
+        pushes += o.pushes;
+        pops += o.pops;
+        stale += o.stale;
+        passes += o.passes;
+        return *this;
+    }
+
+    // Per counter, the larger of the two
+    void keepMax(const SearchCounters& o) {
+        settled = std::max(settled, o.settled);
+        relaxed = std::max(relaxed, o.relaxed);
+        improved = std::max(improved, o.improved);
+        pushes = std::max(pushes, o.pushes);
+        pops = std::max(pops, o.pops);
+        stale = std::max(stale, o.stale);
+        passes = std::max(passes, o.passes);
+    }
+
+    // Calls f(name, value) for every counter, in declaration order
+    template <class F>
+    void forEach(F f) const {
+        f("settled", settled);
+        f("relaxed", relaxed);
+        f("improved", improved);
+        f("pushes", pushes);
+        f("pops", pops);
+        f("stale", stale);
+        f("passes", passes);
+    }
+};
+
+// Adds n to a counter when counting is compiled in
+inline void searchCount(uint64_t& counter, uint64_t n = 1) {
+    if constexpr (SEARCH_STATS_ENABLED)
+        counter += n;
+}
+
+// Counters of every recorded query, summed per engine. Thread-safe; one lock per recorded query,
+// nothing per edge.
+class SearchStatsRegistry {
+public:
+    struct Totals {
+        uint64_t queries = 0;
+        SearchCounters sum;
+        SearchCounters max;     // per counter, the largest single query
+    };
+
+    // Called with every recorded query (engine, counters), one call at a time
+    using Trace = std::function<void(const char*, const SearchCounters&)>;
+
+    static SearchStatsRegistry& global() {
+        static SearchStatsRegistry registry;
+        return registry;
+    }
+
+    void record(const char* engine, const SearchCounters& c) {
+        std::lock_guard<std::mutex> hold(lock);
+        Totals& t = totals[engine];
+        t.queries++;
+        t.sum += c;
+        t.max.keepMax(c);
+        if (trace)
+            trace(engine, c);
+    }
+
+    std::map<std::string, Totals> snapshot() const {
+        std::lock_guard<std::mutex> hold(lock);
+        return totals;
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> hold(lock);
+        totals.clear();
+    }
+
+    void setTrace(Trace t) {
+        std::lock_guard<std::mutex> hold(lock);
+        trace = std::move(t);
+    }
+
+    // One line per engine: queries, then the mean (and max) of every counter per query
+    void print(std::ostream& out) const {
+        if (!SEARCH_STATS_ENABLED) {
+            out << "search stats: not compiled in (build with AIRGORITHM_SEARCH_STATS=1)\n";
+            return;
+        }
+        for (const auto& [engine, t] : snapshot()) {
+            out << "search stats " << engine << ": " << t.queries << " queries |";
+            std::map<std::string, uint64_t> max;
+            t.max.forEach([&](const char* name, uint64_t v) { max[name] = v; });
+            t.sum.forEach([&](const char* name, uint64_t v) {
+                if (max[name] > 0)
+                    out << " " << name << " " << std::fixed << std::setprecision(1)
+                        << (t.queries ? (double)v / t.queries : 0.0) << " (max " << max[name] << ")";
+            });
+            out << "\n";
+        }
+    }
+
+private:
+    mutable std::mutex lock;
+    std::map<std::string, Totals> totals;
+    Trace trace;
+};
+
+// Adds a query's counters to the global registry when it goes out of scope, so every return
+// path of a search is recorded. Declare it right after QueryWorkspace::begin().
+class SearchRecord {
+public:
+    SearchRecord(const char* engine, const SearchCounters& counters) : engine(engine), counters(counters) {}
+    ~SearchRecord() {
+        if constexpr (SEARCH_STATS_ENABLED)
+            SearchStatsRegistry::global().record(engine, counters);
+    }
+    SearchRecord(const SearchRecord&) = delete;
+    SearchRecord& operator=(const SearchRecord&) = delete;
+
+private:
+    const char* engine;
+    const SearchCounters& counters;
+};
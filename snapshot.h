@@ -0,0 +1,339 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <span>
+#include <deque>
+#include <fstream>
+#include <filesystem>
+#include <system_error>
+
+// Binary graph snapshot format.
+//
+//   [SnapshotHeader][SnapshotSection x section_count][payload sections, each 64-byte aligned]
+//
+// Every array section is the raw in-memory image of one graph column, so a mapped snapshot is
+// queried in place. header_checksum covers the header and section table and is always checked;
+// payload_checksum covers everything after the table and is checked on request.
+
+static const char SNAPSHOT_MAGIC[8] = {'A', 'I', 'R', 'G', 'S', 'N', 'A', 'P'};
+static const uint32_t SNAPSHOT_VERSION = 7;
+static const uint32_t SNAPSHOT_ENDIAN = 0x01020304;
+static const uint64_t SNAPSHOT_ALIGN = 64;
+
+// Section ids. New columns get new ids; readers skip ids they do not know.
+enum SnapshotSectionId : uint32_t {
+    SEC_AIRPORTS = 1,
+    SEC_AIRLINE_NAMES,
+    SEC_EQUIPMENT_NAMES,
+    SEC_FWD_OFFSETS,
+    SEC_FWD_DEST,
+    SEC_FWD_WEIGHT,
+    SEC_EDGE_AIRLINE,
+    SEC_EDGE_AIRLINE_ID,
+    SEC_EDGE_EQUIPMENT,
+    SEC_EDGE_STOPS,
+    SEC_EDGE_CODESHARE,
+    SEC_AIRPORT_GEO,
+    SEC_GEO_BOUND,
+    SEC_REV_OFFSETS,
+    SEC_REV_SRC,
+    SEC_REV_WEIGHT,
+    SEC_REV_EDGE,
+    SEC_FWD_EDGE_OFFSETS,
+    SEC_FWD_EDGE_IDS,
+    SEC_DIRECT_KEYS,
+    SEC_DIRECT_ROUTES,
+    SEC_EDGE_OFFSETS,
+    SEC_EDGE_DEST,
+    SEC_EDGE_WEIGHT,
+    SEC_CODE_KEYS,
+    SEC_CODE_VALUES,
+    SEC_SCC_ID,
+    SEC_SCC_SIZE,
+    SEC_SCC_DAG_ROW,
+    SEC_SCC_REACH,
+    SEC_EDGE_FLAGS,
+    SEC_FWD_BEST_FLIGHT,
+    SEC_AIRPORT_CODES,      // full codes; SnapshotAirport::code holds at most 7 characters
+
+    // contraction hierarchy files (contraction_hierarchy.h)
+    SEC_GRAPH_FINGERPRINT = 100,
+    SEC_CH_RANK,
+    SEC_CH_UP_OFFSETS,
+    SEC_CH_UP_HEAD,
+    SEC_CH_UP_WEIGHT,
+    SEC_CH_UP_MIDDLE,
+    SEC_CH_DOWN_OFFSETS,
+    SEC_CH_DOWN_TAIL,
+    SEC_CH_DOWN_WEIGHT,
+    SEC_CH_DOWN_MIDDLE,
+
+    // landmark (ALT) files (landmarks.h); also tagged with SEC_GRAPH_FINGERPRINT
+    SEC_ALT_LANDMARKS = 200,
+    SEC_ALT_TO_LANDMARK,
+    SEC_ALT_FROM_LANDMARK,
+
+    // hub label files (hub_labels.h); also tagged with SEC_GRAPH_FINGERPRINT
+    SEC_HL_ORDER = 300,
+    SEC_HL_OUT_OFFSETS,
+    SEC_HL_OUT_HUB,
+    SEC_HL_OUT_DIST,
+    SEC_HL_OUT_NEXT,
+    SEC_HL_IN_OFFSETS,
+    SEC_HL_IN_HUB,
+    SEC_HL_IN_DIST,
+    SEC_HL_IN_PREV,
+};
+
+// Size and modification time of a source file, used to detect a stale snapshot
+struct SnapshotSourceStamp {
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    uint32_t present = 0;
+    uint32_t reserved = 0;
+
+    static SnapshotSourceStamp of(const std::string& path) {
+        SnapshotSourceStamp st;
+        if (path.empty())
+            return st;
+        std::error_code ec;
+        const auto size = std::filesystem::file_size(path, ec);
+        if (ec)
+            return st;
+        const auto mtime = std::filesystem::last_write_time(path, ec);
+        if (ec)
+            return st;
+        st.size = size;
+        st.mtime = (int64_t)mtime.time_since_epoch().count();
+        st.present = 1;
+        return st;
+    }
+
+    bool operator==(const SnapshotSourceStamp& o) const {
+        return size == o.size && mtime == o.mtime && present == o.present;
+    }
+};
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t endian;
+    uint64_t file_size;
+    uint32_t section_count;
+    uint32_t reserved;
+    SnapshotSourceStamp routes_source;
+    SnapshotSourceStamp airports_source;
+    uint64_t payload_checksum;
+    uint64_t header_checksum;       // computed with this field set to 0
+};
+
+struct SnapshotSection {
+    uint32_t id;
+    uint32_t elem_size;
+    uint64_t offset;                // from the start of the file
+    uint64_t count;                 // number of elements
+};
+
+static const uint32_t SNAPSHOT_AIRPORT_HAS_COORDS = 1;
+
+// Fixed-size airport record; code is NUL-padded and cut to 7 characters (the full codes are in
+// SEC_AIRPORT_CODES)
+struct SnapshotAirport {
+    char code[8];
+    int32_t openflights_id;
+    uint32_t flags;
+    double latitude;
+    double longitude;
+};
+
+// 64-bit FNV-1a style hash over 8-byte words (tail bytes one at a time). Cheap enough to run
+// over the whole payload; it is an integrity check, not a cryptographic one.
+static inline uint64_t snapshotChecksum(const char* data, size_t n, uint64_t h = 1469598103934665603ULL) {
+    const uint64_t prime = 1099511628211ULL;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t w;
+        memcpy(&w, data + i, 8);
+        h = (h ^ w) * prime;
+        h ^= h >> 29;
+    }
+    for (; i < n; ++i)
+        h = (h ^ (unsigned char)data[i]) * prime;
+    return h;
+}
+
+// Collects sections in memory, then writes header + table + payload to disk in one go.
+class SnapshotWriter {
+public:
+    template <class T>
+    void add(uint32_t id, const T* data, size_t count) {
+        sections.push_back({id, (uint32_t)sizeof(T), 0, (uint64_t)count});
+        blobs.emplace_back(reinterpret_cast<const char*>(data), count * sizeof(T));
+    }
+
+    // Strings are stored back to back, each followed by a NUL
+    void addStrings(uint32_t id, const std::vector<std::string>& strings) {
+        std::string blob;
+        for (const auto& s : strings) {
+            blob += s;
+            blob.push_back('\0');
+        }
+        owned.push_back(std::move(blob));
+        sections.push_back({id, 1, 0, (uint64_t)owned.back().size()});
+        blobs.emplace_back(owned.back());
+    }
+
+    // Writes to path + ".tmp" and renames it into place, so readers never map a partial file
+    bool write(const std::string& path, const SnapshotSourceStamp& routes, const SnapshotSourceStamp& airports) {
+        SnapshotHeader header{};
+        memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+        header.version = SNAPSHOT_VERSION;
+        header.endian = SNAPSHOT_ENDIAN;
+        header.section_count = (uint32_t)sections.size();
+        header.routes_source = routes;
+        header.airports_source = airports;
+
+        uint64_t offset = alignUp(sizeof(SnapshotHeader) + sections.size() * sizeof(SnapshotSection));
+        const uint64_t payload_start = offset;
+        for (size_t i = 0; i < sections.size(); i++) {
+            sections[i].offset = offset;
+            offset = alignUp(offset + blobs[i].size());
+        }
+        header.file_size = offset;
+
+        std::string payload(offset - payload_start, '\0');
+        for (size_t i = 0; i < sections.size(); i++)
+            if (!blobs[i].empty())
+                memcpy(&payload[sections[i].offset - payload_start], blobs[i].data(), blobs[i].size());
+        header.payload_checksum = snapshotChecksum(payload.data(), payload.size());
+
+        std::string head(payload_start, '\0');
+        memcpy(&head[0], &header, sizeof(header));
+        if (!sections.empty())
+            memcpy(&head[sizeof(header)], sections.data(), sections.size() * sizeof(SnapshotSection));
+        header.header_checksum = snapshotChecksum(head.data(), head.size());
+        memcpy(&head[0], &header, sizeof(header));
+
+        const std::string tmp = path + ".tmp";
+        {
+            std::ofstream fout(tmp, std::ios::binary | std::ios::trunc);
+            if (!fout)
+                return false;
+            fout.write(head.data(), head.size());
+            fout.write(payload.data(), payload.size());
+            if (!fout)
+                return false;
+        }
+        std::error_code ec;
+        std::filesystem::rename(tmp, path, ec);
+        return !ec;
+    }
+
+private:
+    std::vector<SnapshotSection> sections;
+    std::vector<std::string_view> blobs;
+    std::deque<std::string> owned;     // deque: views into earlier blobs stay valid
+
+    static uint64_t alignUp(uint64_t x) {
+        return (x + SNAPSHOT_ALIGN - 1) / SNAPSHOT_ALIGN * SNAPSHOT_ALIGN;
+    }
+};
+
+// Validates a mapped snapshot and hands out typed pointers to its sections.
+class SnapshotReader {
+public:
+    const SnapshotHeader* header = nullptr;
+
+    // Checks magic, version, byte order, size and the header checksum. verify_payload also
+    // hashes every payload byte, which touches (faults in) the whole file.
+    bool open(const char* data, size_t size, bool verify_payload) {
+        base = data;
+        if (size < sizeof(SnapshotHeader))
+            return false;
+        header = reinterpret_cast<const SnapshotHeader*>(data);
+        if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 ||
+            header->version != SNAPSHOT_VERSION || header->endian != SNAPSHOT_ENDIAN ||
+            header->file_size != size)
+            return false;
+
+        const uint64_t table_end = sizeof(SnapshotHeader) + (uint64_t)header->section_count * sizeof(SnapshotSection);
+        if (table_end > size)
+            return false;
+        table = reinterpret_cast<const SnapshotSection*>(data + sizeof(SnapshotHeader));
+
+        uint64_t payload_start = size;
+        for (uint32_t i = 0; i < header->section_count; i++) {
+            const SnapshotSection& s = table[i];
+            // count <= room / elem_size rather than count * elem_size <= room, which can wrap
+            if (s.offset < table_end || s.offset > size || s.offset % SNAPSHOT_ALIGN != 0 ||
+                (s.elem_size != 0 && s.count > (size - s.offset) / s.elem_size))
+                return false;
+            payload_start = std::min<uint64_t>(payload_start, s.offset);
+        }
+        if (header->section_count == 0)
+            payload_start = size;
+
+        std::string head(data, payload_start);
+        SnapshotHeader* h = reinterpret_cast<SnapshotHeader*>(&head[0]);
+        h->header_checksum = 0;
+        if (snapshotChecksum(head.data(), head.size()) != header->header_checksum)
+            return false;
+
+        if (verify_payload &&
+            snapshotChecksum(data + payload_start, size - payload_start) != header->payload_checksum)
+            return false;
+        return true;
+    }
+
+    // Returns the section as an array of T, or nullptr if it is missing or has the wrong type
+    template <class T>
+    const T* get(uint32_t id, size_t& count) const {
+        const SnapshotSection* s = find(id);
+        if (!s || s->elem_size != sizeof(T)) {
+            count = 0;
+            return nullptr;
+        }
+        count = s->count;
+        return reinterpret_cast<const T*>(base + s->offset);
+    }
+
+    // The section as a span of T, empty if it is missing or has the wrong type
+    template <class T>
+    std::span<const T> array(uint32_t id) const {
+        size_t count = 0;
+        const T* p = get<T>(id, count);
+        return {p, count};
+    }
+
+    bool has(uint32_t id) const {
+        return find(id) != nullptr;
+    }
+
+    std::vector<std::string> getStrings(uint32_t id) const {
+        std::vector<std::string> out;
+        size_t n = 0;
+        const char* p = get<char>(id, n);
+        size_t start = 0;
+        for (size_t i = 0; i < n; i++) {
+            if (p[i] == '\0') {
+                out.emplace_back(p + start, i - start);
+                start = i + 1;
+            }
+        }
+        return out;
+    }
+
+private:
+    const char* base = nullptr;
+    const SnapshotSection* table = nullptr;
+
+    const SnapshotSection* find(uint32_t id) const {
+        for (uint32_t i = 0; header && i < header->section_count; i++)
+            if (table[i].id == id)
+                return &table[i];
+        return nullptr;
+    }
+};
@@ -0,0 +1,420 @@
+#pragma once
+#include <list>
+#include <mutex>
+#include <shared_mutex>
+#include "graph.h"
+
+// Counters of an SptCache, read with SptCache::stats()
+struct SptCacheStats {
+    uint64_t hits = 0;              // destination already settled in the cached search
+    uint64_t resumes = 0;           // cached source, search resumed until the destination settled
+    uint64_t misses = 0;            // no cached search for the source: a new one was started
+    uint64_t evictions = 0;
+    uint64_t repairs = 0;           // cached searches patched by repair()
+    uint64_t restarts = 0;          // ... and ones repair() restarted because most of them changed
+    size_t entries = 0;
+    size_t bytes = 0;
+    size_t budget_bytes = 0;
+
+    uint64_t lookups() const {
+        return hits + resumes + misses;
+    }
+
+    // Share of lookups answered without any search / without starting a new one
+    double hitRate() const {
+        return lookups() ? (double)hits / lookups() : 0.0;
+    }
+
+    double reuseRate() const {
+        return lookups() ? (double)(hits + resumes) / lookups() : 0.0;
+    }
+
+    void print(ostream& out) const {
+        out << fixed << setprecision(2)
+            << "spt cache: " << lookups() << " lookups | hits " << hits << " resumes " << resumes
+            << " misses " << misses << " (hit rate " << 100.0 * hitRate() << "%, reuse "
+            << 100.0 * reuseRate() << "%) | " << entries << " entries, " << bytes / 1048576.0 << " of "
+            << budget_bytes / 1048576.0 << " MiB | evictions " << evictions << " | repairs " << repairs
+            << " restarts " << restarts << "\n";
+    }
+};
+
+// LRU cache of suspended single-source searches over a FlightGraph, for skewed traffic where a
+// few origins ask for most routes.
+//
+// An entry is one Dijkstra search from a source, stopped as soon as the destination it was last
+// asked for settled: the distances, parents and settled flags of every airport plus the heap. A
+// query whose destination is already settled is a lookup; otherwise the search resumes where it
+// stopped until the new destination settles (or the heap runs dry). Searches pop in the same
+// (distance, airport) order as FlightGraph::dijkstra(), so answers, paths included, are
+// identical to it.
+//
+// After FlightGraph::applyUpdates(), repair() patches the cached searches for the changed
+// routes instead of dropping them. Distances stay exact; among equally fast paths a repaired
+// search may keep a different one than a fresh dijkstra() would pick.
+//
+// Entries are dense arrays (13 bytes per airport plus the heap) and the least recently used ones
+// are dropped once the total passes budget_bytes; the entry in use is never dropped. All query
+// methods may be called from many threads: the LRU list has one mutex, each entry a reader/writer
+// lock, so threads asking about settled airports of the same source do not wait for each other.
+// The graph must outlive the cache and change only through applyUpdates() + repair().
+class SptCache {
+public:
+    explicit SptCache(const FlightGraph& G, size_t budget_bytes = 64u << 20) : graph(&G), budget(budget_bytes) {}
+
+    double distance(int source_idx, int dest_idx) {
+        return query(source_idx, dest_idx, [&](const Entry& e) { return e.dist[dest_idx]; },
+                     numeric_limits<double>::infinity());
+    }
+
+    // Airports from source to destination (empty if unreachable)
+    vector<int> path(int source_idx, int dest_idx) {
+        return query(source_idx, dest_idx, [&](const Entry& e) { return e.pathTo(dest_idx); }, vector<int>());
+    }
+
+    pair<double, vector<string>> route(const string& source_code, const string& destination_code) {
+        vector<string> empty_path;
+        const int s = graph->findAirportIndexByCode(source_code);
+        const int t = graph->findAirportIndexByCode(destination_code);
+        if (s < 0 || t < 0)
+            return {numeric_limits<double>::infinity(), empty_path};
+        using Result = pair<double, vector<int>>;
+        const Result r = query(s, t, [&](const Entry& e) { return Result(e.dist[t], e.pathTo(t)); },
+                               Result(numeric_limits<double>::infinity(), {}));
+        if (std::isinf(r.first))
+            return {numeric_limits<double>::infinity(), empty_path};
+        vector<string> codes;
+        for (int v : r.second)
+            codes.push_back(graph->airports[v].code);
+        return {r.first, codes};
+    }
+
+    SptCacheStats stats() const {
+        SptCacheStats out;
+        out.hits = hits.load(memory_order_relaxed);
+        out.resumes = resumes.load(memory_order_relaxed);
+        out.misses = misses.load(memory_order_relaxed);
+        out.evictions = evictions.load(memory_order_relaxed);
+        out.repairs = repairs.load(memory_order_relaxed);
+        out.restarts = restarts.load(memory_order_relaxed);
+        lock_guard<mutex> guard(lru_mutex);
+        out.entries = slots.size();
+        out.bytes = total_bytes;
+        out.budget_bytes = budget;
+        return out;
+    }
+
+    // Drops every entry (entries still in use by a query are freed when it finishes)
+    void clear() {
+        lock_guard<mutex> guard(lru_mutex);
+        slots.clear();
+        lru.clear();
+        total_bytes = 0;
+    }
+
+    // Updates every cached search for routes changed by FlightGraph::applyUpdates(). Call it after
+    // the update and before the next query. Per search (the settled radius is the largest
+    // distance settled so far; everything within it must be exact):
+    //  - a route that got slower or vanished while it was a tree edge invalidates the subtree
+    //    below it; those airports are unsettled and re-seeded from their in-neighbours (the rest
+    //    of the tree did not use the route, so it is still an upper bound);
+    //  - a route that got faster or appeared improves its head if its tail is within the radius;
+    //  - the improved and re-seeded airports then run a local Dijkstra that relaxes routes out
+    //    of every airport within the radius, so distances there are exact again. Airports it
+    //    leaves unsettled go back on the search heap.
+    // Work is proportional to the airports whose distance changes, plus one pass over the
+    // parents when a tree edge got slower. A search where that would reach half the airports is
+    // restarted instead: searching again is cheaper than patching most of it.
+    void repair(span<const RouteChange> changes) {
+        if (changes.empty())
+            return;
+        vector<shared_ptr<Entry>> entries;
+        {
+            lock_guard<mutex> guard(lru_mutex);
+            for (const auto& [source, slot] : slots)
+                entries.push_back(slot.entry);
+        }
+        for (const auto& e : entries) {
+            size_t bytes;
+            {
+                unique_lock<shared_mutex> writer(e->lock);
+                (repairEntry(*e, changes) ? repairs : restarts).fetch_add(1, memory_order_relaxed);
+                bytes = e->bytes();
+            }
+            account(e->source, e, bytes);
+        }
+    }
+
+    void setBudget(size_t budget_bytes) {
+        lock_guard<mutex> guard(lru_mutex);
+        budget = budget_bytes;
+        evictOverBudget(-1);
+    }
+
+private:
+    struct Entry {
+        int source;
+        vector<double> dist;
+        vector<int> parent;
+        vector<uint8_t> settled;
+        vector<pair<double, int>> heap;     // suspended (distance, airport) min-heap
+        double radius = 0.0;                // largest settled distance so far
+        shared_mutex lock;
+
+        Entry(int s, size_t num_airports) : source(s) {
+            restart(num_airports);
+        }
+
+        // Back to a search that has settled nothing yet
+        void restart(size_t num_airports) {
+            dist.assign(num_airports, numeric_limits<double>::infinity());
+            parent.assign(num_airports, -1);
+            settled.assign(num_airports, 0);
+            dist[source] = 0.0;
+            heap.assign(1, {0.0, source});
+            radius = 0.0;
+        }
+
+        size_t bytes() const {
+            return sizeof(Entry) + dist.capacity() * sizeof(double) + parent.capacity() * sizeof(int) +
+                   settled.capacity() + heap.capacity() * sizeof(pair<double, int>);
+        }
+
+        vector<int> pathTo(int t) const {
+            vector<int> nodes;
+            if (std::isinf(dist[t]))
+                return nodes;
+            for (int v = t; v != -1; v = parent[v])
+                nodes.push_back(v);
+            reverse(nodes.begin(), nodes.end());
+            return nodes;
+        }
+    };
+
+    struct Slot {
+        shared_ptr<Entry> entry;
+        list<int>::iterator position;   // in lru
+        size_t bytes = 0;               // as last accounted
+    };
+
+    const FlightGraph* graph;
+    size_t budget;
+
+    mutable mutex lru_mutex;            // guards slots, lru, total_bytes, budget
+    unordered_map<int, Slot> slots;     // by source airport
+    list<int> lru;                      // most recently used first
+    size_t total_bytes = 0;
+
+    atomic<uint64_t> hits{0}, resumes{0}, misses{0}, evictions{0}, repairs{0}, restarts{0};
+
+    // Runs read(entry) once dest_idx is settled in the source's search. Unreachable pairs are
+    // answered from the graph's SCC index without touching the cache.
+    template <class Read, class Result>
+    Result query(int source_idx, int dest_idx, Read read, Result unreachable) {
+        if (!graph->mayReach(source_idx, dest_idx))
+            return unreachable;
+        bool created = false;
+        shared_ptr<Entry> e = acquire(source_idx, created);
+        if (!created) {
+            shared_lock<shared_mutex> reader(e->lock);
+            if (e->settled[dest_idx]) {
+                hits.fetch_add(1, memory_order_relaxed);
+                return read(*e);
+            }
+        }
+        Result result;
+        size_t bytes;
+        {
+            unique_lock<shared_mutex> writer(e->lock);
+            if (!e->settled[dest_idx]) {
+                resume(*e, dest_idx);
+                (created ? misses : resumes).fetch_add(1, memory_order_relaxed);
+            } else {
+                hits.fetch_add(1, memory_order_relaxed);    // another thread got there first
+            }
+            result = read(*e);
+            bytes = e->bytes();
+        }
+        account(source_idx, e, bytes);
+        return result;
+    }
+
+    // The source's entry, moved to the front of the LRU list; created (outside the lock) if missing
+    shared_ptr<Entry> acquire(int source_idx, bool& created) {
+        created = false;
+        {
+            lock_guard<mutex> guard(lru_mutex);
+            auto it = slots.find(source_idx);
+            if (it != slots.end()) {
+                lru.splice(lru.begin(), lru, it->second.position);
+                return it->second.entry;
+            }
+        }
+        auto fresh = make_shared<Entry>(source_idx, graph->airports.size());
+        lock_guard<mutex> guard(lru_mutex);
+        auto it = slots.find(source_idx);
+        if (it != slots.end()) {        // another thread inserted it meanwhile
+            lru.splice(lru.begin(), lru, it->second.position);
+            return it->second.entry;
+        }
+        lru.push_front(source_idx);
+        slots[source_idx] = Slot{fresh, lru.begin(), 0};
+        created = true;
+        return fresh;
+    }
+
+    // Records the entry's new size and evicts from the back of the list if over budget
+    void account(int source_idx, const shared_ptr<Entry>& e, size_t bytes) {
+        lock_guard<mutex> guard(lru_mutex);
+        auto it = slots.find(source_idx);
+        if (it == slots.end() || it->second.entry != e)
+            return;                     // evicted or cleared while we were searching
+        total_bytes = total_bytes - it->second.bytes + bytes;
+        it->second.bytes = bytes;
+        evictOverBudget(source_idx);
+    }
+
+    void evictOverBudget(int keep) {
+        while (total_bytes > budget && !lru.empty()) {
+            const int victim = lru.back();
+            if (victim == keep)
+                break;
+            total_bytes -= slots[victim].bytes;
+            slots.erase(victim);
+            lru.pop_back();
+            evictions.fetch_add(1, memory_order_relaxed);
+        }
+    }
+
+    // Continues the suspended Dijkstra until dest_idx is settled or nothing is left to settle.
+    // A settled airport's routes are relaxed before the search stops, so it can pick up again
+    // from the heap alone.
+    void resume(Entry& e, int dest_idx) const {
+        const FlightGraph& G = *graph;
+        auto later = greater<pair<double, int>>();
+        while (!e.heap.empty() && !e.settled[dest_idx]) {
+            pop_heap(e.heap.begin(), e.heap.end(), later);
+            const auto [key, u] = e.heap.back();
+            e.heap.pop_back();
+            // key != dist: an entry left over from before a repair() changed the distance
+            if (e.settled[u] || key != e.dist[u])
+                continue;
+            e.settled[u] = 1;
+            const double du = e.dist[u];
+            e.radius = max(e.radius, du);
+            for (uint32_t r = G.fwd_offsets[u]; r < G.fwd_offsets[u + 1]; r++) {
+                const int v = G.fwd_dest[r];
+                const double candidate = du + G.fwd_weight[r];
+                if (!e.settled[v] && candidate < e.dist[v]) {
+                    e.dist[v] = candidate;
+                    e.parent[v] = u;
+                    e.heap.push_back({candidate, v});
+                    push_heap(e.heap.begin(), e.heap.end(), later);
+                }
+            }
+        }
+        if (e.heap.empty())
+            e.heap.shrink_to_fit();     // the tree is complete; the heap is never needed again
+    }
+
+    // False if the search was restarted instead
+    bool repairEntry(Entry& e, span<const RouteChange> changes) const {
+        const FlightGraph& G = *graph;
+        const size_t num_airports = G.airports.size();
+        const size_t max_work = num_airports / 2;
+        size_t work = 0;
+        if (e.dist.size() < num_airports) {     // the update added airports
+            e.dist.resize(num_airports, numeric_limits<double>::infinity());
+            e.parent.resize(num_airports, -1);
+            e.settled.resize(num_airports, 0);
+        }
+        auto later = greater<pair<double, int>>();
+        auto requeue = [&](int v) {
+            e.heap.push_back({e.dist[v], v});
+            push_heap(e.heap.begin(), e.heap.end(), later);
+        };
+        vector<pair<double, int>> local;
+        auto improve = [&](int v, double d, int from) {
+            e.dist[v] = d;
+            e.parent[v] = from;
+            local.push_back({d, v});
+            push_heap(local.begin(), local.end(), later);
+        };
+
+        // slower or removed tree edges: unsettle everything below them
+        vector<uint8_t> state(num_airports, 0);     // 0 = not looked at, 1 = below a changed edge, 2 = fine
+        bool any_slower = false;
+        for (const RouteChange& c : changes) {
+            if (c.new_time > c.old_time && e.parent[c.destination] == c.source) {
+                state[c.destination] = 1;
+                any_slower = true;
+            }
+        }
+        if (any_slower) {
+            vector<int> chain, below;
+            for (int v = 0; v < (int)num_airports; v++) {
+                chain.clear();
+                int x = v;
+                while (x != -1 && state[x] == 0) {
+                    chain.push_back(x);
+                    x = e.parent[x];
+                }
+                const uint8_t verdict = x == -1 ? 2 : state[x];
+                for (int y : chain)
+                    state[y] = verdict;
+                if (state[v] == 1)
+                    below.push_back(v);
+            }
+            work = below.size();
+            if (work > max_work) {
+                e.restart(num_airports);
+                return false;
+            }
+            for (int v : below) {
+                e.dist[v] = numeric_limits<double>::infinity();
+                e.parent[v] = -1;
+                e.settled[v] = 0;
+            }
+            for (int v : below) {
+                for (uint32_t i = G.rev_offsets[v]; i < G.rev_offsets[v + 1]; i++) {
+                    const int y = G.rev_src[i];
+                    if (e.dist[y] + G.rev_weight[i] < e.dist[v]) {
+                        e.dist[v] = e.dist[y] + G.rev_weight[i];
+                        e.parent[v] = y;
+                    }
+                }
+                if (!std::isinf(e.dist[v]))
+                    local.push_back({e.dist[v], v});
+            }
+            make_heap(local.begin(), local.end(), later);
+        }
+
+        // faster or new routes, and the re-seeded airports: propagate within the settled radius
+        for (const RouteChange& c : changes) {
+            if (c.new_time < c.old_time && e.dist[c.source] <= e.radius &&
+                e.dist[c.source] + c.new_time < e.dist[c.destination])
+                improve(c.destination, e.dist[c.source] + c.new_time, c.source);
+        }
+        while (!local.empty()) {
+            pop_heap(local.begin(), local.end(), later);
+            const auto [d, x] = local.back();
+            local.pop_back();
+            if (d != e.dist[x])
+                continue;
+            if (!e.settled[x])
+                requeue(x);
+            if (d > e.radius)
+                continue;           // nothing within the radius can get this far
+            if (++work > max_work) {
+                e.restart(num_airports);
+                return false;
+            }
+            for (uint32_t r = G.fwd_offsets[x]; r < G.fwd_offsets[x + 1]; r++) {
+                const int y = G.fwd_dest[r];
+                if (d + G.fwd_weight[r] < e.dist[y])
+                    improve(y, d + G.fwd_weight[r], x);
+            }
+        }
+        return true;
+    }
+};
@@ -0,0 +1,126 @@
+// Writes a synthetic routes CSV for scaling benchmarks: K copies of a routes file with the airport
+// codes suffixed by the copy number ("JFK_7"), and a fraction of the flights rewired to land in
+// the next copy (the last copy wraps to the first), so the copies form one connected graph rather
+// than K separate ones. The same arguments always give the same file.
+//
+//   AirgorithmSynthetic [--copies K] [--rewire F] [--seed S] [--routes in.csv] [--out out.csv]
+//
+// The singleSourceAll() scaling graph (342k airports, 10M flights) is
+//
+//   AirgorithmSynthetic --copies 100 --rewire 0.1 --out synthetic_100x.csv
+//   AirgorithmBench --routes synthetic_100x.csv --airports "" --pairs 20 \
+//       --only dijkstra,single_source_all.t1,single_source_all.t2,single_source_all.t4
+
+#include "mapped_file.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <random>
+using namespace std;
+
+static int usage() {
+    cerr << "Usage: AirgorithmSynthetic [--copies K] [--rewire F] [--seed S] [--routes in.csv] [--out out.csv]\n";
+    return 1;
+}
+
+static vector<string_view> splitColumns(string_view line) {
+    vector<string_view> cols;
+    size_t start = 0;
+    for (size_t i = 0; i <= line.size(); i++) {
+        if (i == line.size() || line[i] == ',') {
+            cols.push_back(line.substr(start, i - start));
+            start = i + 1;
+        }
+    }
+    return cols;
+}
+
+int main(int argc, char** argv) {
+    int copies = 100;
+    double rewire = 0.1;
+    uint64_t seed = 1;
+    string routes_path = "data/routes_with_estimated_times_plus_33k.csv";
+    string out_path = "synthetic_routes.csv";
+    for (int i = 1; i < argc; i++) {
+        const string arg = argv[i];
+        if (arg == "--copies" && i + 1 < argc) {
+            copies = atoi(argv[++i]);
+        } else if (arg == "--rewire" && i + 1 < argc) {
+            rewire = atof(argv[++i]);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--routes" && i + 1 < argc) {
+            routes_path = argv[++i];
+        } else if (arg == "--out" && i + 1 < argc) {
+            out_path = argv[++i];
+        } else {
+            return usage();
+        }
+    }
+    if (copies < 1 || !(rewire >= 0 && rewire <= 1))
+        return usage();
+
+    MappedFile file;
+    if (!file.open(routes_path, true)) {
+        cerr << "Cannot open " << routes_path << "\n";
+        return 1;
+    }
+    // header first, then one row per flight: columns 2 and 4 are the source and destination codes
+    string_view text = file.view(), header;
+    vector<vector<string_view>> rows;
+    for (size_t start = 0; start < text.size();) {
+        size_t end = text.find('\n', start);
+        if (end == string_view::npos)
+            end = text.size();
+        string_view line = text.substr(start, end - start);
+        start = end + 1;
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+        if (header.empty()) {
+            header = line;
+            continue;
+        }
+        vector<string_view> cols = splitColumns(line);
+        if (cols.size() >= 10)
+            rows.push_back(std::move(cols));
+    }
+
+    ofstream out(out_path, ios::binary | ios::trunc);
+    if (!out) {
+        cerr << "Cannot write " << out_path << "\n";
+        return 1;
+    }
+    out << header << "\n";
+    mt19937_64 rng(seed);
+    bernoulli_distribution rewired(rewire);
+    string line;
+    size_t moved = 0;
+    for (int k = 0; k < copies; k++) {
+        const string suffix = "_" + to_string(k), next = "_" + to_string((k + 1) % copies);
+        for (const vector<string_view>& cols : rows) {
+            const bool to_next = rewired(rng);
+            moved += to_next;
+            line.clear();
+            for (size_t c = 0; c < cols.size(); c++) {
+                if (c > 0)
+                    line += ',';
+                line += cols[c];
+                if (c == 2)
+                    line += suffix;
+                else if (c == 4)
+                    line += to_next ? next : suffix;
+            }
+            out << line << '\n';
+        }
+    }
+    out.close();
+    if (!out) {
+        cerr << "Cannot write " << out_path << "\n";
+        return 1;
+    }
+    cerr << "Wrote " << out_path << ": " << copies << " copies of " << rows.size() << " flights, " << moved
+         << " rewired to the next copy\n";
+    return 0;
+}
@@ -0,0 +1,66 @@
+// Tests FlightGraph::applyUpdates() on a written fixture: REMOVE and RETIME must find flights an
+// ADD earlier in the same batch introduced, and the graph must then route as if it had been
+// loaded with the resulting flight table. Exits non-zero on any failure.
+
+#include "graph.h"
+#include "test_support.h"
+using namespace std;
+
+static FlightUpdate update(FlightUpdate::Kind kind, const string& from, const string& to, const string& airline,
+                           double hours = numeric_limits<double>::quiet_NaN()) {
+    FlightUpdate up;
+    up.kind = kind;
+    up.source = from;
+    up.destination = to;
+    up.airline = airline;
+    up.est_time_hr = hours;
+    return up;
+}
+
+int main() {
+    const string routes_path = "apply_updates_test_routes.csv";
+    {
+        ofstream r(routes_path);
+        r << "Airline,Airline_ID,Source_airport,Source_airport_ID,Destination_airport,Destination_airport_ID,"
+             "Codeshare,Stops,Equipment,Estimated_Flight_Time_hr\n"
+          << "XX,1,AAA,1,BBB,2,,0,738,1.0\n"
+          << "XX,1,BBB,2,CCC,3,,0,738,1.0\n";
+    }
+    FlightGraph G;
+    const bool loaded = G.loadFromEstimatedCSV(routes_path);
+    remove(routes_path.c_str());
+    if (!loaded)
+        return check(false, "cannot load the fixture");
+    const double inf = numeric_limits<double>::infinity();
+    auto at = [&](const char* code) { return G.findAirportIndexByCode(code); };
+    QueryWorkspace ws;
+    size_t failures = 0;
+
+    // add then remove a direct AAA -> CCC: nothing left of it
+    const size_t flights = G.edgeCount();
+    vector<FlightUpdate> batch = {update(FlightUpdate::ADD, "AAA", "CCC", "YY", 0.5),
+                                  update(FlightUpdate::REMOVE, "AAA", "CCC", "YY")};
+    UpdateReport report = G.applyUpdates(batch);
+    failures += check(report.applied == 2 && report.unmatched == 0,
+                      "add + remove: applied " + to_string(report.applied) + " unmatched " + to_string(report.unmatched));
+    failures += check(G.edgeCount() == flights && G.routeTime(at("AAA"), at("CCC")) == inf, "add + remove left a flight");
+    failures += check(G.dijkstra(at("AAA"), at("CCC"), ws) == 2.0, "add + remove: AAA -> CCC is not 2 h");
+
+    // add then retime, within one batch
+    batch = {update(FlightUpdate::ADD, "AAA", "CCC", "YY", 3.0), update(FlightUpdate::RETIME, "AAA", "CCC", "YY", 1.5)};
+    report = G.applyUpdates(batch);
+    failures += check(report.applied == 2 && report.unmatched == 0, "add + retime: not all applied");
+    failures += check(G.routeTime(at("AAA"), at("CCC")) == 1.5, "add + retime: AAA -> CCC route is not 1.5 h");
+    failures += check(G.dijkstra(at("AAA"), at("CCC"), ws) == 1.5, "add + retime: AAA -> CCC is not 1.5 h");
+
+    // a new airport whose only flight is removed again; the second REMOVE matches nothing
+    batch = {update(FlightUpdate::ADD, "CCC", "NEW", "XX", 2.0), update(FlightUpdate::REMOVE, "CCC", "NEW", "XX"),
+             update(FlightUpdate::REMOVE, "CCC", "NEW", "XX")};
+    report = G.applyUpdates(batch);
+    failures += check(report.applied == 2 && report.unmatched == 1, "new airport: expected 2 applied, 1 unmatched");
+    failures += check(at("NEW") >= 0 && G.dijkstra(at("AAA"), at("NEW"), ws) == inf, "new airport: still reachable");
+    failures += check(G.dijkstra(at("AAA"), at("CCC"), ws) == 1.5, "new airport: AAA -> CCC changed");
+
+    cout << failures << " failures\n";
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,115 @@
+// Differential test: astar() must return the same fastest times as dijkstra().
+//
+// Runs seeded random pairs over the real data (routes plus airports.dat, loaded like the
+// frontend), with extra pairs whose ends have no coordinates, and over a small written fixture
+// where one airport sits at (0,0) and another is missing from the airport file. Exits non-zero
+// on any mismatch.
+
+#include "graph.h"
+#include "test_support.h"
+#include <random>
+using namespace std;
+
+// Compares astar() with dijkstra() on every pair; returns the number of mismatches
+static size_t compare(const FlightGraph& G, const vector<pair<int, int>>& pairs, const string& label) {
+    QueryWorkspace ws;
+    size_t mismatches = 0;
+    for (auto [s, t] : pairs) {
+        const double expected = G.dijkstra(s, t, ws);
+        const double got = G.astar(s, t, ws);
+        if (!sameTime(got, expected)) {
+            if (mismatches++ < 10)
+                cerr << label << ": " << G.airports[s].code << " -> " << G.airports[t].code << " astar " << got
+                     << " dijkstra " << expected << "\n";
+        }
+    }
+    cout << label << ": " << pairs.size() << " pairs, " << mismatches << " mismatches\n";
+    return mismatches;
+}
+
+static size_t realData(uint64_t seed, size_t count) {
+    FlightGraph G;
+    if (!G.loadWithSnapshot("data/routes_airports.snapshot", "data/routes_with_estimated_times_plus_33k.csv",
+                            "data/airports.dat")) {
+        cerr << "cannot load data/\n";
+        return 1;
+    }
+    const int n = G.airports.size();
+    vector<int> no_coords;
+    for (int v = 0; v < n; v++)
+        if (!G.airports[v].has_coords)
+            no_coords.push_back(v);
+    if (no_coords.empty()) {
+        cerr << "expected airports without coordinates in the data\n";
+        return 1;
+    }
+
+    mt19937_64 rng(seed);
+    uniform_int_distribution<int> any(0, n - 1);
+    uniform_int_distribution<size_t> missing(0, no_coords.size() - 1);
+    vector<pair<int, int>> pairs;
+    for (size_t i = 0; i < count; i++)
+        pairs.push_back({any(rng), any(rng)});
+    for (size_t i = 0; i < count / 10; i++) {
+        pairs.push_back({no_coords[missing(rng)], any(rng)});
+        pairs.push_back({any(rng), no_coords[missing(rng)]});
+        pairs.push_back({no_coords[missing(rng)], no_coords[missing(rng)]});
+    }
+    return compare(G, pairs, "routes + airports.dat");
+}
+
+// Eight airports: ZZZ at (0,0) in the airport file, NOC not in it at all, NUL and BAD in it with
+// \N and unparsable coordinates. Flights through them are much faster than their great-circle
+// distance would suggest, so a bound fitted without them would cut the fastest paths.
+static size_t fixture() {
+    const string airports_path = "astar_test_airports.dat", routes_path = "astar_test_routes.csv";
+    {
+        ofstream a(airports_path);
+        a << "1,\"A\",\"A\",\"X\",\"AAA\",\"XAAA\",40.0,-74.0,0,0,\"U\",\"\",\"airport\",\"test\"\n"
+          << "2,\"B\",\"B\",\"X\",\"BBB\",\"XBBB\",34.0,-118.0,0,0,\"U\",\"\",\"airport\",\"test\"\n"
+          << "3,\"C\",\"C\",\"X\",\"CCC\",\"XCCC\",51.5,0.0,0,0,\"U\",\"\",\"airport\",\"test\"\n"
+          << "4,\"D\",\"D\",\"X\",\"DDD\",\"XDDD\",35.7,139.7,0,0,\"U\",\"\",\"airport\",\"test\"\n"
+          << "5,\"Z\",\"Z\",\"X\",\"ZZZ\",\"XZZZ\",0,0,0,0,\"U\",\"\",\"airport\",\"test\"\n"
+          << "7,\"N\",\"N\",\"X\",\"NUL\",\"XNUL\",\\N,\\N,0,0,\"U\",\"\",\"airport\",\"test\"\n"
+          << "8,\"Q\",\"Q\",\"X\",\"BAD\",\"XBAD\",north,-74.0,0,0,\"U\",\"\",\"airport\",\"test\"\n";
+        ofstream r(routes_path);
+        r << "Airline,Airline_ID,Source_airport,Source_airport_ID,Destination_airport,Destination_airport_ID,"
+             "Codeshare,Stops,Equipment,Estimated_Flight_Time_hr\n"
+          << "XX,1,AAA,1,BBB,2,,0,738,5.5\n"
+          << "XX,1,BBB,2,DDD,4,,0,738,11.0\n"
+          << "XX,1,AAA,1,ZZZ,5,,0,738,1.0\n"
+          << "XX,1,ZZZ,5,DDD,4,,0,738,1.0\n"
+          << "XX,1,AAA,1,NOC,6,,0,738,0.5\n"
+          << "XX,1,NOC,6,CCC,3,,0,738,0.5\n"
+          << "XX,1,CCC,3,DDD,4,,0,738,12.0\n"
+          << "XX,1,DDD,4,AAA,1,,0,738,13.0\n"
+          << "XX,1,CCC,3,BBB,2,,0,738,11.0\n"
+          << "XX,1,BBB,2,NUL,7,,0,738,0.5\n"
+          << "XX,1,NUL,7,BAD,8,,0,738,0.5\n"
+          << "XX,1,BAD,8,DDD,4,,0,738,0.5\n";
+    }
+    FlightGraph G;
+    const bool loaded = G.loadAirportsDat(airports_path) && G.loadFromEstimatedCSV(routes_path);
+    remove(airports_path.c_str());
+    remove(routes_path.c_str());
+    if (!loaded) {
+        cerr << "cannot load the fixture\n";
+        return 1;
+    }
+    size_t failures = 0;
+    for (const char* code : {"NOC", "NUL", "BAD"}) {
+        const int v = G.findAirportIndexByCode(code);
+        failures += check(v >= 0 && !G.airports[v].has_coords, string(code) + " should have no coordinates");
+    }
+    vector<pair<int, int>> pairs;
+    for (int s = 0; s < (int)G.airports.size(); s++)
+        for (int t = 0; t < (int)G.airports.size(); t++)
+            pairs.push_back({s, t});
+    return failures + compare(G, pairs, "fixture");
+}
+
+int main(int argc, char** argv) {
+    const uint64_t seed = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1;
+    const size_t mismatches = fixture() + realData(seed, 5000);
+    return mismatches == 0 ? 0 : 1;
+}
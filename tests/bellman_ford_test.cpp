@@ -0,0 +1,142 @@
+// Tests bellmanFord(): the flight times must give the same fastest times as dijkstra() on one and
+// on two threads; caller-supplied weights with negative routes must give the shortest distances
+// when there is no negative cycle, and -inf when one is reachable from the source.
+//
+// Negative weights without a negative cycle come from a potential p: w'(u, v) = w(u, v) + p(u) -
+// p(v) changes every path s -> t by the same p(s) - p(t), so dijkstra() on the plain times is
+// still the reference. Exits non-zero on any mismatch.
+
+#include "graph.h"
+#include "test_support.h"
+#include <random>
+using namespace std;
+
+// Route index of u -> v, or -1
+static int routeIndex(const FlightGraph& G, int u, int v) {
+    for (uint32_t e = G.fwd_offsets[u]; e < G.fwd_offsets[u + 1]; e++)
+        if (G.fwd_dest[e] == v)
+            return e;
+    return -1;
+}
+
+static size_t realData(uint64_t seed, size_t count) {
+    FlightGraph G;
+    if (!G.loadWithSnapshot("data/routes_airports.snapshot", "data/routes_with_estimated_times_plus_33k.csv",
+                            "data/airports.dat")) {
+        cerr << "cannot load data/\n";
+        return 1;
+    }
+    const int n = G.airports.size();
+    mt19937_64 rng(seed);
+    uniform_int_distribution<int> any(0, n - 1);
+    uniform_real_distribution<double> potential_of(0.0, 20.0);
+
+    vector<double> times(G.fwd_weight.begin(), G.fwd_weight.end());
+    vector<double> potential(n), shifted(G.routeCount());
+    for (int v = 0; v < n; v++)
+        potential[v] = potential_of(rng);
+    size_t negative = 0;
+    for (int u = 0; u < n; u++)
+        for (uint32_t e = G.fwd_offsets[u]; e < G.fwd_offsets[u + 1]; e++) {
+            shifted[e] = G.fwd_weight[e] + potential[u] - potential[G.fwd_dest[e]];
+            negative += shifted[e] < 0;
+        }
+
+    QueryWorkspace ws, ref;
+    size_t mismatches = 0;
+    for (size_t i = 0; i < count; i++) {
+        const int s = any(rng), t = any(rng);
+        const double expected = G.dijkstra(s, t, ref);
+        const double got[4] = {G.bellmanFord(s, t, ws, 1), G.bellmanFord(s, t, ws, 2), G.bellmanFord(s, t, ws, times),
+                               G.bellmanFord(s, t, ws, shifted, 2) - potential[s] + potential[t]};
+        for (int k = 0; k < 4; k++)
+            if (!(isinf(expected) ? got[k] == expected : sameTime(got[k], expected))) {
+                if (mismatches++ < 10)
+                    cerr << G.airports[s].code << " -> " << G.airports[t].code << " variant " << k << " bellmanFord "
+                         << got[k] << " dijkstra " << expected << "\n";
+            }
+        // parents must lead back to the source
+        G.bellmanFord(s, t, ws, 1);
+        if (!isinf(expected))
+            mismatches += check(ws.parent(s) == -1 && (s == t || ws.parent(t) != -1),
+                                "broken parents for " + G.airports[s].code + " -> " + G.airports[t].code);
+    }
+    cout << "routes + airports.dat: " << count << " pairs, " << negative << " negative routes, " << mismatches
+         << " mismatches\n";
+
+    // a two-route cycle of total weight -1: every airport that reaches u sees -inf
+    const int u = G.findAirportIndexByCode("ATL"), v = G.findAirportIndexByCode("JFK");
+    const int uv = routeIndex(G, u, v), vu = routeIndex(G, v, u);
+    if (u < 0 || v < 0 || uv < 0 || vu < 0) {
+        cerr << "expected ATL <-> JFK routes\n";
+        return mismatches + 1;
+    }
+    vector<double> cycle = times;
+    cycle[uv] = -1.0 - cycle[vu];
+    const int lhr = G.findAirportIndexByCode("LHR"), syd = G.findAirportIndexByCode("SYD");
+    mismatches += check(G.bellmanFord(lhr, syd, ws, cycle) == -numeric_limits<double>::infinity(),
+                        "LHR -> SYD: negative cycle ATL <-> JFK not detected");
+    mismatches += check(!ws.reached(lhr), "negative cycle: workspace not left empty");
+    return mismatches;
+}
+
+// Six airports, two components: AAA -> BBB <-> CCC -> FFF, and DDD <-> EEE on their own
+static size_t fixture() {
+    const string routes_path = "bellman_ford_test_routes.csv";
+    {
+        ofstream r(routes_path);
+        r << "Airline,Airline_ID,Source_airport,Source_airport_ID,Destination_airport,Destination_airport_ID,"
+             "Codeshare,Stops,Equipment,Estimated_Flight_Time_hr\n"
+          << "XX,1,AAA,1,BBB,2,,0,738,1.0\n"
+          << "XX,1,BBB,2,CCC,3,,0,738,1.0\n"
+          << "XX,1,CCC,3,BBB,2,,0,738,1.0\n"
+          << "XX,1,CCC,3,FFF,6,,0,738,1.0\n"
+          << "XX,1,DDD,4,EEE,5,,0,738,1.0\n"
+          << "XX,1,EEE,5,DDD,4,,0,738,1.0\n";
+    }
+    FlightGraph G;
+    const bool loaded = G.loadFromEstimatedCSV(routes_path);
+    remove(routes_path.c_str());
+    if (!loaded) {
+        cerr << "cannot load the fixture\n";
+        return 1;
+    }
+    auto at = [&](const char* code) { return G.findAirportIndexByCode(code); };
+    auto route = [&](const char* from, const char* to) { return routeIndex(G, at(from), at(to)); };
+    const double inf = numeric_limits<double>::infinity();
+    QueryWorkspace ws;
+    size_t failures = 0;
+
+    vector<double> w(G.fwd_weight.begin(), G.fwd_weight.end());
+    w[route("BBB", "CCC")] = -0.5;
+    failures += check(sameTime(G.bellmanFord(at("AAA"), at("FFF"), ws, w), 1.5), "AAA -> FFF with BBB -> CCC = -0.5");
+    failures += check(ws.parent(at("FFF")) == at("CCC") && ws.parent(at("CCC")) == at("BBB"), "AAA -> FFF parents");
+
+    // a negative cycle the source cannot reach does not matter
+    w[route("DDD", "EEE")] = -2.0;
+    failures += check(sameTime(G.bellmanFord(at("AAA"), at("FFF"), ws, w, 2), 1.5), "AAA -> FFF, unreachable cycle");
+    failures += check(G.bellmanFord(at("DDD"), at("AAA"), ws, w) == -inf, "DDD: negative cycle not detected");
+
+    // BBB <-> CCC at -0.5 + -1: reachable from AAA
+    w[route("CCC", "BBB")] = -1.0;
+    failures += check(G.bellmanFord(at("AAA"), at("FFF"), ws, w) == -inf, "AAA: negative cycle not detected");
+    failures += check(G.bellmanFord(at("AAA"), at("FFF"), ws, w, 2) == -inf, "AAA: negative cycle not detected (2)");
+
+    // unusable routes: NaN and +inf cut AAA off
+    w[route("AAA", "BBB")] = numeric_limits<double>::quiet_NaN();
+    failures += check(G.bellmanFord(at("AAA"), at("FFF"), ws, w) == inf, "AAA -> BBB NaN is not unusable");
+    w[route("AAA", "BBB")] = inf;
+    failures += check(G.bellmanFord(at("AAA"), at("FFF"), ws, w) == inf, "AAA -> BBB inf is not unusable");
+
+    // wrong weight count
+    failures += check(isnan(G.bellmanFord(at("AAA"), at("FFF"), ws, span<const double>(w).first(2))),
+                      "short weight vector accepted");
+    cout << "fixture: " << failures << " failures\n";
+    return failures;
+}
+
+int main(int argc, char** argv) {
+    const uint64_t seed = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1;
+    const size_t mismatches = fixture() + realData(seed, 400);
+    return mismatches == 0 ? 0 : 1;
+}
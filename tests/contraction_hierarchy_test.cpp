@@ -0,0 +1,127 @@
+// Tests ContractionHierarchy on the real data: route() on seeded random pairs must give the time
+// and airport path of dijkstra() (a different path counts only if it is a real, equally fast
+// route: ties may be broken the other way), and open() must reject files whose arcs leave the
+// graph, whose shortcuts unpack without end, or whose rank is no permutation, keeping the
+// hierarchy it had. Building takes about a minute, so the hierarchy is saved next to the test
+// and reopened on later runs. Exits non-zero on any failure.
+
+#include "contraction_hierarchy.h"
+#include "test_support.h"
+#include <random>
+using namespace std;
+
+// The hierarchy's columns as vectors, to write modified copies
+struct HierarchyColumns {
+    vector<int> rank, up_head, up_middle, down_tail, down_middle;
+    vector<uint32_t> up_offsets, down_offsets;
+    vector<double> up_weight, down_weight;
+
+    explicit HierarchyColumns(const ContractionHierarchy& ch)
+        : rank(ch.rank.begin(), ch.rank.end()), up_head(ch.up_head.begin(), ch.up_head.end()),
+          up_middle(ch.up_middle.begin(), ch.up_middle.end()), down_tail(ch.down_tail.begin(), ch.down_tail.end()),
+          down_middle(ch.down_middle.begin(), ch.down_middle.end()),
+          up_offsets(ch.up_offsets.begin(), ch.up_offsets.end()),
+          down_offsets(ch.down_offsets.begin(), ch.down_offsets.end()),
+          up_weight(ch.up_weight.begin(), ch.up_weight.end()), down_weight(ch.down_weight.begin(), ch.down_weight.end()) {}
+
+    bool write(const string& path, const FlightGraph& G) const {
+        SnapshotWriter writer;
+        const uint64_t fp = G.fingerprint();
+        writer.add(SEC_GRAPH_FINGERPRINT, &fp, 1);
+        writer.add(SEC_CH_RANK, rank.data(), rank.size());
+        writer.add(SEC_CH_UP_OFFSETS, up_offsets.data(), up_offsets.size());
+        writer.add(SEC_CH_UP_HEAD, up_head.data(), up_head.size());
+        writer.add(SEC_CH_UP_WEIGHT, up_weight.data(), up_weight.size());
+        writer.add(SEC_CH_UP_MIDDLE, up_middle.data(), up_middle.size());
+        writer.add(SEC_CH_DOWN_OFFSETS, down_offsets.data(), down_offsets.size());
+        writer.add(SEC_CH_DOWN_TAIL, down_tail.data(), down_tail.size());
+        writer.add(SEC_CH_DOWN_WEIGHT, down_weight.data(), down_weight.size());
+        writer.add(SEC_CH_DOWN_MIDDLE, down_middle.data(), down_middle.size());
+        return writer.write(path, SnapshotSourceStamp(), SnapshotSourceStamp());
+    }
+};
+
+// route() against dijkstra() by airport code; returns the number of mismatches
+static size_t compareRoutes(const FlightGraph& G, const ContractionHierarchy& ch, uint64_t seed, size_t count) {
+    mt19937_64 rng(seed);
+    uniform_int_distribution<int> any(0, (int)G.airports.size() - 1);
+    size_t mismatches = 0, reachable = 0, ties = 0;
+    for (size_t i = 0; i < count; i++) {
+        const string& s = G.airports[any(rng)].code;
+        const string& t = G.airports[any(rng)].code;
+        const auto [expected_time, expected_path] = G.dijkstra(s, t);
+        const auto [time, path] = ch.route(s, t);
+        if (isinf(expected_time)) {
+            mismatches += check(isinf(time) && path.empty(), s + " -> " + t + ": route() found a path");
+            continue;
+        }
+        reachable++;
+        bool ok = sameTime(time, expected_time) && !path.empty() && path.front() == s && path.back() == t;
+        if (ok && path != expected_path) {
+            // an equally fast alternative: every hop must be a route, and the hops must add up
+            vector<int> nodes;
+            for (const string& code : path)
+                nodes.push_back(G.findAirportIndexByCode(code));
+            ok = sameTime(G.pathTime(nodes), expected_time);
+            ties++;
+        }
+        if (!ok && mismatches++ < 10)
+            cerr << s << " -> " << t << ": ch " << time << " over " << path.size() << " airports, dijkstra "
+                 << expected_time << " over " << expected_path.size() << "\n";
+    }
+    cout << "route: " << count << " pairs (" << reachable << " reachable, " << ties << " equally fast ties), "
+         << mismatches << " mismatches\n";
+    return mismatches;
+}
+
+int main(int argc, char** argv) {
+    const uint64_t seed = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1;
+    FlightGraph G;
+    if (!G.loadWithSnapshot("data/routes_airports.snapshot", "data/routes_with_estimated_times_plus_33k.csv",
+                            "data/airports.dat")) {
+        cerr << "cannot load data/\n";
+        return 1;
+    }
+    const string path = "contraction_hierarchy_test.snapshot", bad_path = "contraction_hierarchy_test_bad.snapshot";
+    ContractionHierarchy ch;
+    if (!ch.open(path, G)) {
+        ch.build(G);
+        ch.stats.print(cout);
+        if (!ch.save(path))
+            cerr << "cannot save " << path << " (the next run builds again)\n";
+    }
+    size_t failures = compareRoutes(G, ch, seed, 2000);
+
+    // a shortcut whose middle airport is one of its ends
+    size_t shortcut = 0;
+    while (shortcut < ch.up_middle.size() && ch.up_middle[shortcut] < 0)
+        shortcut++;
+    if (shortcut == ch.up_middle.size())
+        return failures + check(false, "expected shortcuts in the hierarchy");
+    const int n = G.airports.size();
+    const struct {
+        const char* what;
+        function<void(HierarchyColumns&)> corrupt;
+    } cases[] = {
+        {"rank with a repeat", [&](HierarchyColumns& c) { c.rank[0] = c.rank[1]; }},
+        {"rank out of range", [&](HierarchyColumns& c) { c.rank[0] = n; }},
+        {"up head out of range", [&](HierarchyColumns& c) { c.up_head[0] = n; }},
+        {"down tail below 0", [&](HierarchyColumns& c) { c.down_tail[0] = -2; }},
+        {"middle out of range", [&](HierarchyColumns& c) { c.up_middle[shortcut] = n; }},
+        {"middle -2", [&](HierarchyColumns& c) { c.down_middle[0] = -2; }},
+        {"middle that is the head", [&](HierarchyColumns& c) { c.up_middle[shortcut] = c.up_head[shortcut]; }},
+    };
+    for (const auto& c : cases) {
+        HierarchyColumns columns(ch);
+        c.corrupt(columns);
+        if (!columns.write(bad_path, G)) {
+            failures += check(false, "cannot write " + bad_path);
+            continue;
+        }
+        failures += check(!ch.open(bad_path, G), string("open() accepted ") + c.what);
+    }
+    remove(bad_path.c_str());
+    failures += compareRoutes(G, ch, seed + 1, 200);
+    cout << failures << " failures\n";
+    return failures == 0 ? 0 : 1;
+}
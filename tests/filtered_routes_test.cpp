@@ -0,0 +1,212 @@
+// Tests hop-limited and filtered routing (constrainedRoute(), hopLimitedBellmanFord(),
+// dijkstra() over a FlightMask) and paretoRoutes(). On a small written fixture with known
+// answers: the flight limit (--max-stops N is N + 1 flights) changes the route, alliance and
+// no-codeshare filters give the route over only the flights they allow, and the Pareto front is
+// the known one. On seeded pairs of the real data: the unfiltered round search and a mask that
+// allows everything equal dijkstra(), every filtered route flies only allowed flights, and every
+// Pareto front is non-dominated, ends at dijkstra()'s time and holds the hop-limited optimum of
+// each of its flight counts. Exits non-zero on any failure.
+
+#include "graph.h"
+#include "test_support.h"
+#include <random>
+using namespace std;
+
+static const double inf = numeric_limits<double>::infinity();
+
+static string joined(const vector<string>& codes) {
+    string s;
+    for (const string& code : codes)
+        s += (s.empty() ? "" : " ") + code;
+    return s;
+}
+
+// Every flight the filter would pick along the path passes it; returns the number of failures
+static size_t checkFlights(const FlightGraph& G, const vector<int>& path, const FlightFilter& filter,
+                           const string& label) {
+    const vector<Edge> flights = G.pathFlights(path, G.compileFilter(filter));
+    size_t failures = check(flights.size() + 1 == path.size(), label + ": a hop has no allowed flight");
+    for (const Edge& e : flights)
+        failures += check((allianceOf(e.airline) & filter.alliances) && (filter.allow_codeshare || !e.codeshare),
+                          label + ": flies " + e.airline + (e.codeshare ? " (codeshare)" : ""));
+    return failures;
+}
+
+// Flights strictly increase along the front while times strictly decrease
+static size_t checkFront(const vector<pair<double, vector<int>>>& front, const string& label) {
+    size_t failures = 0;
+    for (size_t i = 1; i < front.size(); i++)
+        failures += check(front[i].second.size() > front[i - 1].second.size() && front[i].first < front[i - 1].first,
+                          label + ": entry " + to_string(i) + " is dominated by the one before");
+    return failures;
+}
+
+static FlightFilter allianceFilter(uint16_t alliances, bool allow_codeshare = true) {
+    FlightFilter filter;
+    filter.alliances = alliances;
+    filter.allow_codeshare = allow_codeshare;
+    return filter;
+}
+
+// Five airports. Unfiltered, AAA -> DDD is 6.0 h on one flight, 2.1 h on two (AA, DL) and 1.5 h
+// on three (all AA, the last a codeshare); four flights via EEE are slower still. SkyTeam (DL)
+// alone flies AAA -> BBB -> DDD in 2.6 h; without codeshares the last AA hop must be XX's 1.0 h.
+static size_t fixture() {
+    const string routes_path = "filtered_routes_test_routes.csv";
+    {
+        ofstream r(routes_path);
+        r << "Airline,Airline_ID,Source_airport,Source_airport_ID,Destination_airport,Destination_airport_ID,"
+             "Codeshare,Stops,Equipment,Estimated_Flight_Time_hr\n";
+        const char* routes[][5] = {{"AA", "AAA", "BBB", "", "0.5"}, {"DL", "AAA", "BBB", "", "1.0"},
+                                   {"AA", "BBB", "CCC", "", "0.5"}, {"AA", "CCC", "DDD", "Y", "0.5"},
+                                   {"XX", "CCC", "DDD", "", "1.0"}, {"DL", "BBB", "DDD", "", "1.6"},
+                                   {"XX", "AAA", "DDD", "", "6.0"}, {"XX", "CCC", "EEE", "", "0.5"},
+                                   {"XX", "EEE", "DDD", "", "0.75"}};
+        for (const auto& route : routes)
+            r << route[0] << ",1," << route[1] << ",0," << route[2] << ",0," << route[3] << ",0,738," << route[4]
+              << "\n";
+    }
+    FlightGraph G;
+    const bool loaded = G.loadFromEstimatedCSV(routes_path);
+    remove(routes_path.c_str());
+    if (!loaded)
+        return check(false, "cannot load the fixture");
+
+    const struct {
+        const char* what;
+        FlightFilter filter;
+        int max_flights;
+        double time;
+        vector<string> path;
+    } cases[] = {
+        {"unfiltered", FlightFilter(), 0, 1.5, {"AAA", "BBB", "CCC", "DDD"}},
+        {"--max-stops 0", FlightFilter(), 1, 6.0, {"AAA", "DDD"}},
+        {"--max-stops 1", FlightFilter(), 2, 2.1, {"AAA", "BBB", "DDD"}},
+        {"--max-stops 2", FlightFilter(), 3, 1.5, {"AAA", "BBB", "CCC", "DDD"}},
+        {"--alliance skyteam", allianceFilter(FlightFilter::SKYTEAM), 0, 2.6, {"AAA", "BBB", "DDD"}},
+        {"--alliance skyteam --max-stops 0", allianceFilter(FlightFilter::SKYTEAM), 1, inf, {}},
+        {"--alliance oneworld", allianceFilter(FlightFilter::ONEWORLD), 0, 1.5, {"AAA", "BBB", "CCC", "DDD"}},
+        {"--alliance oneworld --max-stops 1", allianceFilter(FlightFilter::ONEWORLD), 2, inf, {}},
+        {"--alliance star", allianceFilter(FlightFilter::STAR_ALLIANCE), 0, inf, {}},
+        {"--no-codeshare", allianceFilter(FlightFilter::ANY_ALLIANCE, false), 0, 2.0, {"AAA", "BBB", "CCC", "DDD"}},
+        {"--no-codeshare --max-stops 1", allianceFilter(FlightFilter::ANY_ALLIANCE, false), 2, 2.1,
+         {"AAA", "BBB", "DDD"}},
+        {"--alliance oneworld --no-codeshare", allianceFilter(FlightFilter::ONEWORLD, false), 0, inf, {}},
+    };
+    size_t failures = 0;
+    for (const auto& c : cases) {
+        const auto [time, path] = G.constrainedRoute("AAA", "DDD", c.filter, c.max_flights);
+        failures += check((isinf(c.time) ? isinf(time) : sameTime(time, c.time)) && path == c.path,
+                          string(c.what) + ": " + to_string(time) + " h over " + joined(path) + ", expected " +
+                              to_string(c.time) + " h over " + joined(c.path));
+        vector<int> nodes;
+        for (const string& code : path)
+            nodes.push_back(G.findAirportIndexByCode(code));
+        if (!nodes.empty())
+            failures += checkFlights(G, nodes, c.filter, c.what);
+    }
+
+    const int n = G.airports.size(), s = G.findAirportIndexByCode("AAA"), t = G.findAirportIndexByCode("DDD");
+    QueryWorkspace ws;
+    const vector<pair<double, vector<int>>> expected_front = {
+        {6.0, {s, t}}, {2.1, {s, G.findAirportIndexByCode("BBB"), t}},
+        {1.5, {s, G.findAirportIndexByCode("BBB"), G.findAirportIndexByCode("CCC"), t}}};
+    auto sameFront = [](const vector<pair<double, vector<int>>>& a, const vector<pair<double, vector<int>>>& b) {
+        if (a.size() != b.size())
+            return false;
+        for (size_t i = 0; i < a.size(); i++)
+            if (!sameTime(a[i].first, b[i].first) || a[i].second != b[i].second)
+                return false;
+        return true;
+    };
+    const auto front = G.paretoRoutes(s, t, ws);
+    failures += check(sameFront(front, expected_front), "pareto: not the known front");
+    failures += checkFront(front, "pareto");
+    failures += check(sameFront(G.paretoRoutes(s, t, ws, 2), {expected_front[0], expected_front[1]}),
+                      "pareto with 2 flights: not the first two entries of the front");
+    const auto skyteam = G.paretoRoutes(s, t, ws, 0, G.compileFilter(allianceFilter(FlightFilter::SKYTEAM)));
+    failures += check(sameFront(skyteam, {{2.6, expected_front[1].second}}), "pareto over SkyTeam: not (2.6 h, 2)");
+
+    // unfiltered searches between every pair of the fixture
+    QueryWorkspace ref;
+    const FlightMask everything = G.compileFilter(FlightFilter());
+    for (int u = 0; u < n; u++)
+        for (int v = 0; v < n; v++) {
+            const double expected = G.dijkstra(u, v, ref);
+            vector<int> path;
+            const double rounds = G.hopLimitedBellmanFord(u, v, n - 1, ws, path);
+            BinaryHeapQueue queue(ws.heap);
+            const double masked = G.dijkstra(u, v, ws, queue, everything);
+            const string label = G.airports[u].code + " -> " + G.airports[v].code;
+            failures += check(isinf(expected) ? isinf(rounds) && isinf(masked)
+                                              : sameTime(rounds, expected) && sameTime(masked, expected),
+                              label + ": unfiltered searches differ from dijkstra()");
+        }
+    cout << "fixture: " << size(cases) << " constrained routes, 3 fronts, " << n * n << " pairs, " << failures
+         << " failures\n";
+    return failures;
+}
+
+static size_t realData(uint64_t seed, size_t count) {
+    FlightGraph G;
+    if (!G.loadWithSnapshot("data/routes_airports.snapshot", "data/routes_with_estimated_times_plus_33k.csv",
+                            "data/airports.dat")) {
+        cerr << "cannot load data/\n";
+        return 1;
+    }
+    const int n = G.airports.size();
+    mt19937_64 rng(seed);
+    uniform_int_distribution<int> any(0, n - 1);
+    const FlightMask everything = G.compileFilter(FlightFilter());
+    const FlightFilter filters[] = {allianceFilter(FlightFilter::STAR_ALLIANCE),
+                                    allianceFilter(FlightFilter::SKYTEAM, false),
+                                    allianceFilter(FlightFilter::ANY_ALLIANCE, false)};
+    QueryWorkspace ws, ref;
+    size_t failures = 0, fronts = 0, filtered = 0;
+    for (size_t i = 0; i < count;) {
+        const int s = any(rng), t = any(rng);
+        if (s == t || !G.mayReach(s, t))
+            continue;
+        i++;
+        const string label = G.airports[s].code + " -> " + G.airports[t].code;
+        const double expected = G.dijkstra(s, t, ref);
+        vector<int> path;
+        failures += check(sameTime(G.hopLimitedBellmanFord(s, t, n - 1, ws, path), expected) &&
+                              sameTime(G.pathTime(path), expected),
+                          label + ": unlimited rounds differ from dijkstra()");
+        BinaryHeapQueue queue(ws.heap);
+        failures += check(sameTime(G.dijkstra(s, t, ws, queue, everything), expected),
+                          label + ": a mask allowing everything differs from dijkstra()");
+
+        const auto front = G.paretoRoutes(s, t, ws);
+        fronts += front.size();
+        failures += checkFront(front, label);
+        failures += check(!front.empty() && sameTime(front.back().first, expected),
+                          label + ": the front does not end at dijkstra()'s time");
+        for (const auto& [time, nodes] : front)
+            failures += check(sameTime(G.hopLimitedBellmanFord(s, t, (int)nodes.size() - 1, ws, path), time),
+                              label + ": front entry with " + to_string(nodes.size() - 1) +
+                                  " flights is not the fastest with that many");
+
+        for (const FlightFilter& filter : filters) {
+            const auto [time, codes] = G.constrainedRoute(G.airports[s].code, G.airports[t].code, filter);
+            if (isinf(time))
+                continue;
+            filtered++;
+            vector<int> nodes;
+            for (const string& code : codes)
+                nodes.push_back(G.findAirportIndexByCode(code));
+            failures += check(time >= expected - 1e-9, label + ": a filtered route beats dijkstra()");
+            failures += checkFlights(G, nodes, filter, label);
+        }
+    }
+    cout << "routes + airports.dat: " << count << " pairs, " << fronts << " front entries, " << filtered
+         << " filtered routes, " << failures << " failures\n";
+    return failures;
+}
+
+int main(int argc, char** argv) {
+    const uint64_t seed = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1;
+    const size_t failures = fixture() + realData(seed, 100);
+    return failures == 0 ? 0 : 1;
+}
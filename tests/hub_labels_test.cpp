@@ -0,0 +1,60 @@
+// Tests HubLabelIndex on the real data: validate() (distance() and path() against dijkstra() on
+// seeded random pairs) after build() and after a save() / open() round trip, and that open()
+// rejects a file whose sections do not fit the graph while keeping the labels it had.
+// Exits non-zero on any failure.
+
+#include "hub_labels.h"
+#include "test_support.h"
+using namespace std;
+
+int main(int argc, char** argv) {
+    const uint32_t seed = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1;
+    FlightGraph G;
+    if (!G.loadWithSnapshot("data/routes_airports.snapshot", "data/routes_with_estimated_times_plus_33k.csv",
+                            "data/airports.dat")) {
+        cerr << "cannot load data/\n";
+        return 1;
+    }
+    const string path = "hub_labels_test.snapshot", bad_path = "hub_labels_test_bad.snapshot";
+    size_t failures = 0;
+
+    HubLabelIndex built;
+    built.build(G);
+    built.stats.print(cout);
+    const size_t bad_built = built.validate(3000, seed);
+    cout << "built: 3000 pairs, " << bad_built << " mismatches\n";
+    failures += bad_built;
+
+    failures += check(built.save(path), "cannot save " + path);
+    HubLabelIndex opened;
+    failures += check(opened.open(path, G, true), "cannot open " + path);
+    const size_t bad_opened = opened.validate(3000, seed + 1);
+    cout << "opened: 3000 pairs, " << bad_opened << " mismatches\n";
+    failures += bad_opened;
+
+    // every section present and tagged for G, but the order one airport short
+    {
+        SnapshotWriter writer;
+        const uint64_t fp = G.fingerprint();
+        writer.add(SEC_GRAPH_FINGERPRINT, &fp, 1);
+        writer.add(SEC_HL_ORDER, built.order.data(), built.order.size() - 1);
+        writer.add(SEC_HL_OUT_OFFSETS, built.out_offsets.data(), built.out_offsets.size());
+        writer.add(SEC_HL_OUT_HUB, built.out_hub.data(), built.out_hub.size());
+        writer.add(SEC_HL_OUT_DIST, built.out_dist.data(), built.out_dist.size());
+        writer.add(SEC_HL_OUT_NEXT, built.out_next.data(), built.out_next.size());
+        writer.add(SEC_HL_IN_OFFSETS, built.in_offsets.data(), built.in_offsets.size());
+        writer.add(SEC_HL_IN_HUB, built.in_hub.data(), built.in_hub.size());
+        writer.add(SEC_HL_IN_DIST, built.in_dist.data(), built.in_dist.size());
+        writer.add(SEC_HL_IN_PREV, built.in_prev.data(), built.in_prev.size() - 1);
+        failures += check(writer.write(bad_path, SnapshotSourceStamp(), SnapshotSourceStamp()),
+                          "cannot save " + bad_path);
+    }
+    failures += check(!opened.open(bad_path, G), "open() accepted a short order section");
+    const size_t bad_kept = opened.validate(1000, seed + 2);
+    failures += check(bad_kept == 0, "labels changed by a rejected open(): " + to_string(bad_kept) + " mismatches");
+
+    remove(path.c_str());
+    remove(bad_path.c_str());
+    cout << failures << " failures\n";
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,123 @@
+// Tests kShortestPaths() (Yen). On seeded random pairs of the real data the first answer must be
+// dijkstra()'s time, times must not decrease, every path must be a loopless route from source to
+// destination taking the time given, no path may repeat, and 2 and 4 spur threads must return the
+// same list as one. On a small written fixture with every simple path enumerated, the K times
+// must be the K fastest. Exits non-zero on any failure.
+
+#include "graph.h"
+#include "test_support.h"
+#include <random>
+#include <set>
+using namespace std;
+
+using Ranked = vector<pair<double, vector<int>>>;
+
+// Properties every answer list must have; returns the number of failures
+static size_t checkList(const FlightGraph& G, int s, int t, const Ranked& ranked, const string& label) {
+    size_t failures = 0;
+    set<vector<int>> seen;
+    for (size_t i = 0; i < ranked.size(); i++) {
+        const auto& [time, path] = ranked[i];
+        const string at = label + " #" + to_string(i);
+        failures += check(!path.empty() && path.front() == s && path.back() == t, at + ": wrong ends");
+        failures += check(set<int>(path.begin(), path.end()).size() == path.size(), at + ": path has a loop");
+        failures += check(seen.insert(path).second, at + ": path repeated");
+        failures += check(sameTime(G.pathTime(path), time), at + ": time is not the sum of its routes");
+        failures += check(i == 0 || ranked[i - 1].first <= time, at + ": faster than the one before");
+    }
+    return failures;
+}
+
+static size_t realData(uint64_t seed, size_t count, int K) {
+    FlightGraph G;
+    if (!G.loadWithSnapshot("data/routes_airports.snapshot", "data/routes_with_estimated_times_plus_33k.csv",
+                            "data/airports.dat")) {
+        cerr << "cannot load data/\n";
+        return 1;
+    }
+    mt19937_64 rng(seed);
+    uniform_int_distribution<int> any(0, (int)G.airports.size() - 1);
+    QueryWorkspace ref;
+    KspWorkspace ws;
+    size_t failures = 0, answers = 0;
+    for (size_t i = 0; i < count;) {
+        const int s = any(rng), t = any(rng);
+        if (s == t || !G.mayReach(s, t))
+            continue;
+        i++;
+        const string label = G.airports[s].code + " -> " + G.airports[t].code;
+        const double expected = G.dijkstra(s, t, ref);
+        const Ranked one = G.kShortestPaths(s, t, K, ws, 1);
+        answers += one.size();
+        failures += check(!one.empty() && sameTime(one[0].first, expected), label + ": first time is not dijkstra's");
+        failures += check((int)one.size() <= K, label + ": more than K paths");
+        failures += checkList(G, s, t, one, label);
+        for (int threads : {2, 4})
+            failures += check(G.kShortestPaths(s, t, K, ws, threads) == one,
+                              label + ": " + to_string(threads) + " threads give another list");
+    }
+    cout << "routes + airports.dat: " << count << " pairs, " << answers << " paths, " << failures << " failures\n";
+    return failures;
+}
+
+// Every simple path s -> t with its time, by depth-first search
+static void allPaths(const FlightGraph& G, int u, int t, vector<int>& path, vector<double>& times) {
+    if (u == t) {
+        times.push_back(G.pathTime(path));
+        return;
+    }
+    for (uint32_t r = G.fwd_offsets[u]; r < G.fwd_offsets[u + 1]; r++) {
+        const int v = G.fwd_dest[r];
+        if (find(path.begin(), path.end(), v) != path.end())
+            continue;
+        path.push_back(v);
+        allPaths(G, v, t, path, times);
+        path.pop_back();
+    }
+}
+
+// Six airports with many ways from AAA to FFF, including equally fast ones
+static size_t fixture(int K) {
+    const string routes_path = "k_shortest_paths_test_routes.csv";
+    {
+        ofstream r(routes_path);
+        r << "Airline,Airline_ID,Source_airport,Source_airport_ID,Destination_airport,Destination_airport_ID,"
+             "Codeshare,Stops,Equipment,Estimated_Flight_Time_hr\n";
+        const char* routes[][3] = {{"AAA", "BBB", "1.0"}, {"AAA", "CCC", "2.0"}, {"BBB", "CCC", "1.0"},
+                                   {"CCC", "BBB", "0.5"}, {"BBB", "DDD", "2.0"}, {"CCC", "DDD", "1.0"},
+                                   {"CCC", "EEE", "2.5"}, {"DDD", "EEE", "0.5"}, {"DDD", "FFF", "3.0"},
+                                   {"EEE", "FFF", "1.0"}, {"BBB", "FFF", "5.0"}, {"EEE", "BBB", "0.5"}};
+        for (const auto& route : routes)
+            r << "XX,1," << route[0] << ",0," << route[1] << ",0,,0,738," << route[2] << "\n";
+    }
+    FlightGraph G;
+    const bool loaded = G.loadFromEstimatedCSV(routes_path);
+    remove(routes_path.c_str());
+    if (!loaded)
+        return check(false, "cannot load the fixture");
+    const int s = G.findAirportIndexByCode("AAA"), t = G.findAirportIndexByCode("FFF");
+    vector<int> path = {s};
+    vector<double> times;
+    allPaths(G, s, t, path, times);
+    sort(times.begin(), times.end());
+
+    KspWorkspace ws;
+    const Ranked ranked = G.kShortestPaths(s, t, K, ws, 1);
+    size_t failures = checkList(G, s, t, ranked, "fixture");
+    failures += check(ranked.size() == min<size_t>(K, times.size()), "fixture: expected " +
+                      to_string(min<size_t>(K, times.size())) + " paths, got " + to_string(ranked.size()));
+    for (size_t i = 0; i < ranked.size() && i < times.size(); i++)
+        failures += check(sameTime(ranked[i].first, times[i]), "fixture #" + to_string(i) + ": " +
+                          to_string(ranked[i].first) + " h, the " + to_string(i + 1) + ". fastest is " +
+                          to_string(times[i]) + " h");
+    failures += check(G.kShortestPaths(s, t, K, ws, 3) == ranked, "fixture: 3 threads give another list");
+    cout << "fixture: " << times.size() << " simple paths, " << ranked.size() << " returned, " << failures
+         << " failures\n";
+    return failures;
+}
+
+int main(int argc, char** argv) {
+    const uint64_t seed = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1;
+    const size_t failures = fixture(8) + fixture(100) + realData(seed, 60, 6);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,57 @@
+// Differential test: dijkstra() on every priority-queue policy must return the same fastest times
+// as on the default binary heap, over seeded random pairs of the real data. One bucket queue is
+// given a far too short span and one an infinite span, so their rings have to grow. Exits
+// non-zero on any mismatch.
+
+#include "graph.h"
+#include "test_support.h"
+#include <random>
+using namespace std;
+
+template <class Queue>
+static size_t compare(const FlightGraph& G, const vector<pair<int, int>>& pairs, Queue& queue, const string& label) {
+    QueryWorkspace ws, ref;
+    size_t mismatches = 0;
+    for (auto [s, t] : pairs) {
+        const double expected = G.dijkstra(s, t, ref);
+        const double got = G.dijkstra(s, t, ws, queue);
+        if (!sameTime(got, expected) && mismatches++ < 10)
+            cerr << label << ": " << G.airports[s].code << " -> " << G.airports[t].code << " " << got << " binary heap "
+                 << expected << "\n";
+    }
+    cout << label << ": " << pairs.size() << " pairs, " << mismatches << " mismatches\n";
+    return mismatches;
+}
+
+int main(int argc, char** argv) {
+    const uint64_t seed = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1;
+    FlightGraph G;
+    if (!G.loadWithSnapshot("data/routes_airports.snapshot", "data/routes_with_estimated_times_plus_33k.csv",
+                            "data/airports.dat")) {
+        cerr << "cannot load data/\n";
+        return 1;
+    }
+    mt19937_64 rng(seed);
+    uniform_int_distribution<int> any(0, (int)G.airports.size() - 1);
+    vector<pair<int, int>> pairs;
+    while (pairs.size() < 1500) {
+        const int s = any(rng), t = any(rng);
+        if (G.mayReach(s, t))
+            pairs.push_back({s, t});
+    }
+
+    const auto [shortest, longest] = G.flightTimeRange();
+    QuaternaryHeapQueue quaternary;
+    RadixHeapQueue radix;
+    BucketQueue buckets(shortest, longest), minutes(1.0 / 60, longest), small_ring(1.0 / 60, 0.1);
+    BucketQueue no_span(1.0 / 60, numeric_limits<double>::infinity());
+    size_t mismatches = compare(G, pairs, quaternary, "quaternary") + compare(G, pairs, radix, "radix") +
+                        compare(G, pairs, buckets, "bucket") + compare(G, pairs, minutes, "minutes") +
+                        compare(G, pairs, small_ring, "growing ring") + compare(G, pairs, no_span, "unknown span");
+
+    // zero-hour flights or no flights at all give no usable width
+    mismatches += check(!BucketQueue::validWidth(0.0) && !BucketQueue::validWidth(numeric_limits<double>::infinity()) &&
+                            !BucketQueue::validWidth(-1.0) && BucketQueue::validWidth(shortest),
+                        "BucketQueue::validWidth");
+    return mismatches == 0 ? 0 : 1;
+}
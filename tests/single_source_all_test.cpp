@@ -0,0 +1,50 @@
+// Tests singleSourceAll() (parallel delta-stepping) on the real data: from seeded random sources,
+// distances and parents to every airport must equal a full dijkstra() on 1, 2 and 4 threads, with
+// the default bucket width and with one much narrower and one much wider. Exits non-zero on any
+// mismatch.
+
+#include "graph.h"
+#include "test_support.h"
+#include <random>
+using namespace std;
+
+int main(int argc, char** argv) {
+    const uint64_t seed = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1;
+    FlightGraph G;
+    if (!G.loadWithSnapshot("data/routes_airports.snapshot", "data/routes_with_estimated_times_plus_33k.csv",
+                            "data/airports.dat")) {
+        cerr << "cannot load data/\n";
+        return 1;
+    }
+    const int n = G.airports.size();
+    mt19937_64 rng(seed);
+    uniform_int_distribution<int> any(0, n - 1);
+    const double default_delta = G.deltaSteppingWidth();
+    cout << "default delta " << default_delta << " h\n";
+
+    QueryWorkspace ws;
+    size_t failures = 0;
+    for (int i = 0; i < 40; i++) {
+        const int s = any(rng);
+        G.dijkstra(s, -1, ws);
+        for (int threads : {1, 2, 4}) {
+            for (double delta : {0.0, default_delta / 8, default_delta * 8}) {
+                const ShortestPathTree tree = G.singleSourceAll(s, threads, delta);
+                size_t dist_wrong = 0, parent_wrong = 0;
+                for (int v = 0; v < n; v++) {
+                    dist_wrong += !(tree.dist[v] == ws.dist(v));
+                    parent_wrong += tree.parent[v] != ws.parent(v);
+                }
+                failures += check(tree.source == s && dist_wrong == 0 && parent_wrong == 0,
+                                  G.airports[s].code + " on " + to_string(threads) + " threads, delta " +
+                                      to_string(delta) + ": " + to_string(dist_wrong) + " distances and " +
+                                      to_string(parent_wrong) + " parents differ");
+            }
+        }
+    }
+    const ShortestPathTree outside = G.singleSourceAll(n, 2);
+    failures += check(outside.source == n && count(outside.dist.begin(), outside.dist.end(), 0.0) == 0,
+                      "a source outside the graph reached something");
+    cout << "40 sources x 3 thread counts x 3 widths, " << failures << " failures\n";
+    return failures == 0 ? 0 : 1;
+}
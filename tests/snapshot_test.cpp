@@ -0,0 +1,146 @@
+// Tests snapshot loading on small written snapshots. SnapshotReader::open() must accept a file as
+// written and reject a section whose count * elem_size wraps around 64 bits to something that
+// fits, even with a correct header checksum. FlightGraph::openSnapshot() must keep airport codes
+// longer than the fixed record, and reject (leaving the graph as it was) a payload whose columns
+// do not fit together: the payload checksum is off by default, so only these checks stand
+// between a corrupt file and out-of-bounds reads. Exits non-zero on any failure.
+
+#include "graph.h"
+#include "test_support.h"
+using namespace std;
+
+static string readFile(const string& path) {
+    ifstream in(path, ios::binary);
+    return string(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+}
+
+static bool writeFile(const string& path, const string& bytes) {
+    ofstream out(path, ios::binary | ios::trunc);
+    out.write(bytes.data(), bytes.size());
+    return (bool)out;
+}
+
+// Byte offset and element count of section id in a snapshot image, {0, 0} if it is missing
+static pair<size_t, size_t> findSection(const string& file, uint32_t id) {
+    SnapshotHeader header;
+    memcpy(&header, file.data(), sizeof(header));
+    for (uint32_t i = 0; i < header.section_count; i++) {
+        SnapshotSection section;
+        memcpy(&section, file.data() + sizeof(header) + i * sizeof(section), sizeof(section));
+        if (section.id == id)
+            return {section.offset, section.count};
+    }
+    return {0, 0};
+}
+
+template <class T>
+static void poke(string& file, uint32_t id, size_t index, T value) {
+    memcpy(&file[findSection(file, id).first + index * sizeof(T)], &value, sizeof(T));
+}
+
+static size_t readerBounds() {
+    const string path = "snapshot_test.snapshot";
+    const uint64_t values[4] = {1, 2, 3, 4};
+    SnapshotWriter writer;
+    writer.add(1, values, 4);
+    if (!writer.write(path, SnapshotSourceStamp(), SnapshotSourceStamp()))
+        return check(false, "cannot write " + path);
+    string file = readFile(path);
+    remove(path.c_str());
+    size_t failures = 0;
+
+    SnapshotReader reader;
+    failures += check(reader.open(file.data(), file.size(), true), "written snapshot rejected");
+    size_t count = 0;
+    const uint64_t* got = reader.get<uint64_t>(1, count);
+    failures += check(got && count == 4 && got[3] == 4, "section 1 not read back");
+
+    // 2^61 + 1 elements of 8 bytes: the product wraps to 8 bytes
+    SnapshotHeader header;
+    SnapshotSection section;
+    memcpy(&header, file.data(), sizeof(header));
+    memcpy(&section, file.data() + sizeof(header), sizeof(section));
+    section.count = (1ULL << 61) + 1;
+    memcpy(&file[sizeof(header)], &section, sizeof(section));
+    string head = file.substr(0, section.offset);
+    header.header_checksum = 0;
+    memcpy(&head[0], &header, sizeof(header));
+    header.header_checksum = snapshotChecksum(head.data(), head.size());
+    memcpy(&file[0], &header, sizeof(header));
+    failures += check(!reader.open(file.data(), file.size(), false), "wrapping section count accepted");
+    cout << "reader bounds: " << failures << " failures\n";
+    return failures;
+}
+
+// AAA -> BBB -> LONGCODE1 -> AAA
+static size_t graphColumns() {
+    const string routes_path = "snapshot_test_routes.csv", path = "snapshot_test_graph.snapshot";
+    const string bad_path = "snapshot_test_bad.snapshot";
+    {
+        ofstream r(routes_path);
+        r << "Airline,Airline_ID,Source_airport,Source_airport_ID,Destination_airport,Destination_airport_ID,"
+             "Codeshare,Stops,Equipment,Estimated_Flight_Time_hr\n"
+          << "XX,1,AAA,1,BBB,2,,0,738,1.0\n"
+          << "XX,1,BBB,2,LONGCODE1,3,,0,738,1.0\n"
+          << "XX,1,LONGCODE1,3,AAA,1,,0,738,1.0\n";
+    }
+    FlightGraph built;
+    if (!built.loadFromEstimatedCSV(routes_path) || !built.saveSnapshot(path, routes_path)) {
+        remove(routes_path.c_str());
+        return check(false, "cannot build the fixture snapshot");
+    }
+    const string good = readFile(path);
+    size_t failures = 0;
+
+    FlightGraph G;
+    failures += check(G.openSnapshot(path, routes_path), "written graph snapshot rejected");
+    failures += check(G.findAirportIndexByCode("LONGCODE1") >= 0 && G.findAirportIndexByCode("LONGCODE") < 0,
+                      "long airport code not kept");
+    const int a = G.findAirportIndexByCode("AAA"), b = G.findAirportIndexByCode("BBB");
+    QueryWorkspace ws;
+    failures += check(G.dijkstra(b, a, ws) == 2.0, "BBB -> AAA through LONGCODE1");
+
+    const size_t n = G.airports.size(), routes = G.routeCount();
+    const struct {
+        const char* what;
+        function<void(string&)> corrupt;
+    } cases[] = {
+        {"non-monotone route offsets", [&](string& f) { poke<uint32_t>(f, SEC_FWD_OFFSETS, 1, (uint32_t)routes); }},
+        {"route offsets past the routes", [&](string& f) { poke<uint32_t>(f, SEC_FWD_OFFSETS, n, routes + 1); }},
+        {"flight offsets short of the flights", [&](string& f) { poke<uint32_t>(f, SEC_EDGE_OFFSETS, n, 1); }},
+        {"route destination out of range", [&](string& f) { poke<int>(f, SEC_FWD_DEST, 0, (int)n); }},
+        {"reverse source out of range", [&](string& f) { poke<int>(f, SEC_REV_SRC, 0, -1); }},
+        {"code table without an empty slot", [&](string& f) {
+             for (size_t slot = 0; slot < findSection(f, SEC_CODE_KEYS).second; slot++)
+                 poke<uint32_t>(f, SEC_CODE_KEYS, slot, 0x00414141 + (uint32_t)slot);
+         }},
+        {"code value out of range", [&](string& f) {
+             for (size_t slot = 0; slot < findSection(f, SEC_CODE_VALUES).second; slot++)
+                 poke<int>(f, SEC_CODE_VALUES, slot, (int)n);
+         }},
+        {"component id out of range", [&](string& f) { poke<int>(f, SEC_SCC_ID, 0, 1 << 20); }},
+    };
+    for (const auto& c : cases) {
+        // G maps path, so the corrupt copies go to a file of their own
+        string bad = good;
+        c.corrupt(bad);
+        remove(bad_path.c_str());
+        if (!writeFile(bad_path, bad)) {
+            failures += check(false, "cannot write " + bad_path);
+            continue;
+        }
+        failures += check(!G.openSnapshot(bad_path, routes_path), string("accepted ") + c.what);
+        failures += check(G.findAirportIndexByCode("AAA") == a && G.dijkstra(b, a, ws) == 2.0,
+                          string("graph changed by a rejected snapshot: ") + c.what);
+    }
+    remove(path.c_str());
+    remove(bad_path.c_str());
+    remove(routes_path.c_str());
+    cout << "graph columns: " << size(cases) << " corruptions, " << failures << " failures\n";
+    return failures;
+}
+
+int main() {
+    const size_t failures = readerBounds() + graphColumns();
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,202 @@
+// Tests SptCache::repair() on the real data. Before each update the cache is warmed with seeded
+// queries, so its searches stop part way; after applyUpdates() + repair() every cached source must
+// give the distances of a fresh dijkstra() to every airport, and paths that are real routes of
+// that time (a repaired search may keep another of several equally fast paths). Updates: a tree
+// route made slower, a tree route removed, a route off the tree made faster, a new airport, and
+// a slower route that most of a search hangs from, which repair() must restart rather than
+// patch. Exits non-zero on any failure.
+
+#include "spt_cache.h"
+#include "test_support.h"
+#include <random>
+#include <set>
+using namespace std;
+
+static FlightUpdate update(FlightUpdate::Kind kind, const string& from, const string& to, const string& airline,
+                           double hours = numeric_limits<double>::quiet_NaN()) {
+    FlightUpdate up;
+    up.kind = kind;
+    up.source = from;
+    up.destination = to;
+    up.airline = airline;
+    up.est_time_hr = hours;
+    return up;
+}
+
+// One update per airline flying u -> v (RETIME and REMOVE match every flight of the airline)
+static vector<FlightUpdate> everyFlight(const FlightGraph& G, int u, int v, FlightUpdate::Kind kind, double hours) {
+    set<string> airlines;
+    for (uint32_t e = G.edge_offsets[u]; e < G.edge_offsets[u + 1]; e++)
+        if (G.edge_dest[e] == v)
+            airlines.insert(G.airline_names.name(G.edge_airline[e]));
+    vector<FlightUpdate> batch;
+    for (const string& airline : airlines)
+        batch.push_back(update(kind, G.airports[u].code, G.airports[v].code, airline, hours));
+    return batch;
+}
+
+struct Fixture {
+    FlightGraph& G;
+    SptCache& cache;
+    vector<int> sources;
+    mt19937_64 rng;
+    vector<pair<int, int>> settle;      // (source, airport) pairs the next warm() must settle
+
+    // Fresh entries for every source, each stopped after a few random destinations
+    void warm() {
+        cache.clear();
+        uniform_int_distribution<int> any(0, (int)G.airports.size() - 1);
+        for (int s : sources)
+            for (int i = 0; i < 20; i++)
+                cache.distance(s, any(rng));
+        for (auto [s, t] : settle)
+            cache.distance(s, t);
+    }
+
+    // Every cached source against dijkstra(); returns the number of failures
+    size_t verify(const string& label) {
+        QueryWorkspace ws;
+        size_t wrong_dist = 0, wrong_path = 0, ties = 0;
+        for (int s : sources) {
+            G.dijkstra(s, -1, ws);
+            for (int t = 0; t < (int)G.airports.size(); t++) {
+                const double expected = ws.dist(t);
+                const double got = cache.distance(s, t);
+                if (!(isinf(expected) ? isinf(got) : sameTime(got, expected))) {
+                    if (wrong_dist++ < 5)
+                        cerr << label << ": " << G.airports[s].code << " -> " << G.airports[t].code << " cache "
+                             << got << " dijkstra " << expected << "\n";
+                    continue;
+                }
+                if (isinf(expected) || t % 7 != 0)
+                    continue;
+                const vector<int> path = cache.path(s, t);
+                vector<int> reference;
+                for (int v = t; v != -1; v = ws.parent(v))
+                    reference.push_back(v);
+                reverse(reference.begin(), reference.end());
+                if (path == reference)
+                    continue;
+                ties++;
+                if (path.empty() || path.front() != s || path.back() != t || !sameTime(G.pathTime(path), expected))
+                    wrong_path++;
+            }
+        }
+        cout << label << ": " << sources.size() << " sources, " << wrong_dist << " wrong distances, " << wrong_path
+             << " wrong paths, " << ties << " equally fast ties\n";
+        return wrong_dist + wrong_path;
+    }
+
+    // Applies the batch, repairs the warmed cache and checks it; expect_restart says whether the
+    // repair must restart a search (true) or patch them all (false)
+    size_t apply(const string& label, const vector<FlightUpdate>& batch, bool expect_restart) {
+        warm();
+        const UpdateReport report = G.applyUpdates(batch);
+        size_t failures = check(report.applied == batch.size() && !report.routes.empty(),
+                                label + ": update not applied");
+        const SptCacheStats before = cache.stats();
+        cache.repair(report.routes);
+        const SptCacheStats after = cache.stats();
+        failures += check((after.restarts > before.restarts) == expect_restart,
+                          label + (expect_restart ? ": no search restarted" : ": a search was restarted"));
+        return failures + verify(label);
+    }
+};
+
+int main(int argc, char** argv) {
+    const uint64_t seed = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1;
+    FlightGraph G;
+    if (!G.loadWithSnapshot("data/routes_airports.snapshot", "data/routes_with_estimated_times_plus_33k.csv",
+                            "data/airports.dat")) {
+        cerr << "cannot load data/\n";
+        return 1;
+    }
+    SptCache cache(G);
+    Fixture fx{G, cache, {}, mt19937_64(seed)};
+
+    // sources in the largest component, the busiest hub among them
+    const int hub = G.findAirportIndexByCode("ATL");
+    uniform_int_distribution<int> any(0, (int)G.airports.size() - 1);
+    while (fx.sources.size() < 8) {
+        const int s = any(fx.rng);
+        if (s != hub && G.mayReach(s, hub) && G.mayReach(hub, s))
+            fx.sources.push_back(s);
+    }
+    const int s0 = fx.sources[0];
+    QueryWorkspace ws;
+    size_t failures = 0;
+
+    // the tree route into an airport of s0's search, settled before the update, that is not the
+    // first hop and has other routes in: a small subtree to unsettle and re-seed
+    auto treeRoute = [&](int skip) {
+        G.dijkstra(s0, -1, ws);
+        for (int t = 0; t < (int)G.airports.size(); t++) {
+            const int u = ws.parent(t);
+            if (t == skip || u < 0 || u == s0 || G.rev_offsets[t + 1] - G.rev_offsets[t] < 3)
+                continue;
+            return pair<int, int>(u, t);
+        }
+        return pair<int, int>(-1, -1);
+    };
+    const auto [u1, v1] = treeRoute(-1);
+    const auto [u2, v2] = treeRoute(v1);
+    if (u1 < 0 || u2 < 0)
+        return check(false, "no tree routes to change");
+    fx.settle = {{s0, v1}};
+    failures += fx.apply("slower tree route", everyFlight(G, u1, v1, FlightUpdate::RETIME, G.routeTime(u1, v1) + 3.0),
+                         false);
+    fx.settle = {{s0, v2}};
+    failures += fx.apply("removed tree route", everyFlight(G, u2, v2, FlightUpdate::REMOVE, 0.0), false);
+
+    // a route off s0's tree into a leaf of it, made fast enough to win by a quarter hour
+    G.dijkstra(s0, -1, ws);
+    vector<uint8_t> has_child(G.airports.size(), 0);
+    for (int v = 0; v < (int)G.airports.size(); v++)
+        if (ws.parent(v) >= 0)
+            has_child[ws.parent(v)] = 1;
+    int fu = -1, fv = -1;
+    for (int u = 0; u < (int)G.airports.size() && fu < 0; u++)
+        for (uint32_t r = G.fwd_offsets[u]; r < G.fwd_offsets[u + 1]; r++) {
+            const int v = G.fwd_dest[r];
+            if (ws.parent(v) != u && !has_child[v] && ws.dist(v) - ws.dist(u) > 1.0) {
+                fu = u, fv = v;
+                break;
+            }
+        }
+    if (fu < 0)
+        return failures + check(false, "no route off the tree to speed up");
+    const double faster = ws.dist(fv) - ws.dist(fu) - 0.25;
+    fx.settle = {{s0, fu}};
+    failures += fx.apply("faster route off the tree", everyFlight(G, fu, fv, FlightUpdate::RETIME, faster), false);
+
+    // a new airport one short hop from s0, flying on to a distant airport
+    int far = s0;
+    fx.settle.clear();
+    G.dijkstra(s0, -1, ws);
+    for (int v = 0; v < (int)G.airports.size(); v++)
+        if (!isinf(ws.dist(v)) && ws.dist(v) > ws.dist(far))
+            far = v;
+    failures += fx.apply("new airport",
+                         {update(FlightUpdate::ADD, G.airports[s0].code, "QX1", "XX", 0.2),
+                          update(FlightUpdate::ADD, "QX1", G.airports[far].code, "XX", 0.2)},
+                         false);
+
+    // a source with a single route out, whose search has settled everything: slowing that route
+    // unsettles the whole tree, so repair() must search again rather than patch
+    int single = -1;
+    for (int v = 0; v < (int)G.airports.size() && single < 0; v++)
+        if (G.fwd_offsets[v + 1] - G.fwd_offsets[v] == 1 && G.mayReach(v, hub) && G.mayReach(hub, v))
+            single = v;
+    if (single < 0)
+        return failures + check(false, "no airport with a single route out");
+    const int next = G.fwd_dest[G.fwd_offsets[single]];
+    fx.sources = {single};
+    fx.settle.clear();
+    for (int t = 0; t < (int)G.airports.size(); t++)
+        fx.settle.push_back({single, t});
+    failures += fx.apply("slower only route out",
+                         everyFlight(G, single, next, FlightUpdate::RETIME, G.routeTime(single, next) + 3.0), true);
+
+    cout << failures << " failures\n";
+    return failures == 0 ? 0 : 1;
+}
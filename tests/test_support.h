@@ -0,0 +1,20 @@
+#pragma once
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <algorithm>
+
+// Helpers shared by the test executables in tests/
+
+// Reports what failed on stderr; returns the number of failures (0 or 1) to add to a total
+static size_t check(bool ok, const std::string& what) {
+    if (ok)
+        return 0;
+    std::cerr << what << "\n";
+    return 1;
+}
+
+// Fastest times summed along different, equally fast paths may round differently
+static bool sameTime(double a, double b) {
+    return a == b || std::fabs(a - b) <= 1e-9 * std::max(1.0, std::fabs(b));
+}
@@ -0,0 +1,108 @@
+// Tests Timetable on small written fixtures: a generated schedule must not depend on the order of
+// the route file, and a loaded schedule may fly pairs the graph has no route for, which queries
+// must still find. Exits non-zero on any failure.
+
+#include "timetable.h"
+#include "test_support.h"
+using namespace std;
+
+static const char* HEADER = "Airline,Airline_ID,Source_airport,Source_airport_ID,Destination_airport,"
+                            "Destination_airport_ID,Codeshare,Stops,Equipment,Estimated_Flight_Time_hr\n";
+
+static bool loadRoutes(FlightGraph& G, const string& path, const vector<string>& rows) {
+    {
+        ofstream r(path);
+        r << HEADER;
+        for (const string& row : rows)
+            r << row << "\n";
+    }
+    const bool loaded = G.loadFromEstimatedCSV(path);
+    remove(path.c_str());
+    return loaded;
+}
+
+// Day 0 as sorted "FROM TO AIRLINE HH:MM duration" lines
+static vector<string> daySchedule(const Timetable& T, const FlightGraph& G) {
+    vector<string> lines;
+    for (size_t i = 0; i < T.connections.size(); i++) {
+        const Connection& c = T.connections[i];
+        if (c.departure >= Timetable::MINUTES_PER_DAY)
+            continue;
+        const int airline = T.connection_airline[i];
+        lines.push_back(G.airports[c.from].code + " " + G.airports[c.to].code + " " +
+                        (airline < 0 ? string() : G.airline_names.name(airline)) + " " +
+                        Timetable::clockString(c.departure) + " " + to_string(c.arrival - c.departure));
+    }
+    sort(lines.begin(), lines.end());
+    return lines;
+}
+
+static size_t generatedOrder() {
+    const vector<string> rows = {
+        "XX,1,AAA,1,BBB,2,,0,738,1.5", "XX,1,BBB,2,AAA,1,,0,738,1.5", "YY,2,AAA,1,BBB,2,,0,320,1.75",
+        "XX,1,BBB,2,CCC,3,,0,738,2.0", "YY,2,CCC,3,DDD,4,,0,320,0.5", "XX,1,DDD,4,AAA,1,,0,738,4.25",
+    };
+    vector<string> reordered(rows.rbegin(), rows.rend());
+    reordered.push_back("ZZ,3,EEE,5,AAA,1,,0,320,3.0");     // one more flight elsewhere
+    FlightGraph G1, G2;
+    if (!loadRoutes(G1, "timetable_test_routes.csv", rows) || !loadRoutes(G2, "timetable_test_routes.csv", reordered))
+        return check(false, "cannot load the route fixtures");
+
+    TimetableOptions options;
+    options.seed = 7;
+    Timetable T1, T2;
+    T1.generate(G1, options);
+    T2.generate(G2, options);
+    vector<string> a = daySchedule(T1, G1), b = daySchedule(T2, G2);
+    // drop the extra flight's departures from the second schedule
+    b.erase(remove_if(b.begin(), b.end(), [](const string& line) { return line.rfind("EEE ", 0) == 0; }), b.end());
+    size_t failures = check(a == b, "generated departures depend on the order of the route file");
+
+    options.seed = 8;
+    Timetable T3;
+    T3.generate(G1, options);
+    failures += check(daySchedule(T3, G1) != a, "generated departures do not depend on the seed");
+    cout << "generated: " << a.size() << " daily departures, " << failures << " failures\n";
+    return failures;
+}
+
+// The graph only flies AAA -> BBB -> CCC; the schedule adds CCC -> AAA
+static size_t loadedOffGraph() {
+    FlightGraph G;
+    if (!loadRoutes(G, "timetable_test_routes.csv", {"XX,1,AAA,1,BBB,2,,0,738,1.0", "XX,1,BBB,2,CCC,3,,0,738,1.0"}))
+        return check(false, "cannot load the route fixture");
+    const string schedule_path = "timetable_test_schedule.csv";
+    {
+        ofstream out(schedule_path);
+        out << "Source,Destination,Airline,Departure,Duration\n"
+            << "AAA,BBB,XX,08:00,60\n"
+            << "BBB,CCC,XX,10:00,60\n"
+            << "CCC,AAA,XX,12:00,90\n"
+            << "CCC,AAA,XX,15:00,90\n";
+    }
+    Timetable T;
+    const bool loaded = T.loadSchedule(G, schedule_path);
+    remove(schedule_path.c_str());
+    if (!loaded)
+        return check(false, "cannot load the schedule");
+    const int a = G.findAirportIndexByCode("AAA"), b = G.findAirportIndexByCode("BBB");
+    const int c = G.findAirportIndexByCode("CCC");
+
+    size_t failures = check(T.stats.off_graph == 2, "expected 2 off-graph rows, got " + to_string(T.stats.off_graph));
+    failures += check(!G.mayReach(c, a), "fixture: the graph should not reach AAA from CCC");
+    QueryWorkspace ws;
+    const Journey back = T.earliestArrival(c, a, 11 * 60, ws);
+    failures += check(back.arrival == 12 * 60 + 90 && back.legs.size() == 1, "CCC -> AAA not found");
+    const Journey round = T.earliestArrival(b, a, 9 * 60, ws);
+    failures += check(round.arrival == 12 * 60 + 90 && round.legs.size() == 2, "BBB -> CCC -> AAA not found");
+    const vector<pair<int, int>> departures = T.profile(c, a, 0, Timetable::MINUTES_PER_DAY - 1);
+    failures += check(departures.size() == 2 && departures[0] == make_pair(12 * 60, 12 * 60 + 90),
+                      "CCC -> AAA profile incomplete");
+    cout << "loaded off graph: " << failures << " failures\n";
+    return failures;
+}
+
+int main() {
+    const size_t failures = generatedOrder() + loadedOffGraph();
+    return failures == 0 ? 0 : 1;
+}
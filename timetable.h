@@ -0,0 +1,360 @@
+#pragma once
+#include "graph.h"
+
+// One scheduled flight. Times are minutes since 00:00 of day 0 on a single clock (time zones
+// are not modelled, like the est_time_hr durations they come from).
+struct Connection {
+    uint32_t departure;
+    uint32_t arrival;
+    int from;
+    int to;
+};
+
+// How Timetable::generate() invents a schedule and how far it is expanded
+struct TimetableOptions {
+    uint64_t seed = 1;
+    int max_daily = 3;                  // departures per day of a flight: 1..max_daily, by hash
+    int first_departure = 6 * 60;       // daily departure window, minutes after midnight
+    int last_departure = 22 * 60;
+    int days = 2;                       // the daily schedule is repeated this many days
+    int min_connection = 45;            // default minimum connection time at every airport
+};
+
+// Earliest-arrival answer of Timetable::earliestArrival(); departure/arrival are -1 if the
+// destination cannot be reached
+struct Journey {
+    int departure = -1;
+    int arrival = -1;
+    vector<uint32_t> legs;              // indices into Timetable::connections, in travel order
+};
+
+// Build statistics of a Timetable
+struct TimetableStats {
+    double build_ms = 0;
+    size_t daily = 0;                   // connections in one day of the schedule
+    size_t connections = 0;             // after expanding over all days
+    size_t skipped = 0;                 // schedule rows naming an unknown airport or a bad time
+    size_t off_graph = 0;               // loaded rows on an airport pair the graph has no route for
+
+    void print(ostream& out) const {
+        out << fixed << setprecision(2)
+            << "timetable: " << daily << " daily departures, " << connections << " connections in "
+            << build_ms << " ms | skipped " << skipped << " | off graph " << off_graph << "\n";
+    }
+};
+
+// Time-dependent routing over a daily schedule layered on a FlightGraph, answered with the
+// Connection Scan Algorithm (Dibbelt et al.).
+//
+// The schedule is either invented from the route file (generate(): every usable flight departs
+// 1..max_daily times a day inside the departure window, at pseudo-random minutes hashed from the
+// seed and the flight's airports, airline and duration, and takes its est_time_hr; a flight keeps
+// its departures when others are added or the route file is reordered) or read from a CSV file in the format saveSchedule() writes, so a
+// generated schedule can be saved, edited and loaded again. It is repeated over `days` days and
+// stored as one flat array of 16-byte connections sorted by departure, which every query streams
+// through in order.
+//
+// Each airport has a minimum connection time: a departure can be taken only that long after
+// arriving (not at the origin). Queries keep their per-airport state in a QueryWorkspace (dist =
+// the time from which a departure can be taken, parent = the connection that got there), so a
+// query touches only the airports it reaches. Like LandmarkIndex, it keeps a pointer to its graph.
+class Timetable {
+public:
+    vector<Connection> connections;     // sorted by (departure, arrival)
+    vector<int> connection_airline;     // per connection, id into the graph's airline_names (-1 if unknown)
+    vector<uint16_t> min_connection;    // per airport, minutes
+    TimetableStats stats;
+
+    void generate(const FlightGraph& G, const TimetableOptions& options = TimetableOptions()) {
+        auto start = chrono::steady_clock::now();
+        begin(G, options);
+        const int window = max(0, options.last_departure - options.first_departure);
+        const int max_daily = max(1, options.max_daily);
+        for (int u = 0; u < (int)G.airports.size(); u++) {
+            for (uint32_t e = G.edge_offsets[u]; e < G.edge_offsets[u + 1]; e++) {
+                if (std::isinf(G.edge_weight[e]))
+                    continue;
+                const uint32_t duration = max(1, (int)lround(G.edge_weight[e] * 60));
+                auto draw = [&](int k) { return flightHash(options.seed, G, u, e, duration, k); };
+                const int daily = 1 + (int)(draw(0) % max_daily);
+                for (int k = 0; k < daily; k++) {
+                    // evenly spaced slots, each jittered within its slot and rounded to 5 minutes
+                    const int slot = window / daily;
+                    const int minute = options.first_departure + slot * k + (slot > 0 ? (int)(draw(k + 1) % slot) : 0);
+                    addDaily(u, G.edge_dest[e], G.edge_airline[e], (uint32_t)(minute / 5 * 5), duration);
+                }
+            }
+        }
+        finish(options.days);
+        stats.build_ms = msSince(start);
+    }
+
+    // Reads a daily schedule: a header line, then Source,Destination,Airline,Departure,Duration
+    // rows with the departure as HH:MM and the duration in minutes. Rows may fly between airports
+    // the graph has no route for (counted in stats.off_graph); queries then no longer take the
+    // graph's reachability as a shortcut.
+    bool loadSchedule(const FlightGraph& G, const string& path, const TimetableOptions& options = TimetableOptions()) {
+        auto start = chrono::steady_clock::now();
+        MappedFile file;
+        if (!file.open(path))
+            return false;
+        begin(G, options);
+        vector<string_view> cols;
+        deque<string> spill;
+        string_view rest = file.view();
+        bool first_line = true;
+        while (!rest.empty()) {
+            const size_t nl = rest.find('\n');
+            string_view line = rest.substr(0, nl);
+            rest = nl == string_view::npos ? string_view() : rest.substr(nl + 1);
+            if (!line.empty() && line.back() == '\r')
+                line.remove_suffix(1);
+            if (line.empty() || exchange(first_line, false))
+                continue;
+            spill.clear();
+            parseCsvLine(line, cols, spill);
+            const int u = cols.size() >= 5 ? G.findAirportIndexByCode(cols[0]) : -1;
+            const int v = cols.size() >= 5 ? G.findAirportIndexByCode(cols[1]) : -1;
+            const int minute = u >= 0 ? parseClock(cols[3]) : -1;
+            const int duration = parseIntOr(cols.size() >= 5 ? cols[4] : string_view(), -1);
+            if (u < 0 || v < 0 || minute < 0 || duration <= 0) {
+                stats.skipped++;
+                continue;
+            }
+            if (G.findRoute(u, v) < 0) {
+                stats.off_graph++;
+                routes_in_graph = false;
+            }
+            auto airline = G.airline_names.ids.find(cols[2]);
+            addDaily(u, v, airline == G.airline_names.ids.end() ? -1 : airline->second, minute, duration);
+        }
+        finish(options.days);
+        stats.build_ms = msSince(start);
+        return true;
+    }
+
+    // Writes day 0 of the schedule in the format loadSchedule() reads
+    bool saveSchedule(const string& path) const {
+        ofstream out(path);
+        if (!out)
+            return false;
+        out << "Source,Destination,Airline,Departure,Duration\n";
+        for (size_t i = 0; i < connections.size() && connections[i].departure < MINUTES_PER_DAY; i++) {
+            const Connection& c = connections[i];
+            const int airline = connection_airline[i];
+            out << graph->airports[c.from].code << ',' << graph->airports[c.to].code << ','
+                << (airline < 0 ? string() : graph->airline_names.name(airline)) << ','
+                << clockString(c.departure) << ',' << c.arrival - c.departure << '\n';
+        }
+        return (bool)out;
+    }
+
+    void setMinConnection(int airport, int minutes) {
+        min_connection[airport] = (uint16_t)clamp(minutes, 0, 65535);
+    }
+
+    // Earliest arrival at dest leaving source at `depart_after` (minutes since day 0) or later.
+    // One linear scan from the first connection departing then; it stops as soon as connections
+    // depart after the best arrival found so far.
+    Journey earliestArrival(int source, int dest, int depart_after, QueryWorkspace& ws) const {
+        Journey journey;
+        ws.begin(graph->airports.size());
+        SearchRecord record("csa", ws.counters);
+        if (source < 0 || dest < 0 || !mayReach(source, dest))
+            return journey;
+        if (source == dest) {
+            journey.departure = journey.arrival = depart_after;
+            return journey;
+        }
+        const uint32_t mct_dest = min_connection[dest];
+        ws.set(source, depart_after, -1);
+        for (size_t i = firstDeparting(depart_after); i < connections.size(); i++) {
+            const Connection& c = connections[i];
+            if (c.departure + mct_dest >= ws.dist(dest))
+                break;          // departs after the best arrival: nothing later can beat it
+            searchCount(ws.counters.relaxed);
+            if (c.departure < ws.dist(c.from))
+                continue;
+            const double ready = c.arrival + min_connection[c.to];
+            if (ready < ws.dist(c.to)) {
+                ws.set(c.to, ready, (int)i);
+                searchCount(ws.counters.improved);
+            }
+        }
+        if (!ws.reached(dest))
+            return journey;
+        for (int i = ws.parent(dest); i >= 0; i = ws.parent(connections[i].from))
+            journey.legs.push_back((uint32_t)i);
+        reverse(journey.legs.begin(), journey.legs.end());
+        journey.departure = connections[journey.legs.front()].departure;
+        journey.arrival = connections[journey.legs.back()].arrival;
+        return journey;
+    }
+
+    Journey earliestArrival(const string& source_code, const string& destination_code, int depart_after) const {
+        return earliestArrival(graph->findAirportIndexByCode(source_code), graph->findAirportIndexByCode(destination_code),
+                               depart_after, QueryWorkspace::forThisThread());
+    }
+
+    // Profile query: every useful (departure, arrival) pair from source to dest for departures in
+    // [window_start, window_end], ordered by departure. A pair is dropped when a later departure
+    // in the window arrives no later. One backward scan over the connections from window_start on (profile
+    // CSA): each airport keeps its own Pareto profile of (departure, arrival at dest), built in
+    // decreasing departure order, so the profile at a connection's arrival airport answers "the
+    // earliest arrival when ready to leave at time T" with a short walk. Profiles live in one
+    // pooled array, chained per airport. Call earliestArrival() at a departure to get its legs.
+    vector<pair<int, int>> profile(int source, int dest, int window_start, int window_end) const {
+        vector<pair<int, int>> result;
+        if (source < 0 || dest < 0 || source == dest || !mayReach(source, dest))
+            return result;
+        struct Entry {
+            uint32_t departure, arrival;
+            int next;           // entry with the next later departure, -1 at the end
+        };
+        vector<Entry> pool;
+        vector<int> head(graph->airports.size(), -1);   // earliest departure of each airport's profile
+        const size_t first = firstDeparting(window_start);
+        for (size_t i = connections.size(); i-- > first;) {
+            const Connection& c = connections[i];
+            // departures after the window must not dominate the ones inside it
+            if (c.from == dest || (c.from == source && (int)c.departure > window_end))
+                continue;
+            uint32_t arrival = UINT32_MAX;
+            if (c.to == dest) {
+                arrival = c.arrival;
+            } else {
+                const uint32_t ready = c.arrival + min_connection[c.to];
+                int k = head[c.to];
+                while (k >= 0 && pool[k].departure < ready)
+                    k = pool[k].next;
+                if (k >= 0)
+                    arrival = pool[k].arrival;
+            }
+            const int h = head[c.from];
+            if (arrival == UINT32_MAX || (h >= 0 && pool[h].arrival <= arrival))
+                continue;
+            if (h >= 0 && pool[h].departure == c.departure) {
+                pool[h].arrival = arrival;      // same departure time, earlier arrival
+            } else {
+                pool.push_back({c.departure, arrival, h});
+                head[c.from] = (int)pool.size() - 1;
+            }
+        }
+        for (int k = head[source]; k >= 0 && (int)pool[k].departure <= window_end; k = pool[k].next)
+            result.push_back({(int)pool[k].departure, (int)pool[k].arrival});
+        return result;
+    }
+
+    vector<pair<int, int>> profile(const string& source_code, const string& destination_code, int window_start,
+                                   int window_end) const {
+        return profile(graph->findAirportIndexByCode(source_code), graph->findAirportIndexByCode(destination_code),
+                       window_start, window_end);
+    }
+
+    // "HH:MM" for minutes since day 0, with a "+Nd" suffix after the first day
+    static string clockString(uint32_t minutes) {
+        char buf[32];
+        const uint32_t day = minutes / MINUTES_PER_DAY, m = minutes % MINUTES_PER_DAY;
+        if (day == 0)
+            snprintf(buf, sizeof(buf), "%02u:%02u", m / 60, m % 60);
+        else
+            snprintf(buf, sizeof(buf), "%02u:%02u+%ud", m / 60, m % 60, day);
+        return buf;
+    }
+
+    // Minutes after midnight of "HH:MM", -1 if malformed
+    static int parseClock(string_view s) {
+        const size_t colon = s.find(':');
+        if (colon == string_view::npos)
+            return -1;
+        const int h = parseIntOr(s.substr(0, colon), -1), m = parseIntOr(s.substr(colon + 1), -1);
+        if (h < 0 || h > 23 || m < 0 || m > 59)
+            return -1;
+        return h * 60 + m;
+    }
+
+    static constexpr uint32_t MINUTES_PER_DAY = 24 * 60;
+
+private:
+    const FlightGraph* graph = nullptr;
+    vector<Connection> daily;           // day 0, unsorted, while building
+    vector<int> daily_airline;
+    bool routes_in_graph = true;        // every connection flies a route of the graph
+
+    void begin(const FlightGraph& G, const TimetableOptions& options) {
+        graph = &G;
+        stats = TimetableStats();
+        routes_in_graph = true;
+        daily.clear();
+        daily_airline.clear();
+        min_connection.assign(G.airports.size(), (uint16_t)clamp(options.min_connection, 0, 65535));
+    }
+
+    void addDaily(int from, int to, int airline, uint32_t departure, uint32_t duration) {
+        daily.push_back({departure, departure + duration, from, to});
+        daily_airline.push_back(airline);
+    }
+
+    // Repeats the daily schedule over `days` days and sorts it by departure
+    void finish(int days) {
+        days = max(1, days);
+        vector<uint32_t> order(daily.size());
+        for (uint32_t i = 0; i < order.size(); i++)
+            order[i] = i;
+        sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            return daily[a].departure != daily[b].departure ? daily[a].departure < daily[b].departure
+                                                            : daily[a].arrival < daily[b].arrival;
+        });
+        connections.clear();
+        connection_airline.clear();
+        connections.reserve(daily.size() * days);
+        connection_airline.reserve(daily.size() * days);
+        for (int d = 0; d < days; d++) {
+            for (uint32_t i : order) {
+                Connection c = daily[i];
+                c.departure += d * MINUTES_PER_DAY;
+                c.arrival += d * MINUTES_PER_DAY;
+                connections.push_back(c);
+                connection_airline.push_back(daily_airline[i]);
+            }
+        }
+        stats.daily = daily.size();
+        stats.connections = connections.size();
+        daily = vector<Connection>();
+        daily_airline = vector<int>();
+    }
+
+    // False only if no journey can go from s to t. The graph's reachability answers that when
+    // every connection is one of its routes; a loaded schedule may have others.
+    bool mayReach(int s, int t) const {
+        return !routes_in_graph || graph->mayReach(s, t);
+    }
+
+    // 64 pseudo-random bits for draw k of a generated flight (edge e out of u): a hash of the seed,
+    // both airport codes, the airline and the duration, not of the flight's position in the graph
+    static uint64_t flightHash(uint64_t seed, const FlightGraph& G, int u, uint32_t e, uint32_t duration, int k) {
+        const string& from = G.airports[u].code;
+        const string& to = G.airports[G.edge_dest[e]].code;
+        const int airline = G.edge_airline[e];
+        uint64_t h = snapshotChecksum(from.data(), from.size(), seed);
+        h = snapshotChecksum("-", 1, h);
+        h = snapshotChecksum(to.data(), to.size(), h);
+        if (airline >= 0) {
+            const string& name = G.airline_names.name(airline);
+            h = snapshotChecksum(name.data(), name.size(), h);
+        }
+        const uint32_t tail[2] = {duration, (uint32_t)k};
+        h = snapshotChecksum(reinterpret_cast<const char*>(tail), sizeof(tail), h);
+        // splitmix64 finalizer: the byte hash leaves the low bits, which % keeps, poorly mixed
+        h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+        return h ^ (h >> 31);
+    }
+
+    // Index of the first connection departing at or after `minute`
+    size_t firstDeparting(int minute) const {
+        const uint32_t m = (uint32_t)max(0, minute);
+        return lower_bound(connections.begin(), connections.end(), m,
+                           [](const Connection& c, uint32_t t) { return c.departure < t; }) - connections.begin();
+    }
+};
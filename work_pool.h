@@ -0,0 +1,189 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing parallel loop over [0, count).
+//
+// Every worker starts with an equal contiguous share of the indices and takes `grain` of them at
+// a time from the front of its own share. A worker whose share runs dry steals the back half of
+// the largest share left, so a few slow items do not leave the other threads idle. Shares are
+// single 64-bit words (begin, end) updated with compare-and-swap; nothing else is shared.
+class WorkStealingLoop {
+public:
+    // Calls body(worker, i) exactly once for every i; worker is in [0, num_threads) and identifies
+    // the calling thread, so body can keep per-worker scratch state indexed by it. num_threads <= 0
+    // means one per hardware thread. Returns the number of workers used.
+    template <class Body>
+    static int run(size_t count, int num_threads, size_t grain, Body body) {
+        if (num_threads <= 0)
+            num_threads = std::max(1u, std::thread::hardware_concurrency());
+        grain = std::max<size_t>(1, grain);
+        num_threads = (int)std::max<size_t>(1, std::min<size_t>(num_threads, (count + grain - 1) / grain));
+        if (num_threads == 1) {
+            for (size_t i = 0; i < count; i++)
+                body(0, i);
+            return 1;
+        }
+
+        std::vector<Share> shares(num_threads);
+        for (int t = 0; t < num_threads; t++)
+            shares[t].range.store(pack(count * t / num_threads, count * (t + 1) / num_threads));
+
+        auto work = [&](int t) {
+            std::atomic<uint64_t>& mine = shares[t].range;
+            while (true) {
+                // drain our own share from the front
+                uint64_t r = mine.load();
+                while (begin(r) < end(r)) {
+                    const uint32_t b = begin(r), e = std::min<uint64_t>(end(r), b + grain);
+                    if (!mine.compare_exchange_weak(r, pack(e, end(r))))
+                        continue;
+                    for (uint32_t i = b; i < e; i++)
+                        body(t, i);
+                    r = mine.load();
+                }
+                if (!steal(shares, t))
+                    return;
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (int t = 1; t < num_threads; t++)
+            workers.emplace_back(work, t);
+        work(0);
+        for (auto& w : workers)
+            w.join();
+        return num_threads;
+    }
+
+private:
+    struct alignas(64) Share {      // one cache line each, so owners do not contend
+        std::atomic<uint64_t> range{0};
+    };
+
+    static uint64_t pack(uint64_t b, uint64_t e) { return (e << 32) | b; }
+    static uint32_t begin(uint64_t r) { return (uint32_t)r; }
+    static uint32_t end(uint64_t r) { return (uint32_t)(r >> 32); }
+
+    // Moves the back half of the largest other share into worker t's (empty) share.
+    // Returns false once every share is empty.
+    static bool steal(std::vector<Share>& shares, int t) {
+        while (true) {
+            int victim = -1;
+            uint64_t victim_range = 0;
+            uint32_t most = 0;
+            for (int v = 0; v < (int)shares.size(); v++) {
+                const uint64_t r = shares[v].range.load();
+                if (v != t && end(r) > begin(r) && end(r) - begin(r) > most) {
+                    most = end(r) - begin(r);
+                    victim = v;
+                    victim_range = r;
+                }
+            }
+            if (victim < 0)
+                return false;
+            const uint32_t mid = begin(victim_range) + most / 2;
+            if (shares[victim].range.compare_exchange_strong(victim_range, pack(begin(victim_range), mid))) {
+                // ranges handed out are disjoint, so nobody can be holding a stale copy of this one
+                shares[t].range.store(pack(mid, end(victim_range)));
+                return true;
+            }
+        }
+    }
+};
+
+// Persistent helper threads for searches that run a fixed team in lockstep (rounds separated by a
+// barrier), so a query does not create and join threads.
+//
+// run(n, body) calls body(t) for every t in [0, n) at the same time, t = 0 on the calling thread,
+// and returns once all have finished. Helpers are started on first use and sleep between runs.
+// One run uses the team at a time; a caller that finds it busy (another thread's query, or a
+// nested run) gets threads of its own for that run instead of waiting.
+class ThreadTeam {
+public:
+    static ThreadTeam& shared() {
+        static ThreadTeam team;
+        return team;
+    }
+
+    ~ThreadTeam() {
+        {
+            std::lock_guard<std::mutex> hold(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& h : helpers)
+            h.join();
+    }
+
+    template <class Body>
+    void run(int num_threads, Body body) {
+        if (num_threads <= 1) {
+            body(0);
+            return;
+        }
+        std::unique_lock<std::mutex> mine(run_lock, std::try_to_lock);
+        if (!mine.owns_lock()) {
+            std::vector<std::thread> workers;
+            for (int t = 1; t < num_threads; t++)
+                workers.emplace_back(body, t);
+            body(0);
+            for (auto& w : workers)
+                w.join();
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> hold(lock);
+            while ((int)helpers.size() < num_threads - 1) {
+                const int index = (int)helpers.size() + 1;
+                helpers.emplace_back([this, index]() { serve(index); });
+            }
+            task = &body;
+            call = [](void* b, int t) { (*static_cast<Body*>(b))(t); };
+            active = num_threads;
+            remaining = num_threads - 1;
+            generation++;
+        }
+        wake.notify_all();
+        body(0);
+        std::unique_lock<std::mutex> hold(lock);
+        done.wait(hold, [&]() { return remaining == 0; });
+    }
+
+private:
+    std::mutex run_lock;                // held by the run using the team
+    std::mutex lock;                    // guards everything below
+    std::condition_variable wake, done;
+    std::vector<std::thread> helpers;   // helper i - 1 runs body(i)
+    void* task = nullptr;
+    void (*call)(void*, int) = nullptr;
+    int active = 0;                     // team size of the current run
+    int remaining = 0;                  // helpers of the current run still working
+    uint64_t generation = 0;            // bumped by every run
+    bool stopping = false;
+
+    void serve(int index) {
+        uint64_t seen = 0;
+        std::unique_lock<std::mutex> hold(lock);
+        while (true) {
+            wake.wait(hold, [&]() { return stopping || generation != seen; });
+            if (stopping)
+                return;
+            seen = generation;
+            if (index >= active)
+                continue;
+            void* t = task;
+            void (*c)(void*, int) = call;
+            hold.unlock();
+            c(t, index);
+            hold.lock();
+            if (--remaining == 0)
+                done.notify_one();
+        }
+    }
+};